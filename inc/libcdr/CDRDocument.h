@@ -12,6 +12,8 @@
 
 #include <librevenge/librevenge.h>
 #include "libcdr_api.h"
+#include "CDRDocumentIndex.h"
+#include "CDRParseOptions.h"
 
 namespace libcdr
 {
@@ -22,6 +24,12 @@ public:
   static CDRAPI bool isSupported(librevenge::RVNGInputStream *input);
 
   static CDRAPI bool parse(librevenge::RVNGInputStream *input, librevenge::RVNGDrawingInterface *painter);
+
+  static CDRAPI CDRParseStatus parseWithOptions(librevenge::RVNGInputStream *input, librevenge::RVNGDrawingInterface *painter,
+                                                const CDRParseOptions &options);
+
+  static CDRAPI CDRParseStatus parseWithOptions(librevenge::RVNGInputStream *input, CDRDocumentIndex &index,
+                                                const CDRParseOptions &options);
 };
 
 } // namespace libcdr
@@ -0,0 +1,58 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libcdr project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef __CDRDOCUMENTINDEX_H__
+#define __CDRDOCUMENTINDEX_H__
+
+#include <librevenge/librevenge.h>
+#include "libcdr_api.h"
+#include "CDRParseOptions.h"
+
+namespace libcdr
+{
+
+class CDRDocumentIndexImpl;
+
+/**
+The drawing of a parsed document, kept together with an index of where
+every object is on its page. It is filled by
+CDRDocument::parseWithOptions or CMXDocument::parseWithOptions, after
+which any rectangle of any page can be drawn as often as needed, for
+example one tile after another, without parsing the document again.
+*/
+class CDRDocumentIndex
+{
+public:
+  CDRAPI CDRDocumentIndex();
+  CDRAPI ~CDRDocumentIndex();
+
+  /** Number of pages, counted like the pages passed to a painter by a parse. */
+  CDRAPI unsigned getPageCount() const;
+
+  /** Draws the objects of a page that intersect the viewport, in their
+      order, as a document with this one page. Objects are tested like for
+      CDRParseOptions::setViewport, but only the objects near the viewport are
+      visited. An empty viewport draws the whole page.
+      \return false if there is no such page */
+  CDRAPI bool renderViewport(unsigned page, const CDRViewport &viewport, librevenge::RVNGDrawingInterface *painter) const;
+
+private:
+  CDRDocumentIndex(const CDRDocumentIndex &);
+  CDRDocumentIndex &operator=(const CDRDocumentIndex &);
+
+  friend class CDRDocument;
+  friend class CMXDocument;
+
+  CDRDocumentIndexImpl *m_impl;
+};
+
+} // namespace libcdr
+
+#endif //  __CDRDOCUMENTINDEX_H__
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,187 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libcdr project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef __CDRPARSEOPTIONS_H__
+#define __CDRPARSEOPTIONS_H__
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+#include "libcdr_api.h"
+
+namespace libcdr
+{
+
+/**
+Result of CDRDocument::parseWithOptions and
+CMXDocument::parseWithOptions. Note that success is 0.
+*/
+enum CDRParseStatus
+{
+  CDR_PARSE_SUCCESS = 0,
+  CDR_PARSE_FAILURE,            ///< The document could not be parsed
+  CDR_PARSE_CANCELLED,          ///< The parse was stopped through CDRParseOptions::setCancelFlag
+  CDR_PARSE_DEADLINE_EXCEEDED   ///< The parse was stopped because the CDRParseOptions::setDeadline time passed
+};
+
+/**
+The pass over the document a progress report belongs to. Every document
+is read twice, first to collect styles and bitmaps, then to emit the
+content to the painter.
+*/
+enum CDRParsePhase
+{
+  CDR_PARSE_PHASE_STYLES = 0,
+  CDR_PARSE_PHASE_CONTENT
+};
+
+/**
+Progress report passed to the callback set by CDRParseOptions::setProgressCallback.
+*/
+struct CDRParseProgress
+{
+  CDRParsePhase phase;    ///< The pass that is running
+  unsigned page;          ///< Number of pages started so far in this pass
+  unsigned long position; ///< Bytes of the main stream consumed so far
+  unsigned long length;   ///< Length of the main stream in bytes
+};
+
+/**
+Rectangle on a page in inches. The origin is the top left corner of the
+page, like for the coordinates passed to the painter.
+*/
+struct CDRViewport
+{
+  CDRViewport() : x(0.0), y(0.0), width(0.0), height(0.0) {}
+  CDRViewport(double x_, double y_, double width_, double height_)
+    : x(x_), y(y_), width(width_), height(height_) {}
+
+  double x;
+  double y;
+  double width;
+  double height;
+};
+
+class CDRParseOptionsImpl;
+
+/**
+Options that influence how CDRDocument::parseWithOptions and
+CMXDocument::parseWithOptions process a document. A default constructed
+instance gives the same result as parse. The options are only set
+through the setters, so that new ones can be added without changing the
+layout of the class.
+*/
+class CDRParseOptions
+{
+public:
+  CDRAPI CDRParseOptions();
+  CDRAPI CDRParseOptions(const CDRParseOptions &other);
+  CDRAPI ~CDRParseOptions();
+  CDRAPI CDRParseOptions &operator=(const CDRParseOptions &other);
+
+  /** Only extract text. Geometry, bitmaps, vector patterns and outline
+      records are skipped instead of being decoded, so the painter receives
+      the page structure and text objects only. */
+  CDRAPI void setTextOnly(bool textOnly);
+
+  /** Cancellation token. If set, it is polled at record boundaries and
+      while converting bitmaps; storing true into it from any thread makes
+      the parse stop promptly with CDR_PARSE_CANCELLED. The flag must
+      outlive the parse call. */
+  CDRAPI void setCancelFlag(const std::atomic<bool> *cancelFlag);
+
+  /** Point in time after which the parse stops with
+      CDR_PARSE_DEADLINE_EXCEEDED. It is checked at the same places as the
+      cancellation flag. The default never expires. */
+  CDRAPI void setDeadline(std::chrono::steady_clock::time_point deadline);
+
+  /** Called from the parsing thread to report how far the parse got. It
+      is invoked at most once per progress interval, and additionally
+      whenever a new page starts and when a pass finishes. */
+  CDRAPI void setProgressCallback(const std::function<void (const CDRParseProgress &)> &progressCallback);
+
+  /** Minimal time between two progress reports, 100 ms by default. */
+  CDRAPI void setProgressInterval(std::chrono::steady_clock::duration progressInterval);
+
+  /** Maximal number of pixels of a converted bitmap. Embedded bitmaps
+      that are larger are shrunk by an integer factor with a box filter
+      while they are converted, so the full resolution image is never
+      held in memory. Each pixel costs 4 bytes. 0, the default, means no
+      limit. */
+  CDRAPI void setMaxBitmapPixels(unsigned long maxBitmapPixels);
+
+  /** Allocate short-lived parse data, like the point lists of a record
+      and the output element lists of a page, from arenas that are reset
+      in one go instead of freeing every allocation. */
+  CDRAPI void setUseArena(bool useArena);
+
+  /** Share the style of objects whose fill and line do not depend on the
+      object itself. Such objects get the same style property list, tagged
+      with a "libcdr:style-id" property that is unique per distinct style,
+      and setStyle() is not called again for consecutive objects with the
+      same style. Generators can use the id to define each style once. */
+  CDRAPI void setShareStyles(bool shareStyles);
+
+  /** Recognize paths that are copies of each other, only placed, scaled
+      or rotated differently. All copies get the same "libcdr:geometry-id"
+      property and a "libcdr:geometry-transform" property with the SVG
+      matrix() that maps the shared geometry onto the copy. Every copy is
+      self-contained: the shared geometry is the path data of any copy
+      mapped back by the inverse of its matrix, so generators can define
+      it with whichever copy they see first, whatever the drawing order.
+      Ids are unique within one document and the same on all its pages.
+      The path data is still passed in full. Paths of vector patterns are
+      not tagged, and no path is tagged when a detail tolerance is set, as
+      simplified copies are no longer transformations of each other. */
+  CDRAPI void setInstanceGeometry(bool instanceGeometry);
+
+  /** Only draw the objects that intersect this rectangle of every page,
+      for example to render one tile of a zoomed-in page. Objects are
+      tested with their bounding box on the page, widened by their outline
+      and arrow heads, and the ones that are drawn keep their order. Pages
+      and groups are always emitted. Text without a frame has no known
+      extent and is always drawn. An empty rectangle, the default, draws
+      all objects. */
+  CDRAPI void setViewport(const CDRViewport &viewport);
+
+  /** Size in inches on the page below which details are not needed, for
+      example the size of a device pixel when rendering a thumbnail.
+      Objects whose bounding box on the page, widened by the outline, is
+      smaller than this in both directions are dropped, and paths are
+      simplified by replacing nearly straight curves and runs of lines by
+      fewer lines, moving no point by more than this. Vector patterns are
+      not simplified. 0, the default, keeps all details. */
+  CDRAPI void setDetailTolerance(double detailTolerance);
+
+  /** Extract the data streams of zip based X6 and newer documents on a
+      background thread while the document is parsed, instead of when a
+      record first refers to them. Only one stream can be extracted at a
+      time: a stream the parser needs before the thread got to it is
+      extracted right after the one in progress, ahead of the others. All
+      streams are held in memory until the styles pass is finished. */
+  CDRAPI void setPrefetchStreams(bool prefetchStreams);
+
+  /** Number of threads that convert embedded bitmaps while the parse goes
+      on. Every bitmap is converted independently, and the content pass
+      only waits for a bitmap when it draws it. 0, the default, converts
+      bitmaps on the parsing thread as they are read. */
+  CDRAPI void setBitmapThreads(unsigned bitmapThreads);
+
+private:
+  friend class CDRDocument;
+  friend class CMXDocument;
+
+  CDRParseOptionsImpl *m_impl;
+};
+
+} // namespace libcdr
+
+#endif //  __CDRPARSEOPTIONS_H__
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -11,6 +11,8 @@
 #define __LIBCDR_H__
 
 #include "CDRDocument.h"
+#include "CDRDocumentIndex.h"
+#include "CDRParseOptions.h"
 #include "CMXDocument.h"
 
 #endif
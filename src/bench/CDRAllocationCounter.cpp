@@ -0,0 +1,87 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libcdr project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "CDRAllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+
+std::atomic<unsigned long> g_allocations(0);
+std::atomic<unsigned long long> g_allocatedBytes(0);
+
+void *countedAlloc(std::size_t size)
+{
+  ++g_allocations;
+  g_allocatedBytes += size;
+  if (void *ptr = std::malloc(size ? size : 1))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+} // anonymous namespace
+
+unsigned long cdrbench::allocationCount()
+{
+  return g_allocations;
+}
+
+unsigned long long cdrbench::allocatedBytes()
+{
+  return g_allocatedBytes;
+}
+
+long cdrbench::peakRSS()
+{
+#ifndef _WIN32
+  struct rusage usage;
+  if (!getrusage(RUSAGE_SELF, &usage))
+    return usage.ru_maxrss;
+#endif
+  return -1;
+}
+
+void *operator new(std::size_t size)
+{
+  return countedAlloc(size);
+}
+
+void *operator new[](std::size_t size)
+{
+  return countedAlloc(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
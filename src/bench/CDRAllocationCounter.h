@@ -0,0 +1,30 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libcdr project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef __CDRALLOCATIONCOUNTER_H__
+#define __CDRALLOCATIONCOUNTER_H__
+
+namespace cdrbench
+{
+
+/**
+Totals of the heap allocations made through the global operator new
+since the program started. Linking CDRAllocationCounter.cpp replaces the
+global allocation functions.
+*/
+unsigned long allocationCount();
+unsigned long long allocatedBytes();
+
+/** Peak resident set size of the process in KiB, or -1 if unknown. */
+long peakRSS();
+
+} // namespace cdrbench
+
+#endif // __CDRALLOCATIONCOUNTER_H__
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,387 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libcdr project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include <librevenge/librevenge.h>
+#include <librevenge-generators/librevenge-generators.h>
+#include <librevenge-stream/librevenge-stream.h>
+#include <libcdr/libcdr.h>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "CDRAllocationCounter.h"
+#include "CDRSyntheticDocument.h"
+
+#ifndef VERSION
+#define VERSION "UNKNOWN VERSION"
+#endif
+
+namespace
+{
+
+enum BenchFormat
+{
+  FORMAT_CDR,
+  FORMAT_CMX
+};
+
+struct Scenario
+{
+  Scenario()
+    : name(""), format(FORMAT_CDR), params() {}
+
+  const char *name;
+  BenchFormat format;
+  cdrsynthetic::SyntheticDocumentParams params;
+};
+
+struct Result
+{
+  double seconds;
+  unsigned long allocations;
+  unsigned long long allocatedBytes;
+  bool ok;
+};
+
+Result parse(const std::vector<unsigned char> &data, BenchFormat format, const libcdr::CDRParseOptions &options)
+{
+  librevenge::RVNGStringStream input(&data[0], (unsigned)data.size());
+  librevenge::RVNGDummyDrawingGenerator generator;
+
+  Result result;
+  const unsigned long allocations = cdrbench::allocationCount();
+  const unsigned long long allocatedBytes = cdrbench::allocatedBytes();
+  const auto start = std::chrono::steady_clock::now();
+  if (format == FORMAT_CDR)
+    result.ok = libcdr::CDRDocument::parseWithOptions(&input, &generator, options) == libcdr::CDR_PARSE_SUCCESS;
+  else
+    result.ok = libcdr::CMXDocument::parseWithOptions(&input, &generator, options) == libcdr::CDR_PARSE_SUCCESS;
+  result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  result.allocations = cdrbench::allocationCount() - allocations;
+  result.allocatedBytes = cdrbench::allocatedBytes() - allocatedBytes;
+  return result;
+}
+
+bool run(const Scenario &scenario, unsigned iterations, const char *writePrefix, const libcdr::CDRParseOptions &options)
+{
+  const cdrsynthetic::SyntheticDocument document = scenario.format == FORMAT_CDR
+                                               ? cdrsynthetic::generateCDR(scenario.params)
+                                               : cdrsynthetic::generateCMX(scenario.params);
+  if (document.data.empty())
+    return false;
+
+  if (writePrefix)
+  {
+    std::string fileName(writePrefix);
+    fileName += scenario.name;
+    fileName += scenario.format == FORMAT_CDR ? ".cdr" : ".cmx";
+    FILE *file = fopen(fileName.c_str(), "wb");
+    if (!file || fwrite(&document.data[0], 1, document.data.size(), file) != document.data.size())
+    {
+      fprintf(stderr, "ERROR: Cannot write %s\n", fileName.c_str());
+      if (file)
+        fclose(file);
+      return false;
+    }
+    fclose(file);
+  }
+
+  // The first run warms up caches and is not measured
+  Result best = parse(document.data, scenario.format, options);
+  if (!best.ok)
+  {
+    fprintf(stderr, "ERROR: Parsing of %s failed!\n", scenario.name);
+    return false;
+  }
+  best.seconds = 0.0;
+  for (unsigned i = 0; i < iterations; ++i)
+  {
+    const Result result = parse(document.data, scenario.format, options);
+    if (!result.ok)
+    {
+      fprintf(stderr, "ERROR: Parsing of %s failed!\n", scenario.name);
+      return false;
+    }
+    if (!i || result.seconds < best.seconds)
+      best.seconds = result.seconds;
+  }
+
+  const double megabytes = document.data.size() / (1024.0 * 1024.0);
+  printf("%-20s %10.2f %10.3f %10.1f %12.0f %12lu %12.1f %10ld\n",
+         scenario.name, megabytes, best.seconds * 1000.0,
+         best.seconds > 0.0 ? megabytes / best.seconds : 0.0,
+         best.seconds > 0.0 ? document.objects / best.seconds : 0.0,
+         best.allocations, best.allocatedBytes / (1024.0 * 1024.0), cdrbench::peakRSS());
+  fflush(stdout);
+  return true;
+}
+
+/* The peak resident set size only ever grows, so every scenario is run
+   in a child process to measure it for that scenario alone. */
+bool runIsolated(const Scenario &scenario, unsigned iterations, const char *writePrefix, const libcdr::CDRParseOptions &options)
+{
+#ifndef _WIN32
+  fflush(stdout);
+  const pid_t pid = fork();
+  if (!pid)
+    _exit(run(scenario, iterations, writePrefix, options) ? 0 : 1);
+  if (pid > 0)
+  {
+    int status = 0;
+    if (waitpid(pid, &status, 0) != pid)
+      return false;
+    return WIFEXITED(status) && !WEXITSTATUS(status);
+  }
+#endif
+  return run(scenario, iterations, writePrefix, options);
+}
+
+std::vector<Scenario> defaultScenarios()
+{
+  std::vector<Scenario> scenarios;
+  Scenario scenario;
+
+  scenario.name = "cdr-shapes";
+  scenario.format = FORMAT_CDR;
+  scenario.params = cdrsynthetic::SyntheticDocumentParams();
+  scenario.params.pages = 8;
+  scenario.params.objectsPerPage = 1000;
+  scenarios.push_back(scenario);
+
+  scenario.name = "cdr-long-curves";
+  scenario.params = cdrsynthetic::SyntheticDocumentParams();
+  scenario.params.objectsPerPage = 100;
+  scenario.params.pointsPerPath = 2000;
+  scenarios.push_back(scenario);
+
+  scenario.name = "cdr-nested";
+  scenario.params = cdrsynthetic::SyntheticDocumentParams();
+  scenario.params.objectsPerPage = 1000;
+  scenario.params.nestingDepth = 8;
+  scenarios.push_back(scenario);
+
+  scenario.name = "cdr-compressed";
+  scenario.params = cdrsynthetic::SyntheticDocumentParams();
+  scenario.params.pages = 8;
+  scenario.params.objectsPerPage = 1000;
+  scenario.params.compressed = true;
+  scenarios.push_back(scenario);
+
+  scenario.name = "cdr-text";
+  scenario.params = cdrsynthetic::SyntheticDocumentParams();
+  scenario.params.objectsPerPage = 0;
+  scenario.params.textsPerPage = 500;
+  scenario.params.charactersPerText = 200;
+  scenarios.push_back(scenario);
+
+  const struct
+  {
+    const char *name;
+    cdrsynthetic::SyntheticColorModel model;
+  } bitmapScenarios[] =
+  {
+    { "cdr-bitmap-rgb", cdrsynthetic::SYNTHETIC_RGB },
+    { "cdr-bitmap-cmyk", cdrsynthetic::SYNTHETIC_CMYK },
+    { "cdr-bitmap-gray", cdrsynthetic::SYNTHETIC_GRAYSCALE },
+    { "cdr-bitmap-bw", cdrsynthetic::SYNTHETIC_BLACK_AND_WHITE },
+    { "cdr-bitmap-palette", cdrsynthetic::SYNTHETIC_PALETTE }
+  };
+  for (const auto &bitmapScenario : bitmapScenarios)
+  {
+    scenario.name = bitmapScenario.name;
+    scenario.params = cdrsynthetic::SyntheticDocumentParams();
+    scenario.params.pages = 1;
+    scenario.params.objectsPerPage = 0;
+    scenario.params.bitmaps = 4;
+    scenario.params.bitmapWidth = 1024;
+    scenario.params.bitmapHeight = 1024;
+    scenario.params.bitmapModel = bitmapScenario.model;
+    scenarios.push_back(scenario);
+  }
+
+  scenario.name = "cmx-shapes";
+  scenario.format = FORMAT_CMX;
+  scenario.params = cdrsynthetic::SyntheticDocumentParams();
+  scenario.params.pages = 8;
+  scenario.params.objectsPerPage = 1000;
+  scenarios.push_back(scenario);
+
+  scenario.name = "cmx-nested";
+  scenario.params = cdrsynthetic::SyntheticDocumentParams();
+  scenario.params.objectsPerPage = 1000;
+  scenario.params.nestingDepth = 8;
+  scenarios.push_back(scenario);
+
+  return scenarios;
+}
+
+bool parseUnsigned(const char *str, unsigned &value)
+{
+  char *end = nullptr;
+  const unsigned long parsed = strtoul(str, &end, 10);
+  if (!*str || *end)
+    return false;
+  value = (unsigned)parsed;
+  return true;
+}
+
+bool parseColorModel(const char *str, cdrsynthetic::SyntheticColorModel &model)
+{
+  if (!strcmp(str, "rgb"))
+    model = cdrsynthetic::SYNTHETIC_RGB;
+  else if (!strcmp(str, "cmyk"))
+    model = cdrsynthetic::SYNTHETIC_CMYK;
+  else if (!strcmp(str, "gray"))
+    model = cdrsynthetic::SYNTHETIC_GRAYSCALE;
+  else if (!strcmp(str, "bw"))
+    model = cdrsynthetic::SYNTHETIC_BLACK_AND_WHITE;
+  else if (!strcmp(str, "palette"))
+    model = cdrsynthetic::SYNTHETIC_PALETTE;
+  else
+    return false;
+  return true;
+}
+
+int printUsage()
+{
+  printf("`cdrbench' measures how fast libcdr parses generated documents.\n");
+  printf("\n");
+  printf("Usage: cdrbench [OPTION]...\n");
+  printf("\n");
+  printf("Without document options, a fixed set of CDR and CMX documents is\n");
+  printf("measured. With any of them, a single document is generated.\n");
+  printf("\n");
+  printf("Options:\n");
+  printf("\t--cmx                 generate a CMX document instead of CDR\n");
+  printf("\t--pages N             number of pages\n");
+  printf("\t--objects N           number of shapes per page\n");
+  printf("\t--points N            number of nodes per curve\n");
+  printf("\t--bitmaps N           number of bitmaps\n");
+  printf("\t--bitmap-size WxH     size of every bitmap\n");
+  printf("\t--bitmap-model M      rgb, cmyk, gray, bw or palette\n");
+  printf("\t--texts N             number of text objects per page\n");
+  printf("\t--chars N             number of characters per text object\n");
+  printf("\t--depth N             number of groups every object is nested in\n");
+  printf("\t--compress            compress the CDR document body\n");
+  printf("\t--seed N              seed of the generator\n");
+  printf("\t--iterations N        number of measured parses (default 5)\n");
+  printf("\t--bitmap-threads N    convert bitmaps on N threads (default 0)\n");
+  printf("\t--write PREFIX        also write the documents to PREFIX<name>.cdr/.cmx\n");
+  printf("\t--help                show this help message\n");
+  printf("\t--version             show version information and exit\n");
+  printf("\n");
+  printf("Report bugs to <https://bugs.documentfoundation.org/>.\n");
+  return -1;
+}
+
+int printVersion()
+{
+  printf("cdrbench " VERSION "\n");
+  return 0;
+}
+
+} // anonymous namespace
+
+int main(int argc, char *argv[])
+{
+  Scenario custom;
+  custom.name = "custom";
+  bool useCustom = false;
+  unsigned iterations = 5;
+  const char *writePrefix = nullptr;
+  libcdr::CDRParseOptions options;
+
+  for (int i = 1; i < argc; i++)
+  {
+    const bool hasValue = i + 1 < argc;
+    bool valid = true;
+    if (!strcmp(argv[i], "--help"))
+      return printUsage();
+    else if (!strcmp(argv[i], "--version"))
+      return printVersion();
+    else if (!strcmp(argv[i], "--cmx"))
+      custom.format = FORMAT_CMX;
+    else if (!strcmp(argv[i], "--compress"))
+      custom.params.compressed = true;
+    else if (!hasValue)
+      return printUsage();
+    else if (!strcmp(argv[i], "--pages"))
+      valid = parseUnsigned(argv[++i], custom.params.pages);
+    else if (!strcmp(argv[i], "--objects"))
+      valid = parseUnsigned(argv[++i], custom.params.objectsPerPage);
+    else if (!strcmp(argv[i], "--points"))
+      valid = parseUnsigned(argv[++i], custom.params.pointsPerPath);
+    else if (!strcmp(argv[i], "--bitmaps"))
+      valid = parseUnsigned(argv[++i], custom.params.bitmaps);
+    else if (!strcmp(argv[i], "--bitmap-size"))
+      valid = sscanf(argv[++i], "%ux%u", &custom.params.bitmapWidth, &custom.params.bitmapHeight) == 2;
+    else if (!strcmp(argv[i], "--bitmap-model"))
+      valid = parseColorModel(argv[++i], custom.params.bitmapModel);
+    else if (!strcmp(argv[i], "--texts"))
+      valid = parseUnsigned(argv[++i], custom.params.textsPerPage);
+    else if (!strcmp(argv[i], "--chars"))
+      valid = parseUnsigned(argv[++i], custom.params.charactersPerText);
+    else if (!strcmp(argv[i], "--depth"))
+      valid = parseUnsigned(argv[++i], custom.params.nestingDepth);
+    else if (!strcmp(argv[i], "--seed"))
+      valid = parseUnsigned(argv[++i], custom.params.seed);
+    else if (!strcmp(argv[i], "--iterations"))
+    {
+      valid = parseUnsigned(argv[++i], iterations);
+      continue;
+    }
+    else if (!strcmp(argv[i], "--bitmap-threads"))
+    {
+      unsigned bitmapThreads = 0;
+      if (!parseUnsigned(argv[++i], bitmapThreads))
+        return printUsage();
+      options.setBitmapThreads(bitmapThreads);
+      continue;
+    }
+    else if (!strcmp(argv[i], "--write"))
+    {
+      writePrefix = argv[++i];
+      continue;
+    }
+    else
+      return printUsage();
+    if (!valid)
+      return printUsage();
+    useCustom = true;
+  }
+  if (!iterations)
+    iterations = 1;
+
+  std::vector<Scenario> scenarios;
+  if (useCustom)
+    scenarios.push_back(custom);
+  else
+    scenarios = defaultScenarios();
+
+  printf("%-20s %10s %10s %10s %12s %12s %12s %10s\n",
+         "document", "MB", "ms", "MB/s", "objects/s", "allocs", "alloc MB", "peak KB");
+  bool ok = true;
+  for (const auto &scenario : scenarios)
+    ok = runIsolated(scenario, iterations, writePrefix, options) && ok;
+  return ok ? 0 : 1;
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
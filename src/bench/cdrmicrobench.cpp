@@ -0,0 +1,680 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libcdr project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+#include <librevenge/librevenge.h>
+#include <librevenge-stream/librevenge-stream.h>
+
+#include "CDRInternalStream.h"
+#include "CDRPath.h"
+#include "CDRStylesCollector.h"
+#include "CDRTransforms.h"
+#include "CommonParser.h"
+#include "libcdr_utils.h"
+
+#include "CDRAllocationCounter.h"
+#include "CDRSyntheticDocument.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#ifndef VERSION
+#define VERSION "UNKNOWN VERSION"
+#endif
+
+namespace
+{
+
+// Results are accumulated here so that the measured code is not optimized away
+volatile double g_sink = 0.0;
+
+class Random
+{
+public:
+  explicit Random(unsigned seed) : m_state(seed ? seed : 1) {}
+
+  unsigned next()
+  {
+    m_state ^= m_state << 13;
+    m_state ^= m_state >> 17;
+    m_state ^= m_state << 5;
+    return m_state;
+  }
+
+  unsigned next(unsigned bound)
+  {
+    return bound ? next() % bound : 0;
+  }
+
+  double nextDouble(double low, double high)
+  {
+    return low + (high - low) * (next() / 4294967296.0);
+  }
+
+private:
+  unsigned m_state;
+};
+
+/**
+One measured operation. Inputs are prepared in the constructor, so run()
+only contains the work being measured.
+*/
+class MicroBenchmark
+{
+public:
+  MicroBenchmark(const std::string &name, unsigned long bytesPerOp)
+    : m_name(name), m_bytesPerOp(bytesPerOp) {}
+  virtual ~MicroBenchmark() {}
+
+  virtual void run() = 0;
+
+  const std::string &name() const
+  {
+    return m_name;
+  }
+  unsigned long bytesPerOp() const
+  {
+    return m_bytesPerOp;
+  }
+
+private:
+  MicroBenchmark(const MicroBenchmark &);
+  MicroBenchmark &operator=(const MicroBenchmark &);
+
+  const std::string m_name;
+  // input bytes consumed by one operation, 0 if not meaningful
+  const unsigned long m_bytesPerOp;
+};
+
+/** Gives access to the protected reading helpers of CommonParser. */
+class ExposedParser : public libcdr::CommonParser
+{
+public:
+  ExposedParser(libcdr::CDRCollector *collector, libcdr::CoordinatePrecision precision)
+    : libcdr::CommonParser(collector)
+  {
+    m_precision = precision;
+  }
+
+  using libcdr::CommonParser::readCoordinate;
+  using libcdr::CommonParser::processPath;
+};
+
+std::vector<unsigned char> randomBytes(unsigned long size, unsigned seed)
+{
+  Random random(seed);
+  std::vector<unsigned char> bytes(size);
+  for (auto &byte : bytes)
+    byte = (unsigned char)random.next();
+  return bytes;
+}
+
+class InflateBenchmark : public MicroBenchmark
+{
+public:
+  InflateBenchmark(const std::vector<unsigned char> &compressed, unsigned long uncompressedSize)
+    : MicroBenchmark("CDRInternalStream/inflate", uncompressedSize)
+    , m_compressed(compressed) {}
+
+  void run() override
+  {
+    librevenge::RVNGStringStream input(&m_compressed[0], (unsigned)m_compressed.size());
+    libcdr::CDRInternalStream stream(&input, (unsigned long)m_compressed.size(), true);
+    g_sink = g_sink + (stream.isEnd() ? 0.0 : 1.0);
+  }
+
+private:
+  const std::vector<unsigned char> m_compressed;
+};
+
+class ReadU32Benchmark : public MicroBenchmark
+{
+public:
+  explicit ReadU32Benchmark(unsigned count)
+    : MicroBenchmark("readU32/" + std::to_string(count), 4UL * count)
+    , m_count(count), m_stream(randomBytes(4UL * count, 1)) {}
+
+  void run() override
+  {
+    m_stream.seek(0, librevenge::RVNG_SEEK_SET);
+    unsigned sum = 0;
+    for (unsigned i = 0; i < m_count; ++i)
+      sum += libcdr::readU32(&m_stream);
+    g_sink = g_sink + sum;
+  }
+
+private:
+  const unsigned m_count;
+  libcdr::CDRInternalStream m_stream;
+};
+
+class ReadCoordinateBenchmark : public MicroBenchmark
+{
+public:
+  ReadCoordinateBenchmark(libcdr::CoordinatePrecision precision, unsigned count)
+    : MicroBenchmark(std::string("readCoordinate/") + (precision == libcdr::PRECISION_16BIT ? "16bit/" : "32bit/") + std::to_string(count),
+                     (precision == libcdr::PRECISION_16BIT ? 2UL : 4UL) * count)
+    , m_count(count), m_ps(), m_collector(m_ps), m_parser(&m_collector, precision)
+    , m_stream(randomBytes((precision == libcdr::PRECISION_16BIT ? 2UL : 4UL) * count, 2)) {}
+
+  void run() override
+  {
+    m_stream.seek(0, librevenge::RVNG_SEEK_SET);
+    double sum = 0.0;
+    for (unsigned i = 0; i < m_count; ++i)
+      sum += m_parser.readCoordinate(&m_stream);
+    g_sink = g_sink + sum;
+  }
+
+private:
+  const unsigned m_count;
+  libcdr::CDRParserState m_ps;
+  libcdr::CDRStylesCollector m_collector;
+  ExposedParser m_parser;
+  libcdr::CDRInternalStream m_stream;
+};
+
+class ProcessPathBenchmark : public MicroBenchmark
+{
+public:
+  explicit ProcessPathBenchmark(unsigned nodes)
+    : MicroBenchmark("CommonParser::processPath/" + std::to_string(nodes), 0)
+    , m_ps(), m_collector(m_ps), m_parser(&m_collector, libcdr::PRECISION_32BIT)
+    , m_points(), m_types()
+  {
+    // a closed outline of lines and cubic curves, like the curves in real documents
+    Random random(3);
+    m_points.push_back(std::make_pair(random.nextDouble(0.0, 8.0), random.nextDouble(0.0, 10.0)));
+    m_types.push_back(0x00);
+    while (m_points.size() < nodes)
+    {
+      if (random.next(2))
+      {
+        m_points.push_back(std::make_pair(random.nextDouble(0.0, 8.0), random.nextDouble(0.0, 10.0)));
+        m_types.push_back(0x40);
+      }
+      else
+      {
+        for (unsigned i = 0; i < 3; ++i)
+          m_points.push_back(std::make_pair(random.nextDouble(0.0, 8.0), random.nextDouble(0.0, 10.0)));
+        m_types.push_back(0xc0);
+        m_types.push_back(0xc0);
+        m_types.push_back(0x80);
+      }
+    }
+    m_types.back() |= 0x08;
+  }
+
+  void run() override
+  {
+    libcdr::CDRPath path;
+    m_parser.processPath(m_points, m_types, path);
+    g_sink = g_sink + path.size();
+  }
+
+private:
+  libcdr::CDRParserState m_ps;
+  libcdr::CDRStylesCollector m_collector;
+  ExposedParser m_parser;
+  libcdr::CDRPointVector m_points;
+  libcdr::CDRPointTypeVector m_types;
+};
+
+class SplineBenchmark : public MicroBenchmark
+{
+public:
+  explicit SplineBenchmark(unsigned controlPoints)
+    : MicroBenchmark("CDRSplineToElement::writeOut/" + std::to_string(controlPoints), 0)
+    , m_points()
+  {
+    Random random(4);
+    for (unsigned i = 0; i < controlPoints; ++i)
+      m_points.push_back(std::make_pair(random.nextDouble(0.0, 8.0), random.nextDouble(0.0, 10.0)));
+  }
+
+  void run() override
+  {
+    // every element is written out once, so the decomposition is part of the cost
+    libcdr::CDRPath path;
+    path.appendSplineTo(m_points);
+    librevenge::RVNGPropertyListVector vec;
+    path.writeOut(vec);
+    g_sink = g_sink + vec.count();
+  }
+
+private:
+  std::vector<std::pair<double, double> > m_points;
+};
+
+class ApplyToArcBenchmark : public MicroBenchmark
+{
+public:
+  explicit ApplyToArcBenchmark(unsigned count)
+    : MicroBenchmark("CDRTransforms::applyToArc/" + std::to_string(count), 0)
+    , m_transforms(), m_arcs()
+  {
+    const double angle = M_PI / 7.0;
+    m_transforms.append(1.5 * cos(angle), -1.5 * sin(angle), 0.25, 0.75 * sin(angle), 0.75 * cos(angle), 0.5);
+    m_transforms.append(-1.0, 0.0, 8.5, 0.0, 1.0, 0.0);
+    Random random(5);
+    for (unsigned i = 0; i < count; ++i)
+    {
+      Arc arc;
+      arc.rx = random.nextDouble(0.1, 2.0);
+      arc.ry = random.nextDouble(0.1, 2.0);
+      arc.rotation = random.nextDouble(0.0, 2.0 * M_PI);
+      arc.sweep = random.next(2) != 0;
+      arc.x = random.nextDouble(0.0, 8.0);
+      arc.y = random.nextDouble(0.0, 10.0);
+      m_arcs.push_back(arc);
+    }
+  }
+
+  void run() override
+  {
+    double sum = 0.0;
+    for (const auto &arc : m_arcs)
+    {
+      double rx = arc.rx;
+      double ry = arc.ry;
+      double rotation = arc.rotation;
+      bool sweep = arc.sweep;
+      double x = arc.x;
+      double y = arc.y;
+      m_transforms.applyToArc(rx, ry, rotation, sweep, x, y);
+      sum += rx + ry + rotation + x + y + (sweep ? 1.0 : 0.0);
+    }
+    g_sink = g_sink + sum;
+  }
+
+private:
+  struct Arc
+  {
+    double rx;
+    double ry;
+    double rotation;
+    bool sweep;
+    double x;
+    double y;
+  };
+
+  libcdr::CDRTransforms m_transforms;
+  std::vector<Arc> m_arcs;
+};
+
+class ColorBenchmark : public MicroBenchmark
+{
+public:
+  ColorBenchmark(const char *modelName, unsigned short colorModel, unsigned count)
+    : MicroBenchmark(std::string("CDRParserState::_getRGBColor/") + modelName + "/" + std::to_string(count), 0)
+    , m_ps(), m_colors()
+  {
+    Random random(6);
+    for (unsigned i = 0; i < count; ++i)
+    {
+      // Pantone colours are an index into the palette and a tint
+      const unsigned value = colorModel ? random.next() : (random.next(0x7ff) | (random.next(101) << 16));
+      m_colors.push_back(libcdr::CDRColor(colorModel, value));
+    }
+  }
+
+  void run() override
+  {
+    unsigned sum = 0;
+    for (const auto &color : m_colors)
+      sum += m_ps._getRGBColor(color);
+    g_sink = g_sink + sum;
+  }
+
+private:
+  libcdr::CDRParserState m_ps;
+  std::vector<libcdr::CDRColor> m_colors;
+};
+
+class BitmapBenchmark : public MicroBenchmark
+{
+public:
+  BitmapBenchmark(const char *modelName, unsigned colorModel, unsigned bpp, unsigned width, unsigned height)
+    : MicroBenchmark(std::string("CDRStylesCollector::collectBmp/") + modelName + "/" + std::to_string(width) + "x" + std::to_string(height),
+                     bitmapSize(width, height, bpp))
+    , m_ps(), m_collector(m_ps), m_colorModel(colorModel), m_bpp(bpp)
+    , m_width(width), m_height(height), m_palette(), m_bitmap(randomBytes(bitmapSize(width, height, bpp), 7))
+  {
+    if (bpp < 24 && colorModel != 5 && colorModel != 6)
+    {
+      Random random(8);
+      for (unsigned i = 0; i < 256; ++i)
+        m_palette.push_back(random.next() & 0xffffff);
+    }
+  }
+
+  void run() override
+  {
+    // identical images are only converted once, so forget the previous one
+    m_ps.m_bmps.clear();
+    m_ps.m_bmpIds.clear();
+    m_ps.forgetBmpKeys();
+    m_collector.collectBmp(1, m_colorModel, m_width, m_height, m_bpp, m_palette, m_bitmap);
+    g_sink = g_sink + m_ps.m_bmps.size();
+  }
+
+private:
+  // rows are padded to 4 bytes
+  static unsigned long bitmapSize(unsigned width, unsigned height, unsigned bpp)
+  {
+    return ((unsigned long)width * bpp + 31) / 32 * 4 * height;
+  }
+
+  libcdr::CDRParserState m_ps;
+  libcdr::CDRStylesCollector m_collector;
+  const unsigned m_colorModel;
+  const unsigned m_bpp;
+  const unsigned m_width;
+  const unsigned m_height;
+  std::vector<unsigned> m_palette;
+  std::vector<unsigned char> m_bitmap;
+};
+
+/** Text in a legacy 8-bit encoding, or UTF-16 if the charset is negative. */
+class AppendCharactersBenchmark : public MicroBenchmark
+{
+public:
+  AppendCharactersBenchmark(const char *charsetName, int charset, const std::vector<unsigned char> &characters)
+    : MicroBenchmark(std::string("appendCharacters/") + charsetName + "/" + std::to_string(characters.size()), characters.size())
+    , m_charset(charset), m_characters(characters) {}
+
+  void run() override
+  {
+    librevenge::RVNGString text;
+    if (m_charset < 0)
+      libcdr::appendCharacters(text, m_characters);
+    else
+      libcdr::appendCharacters(text, m_characters, (unsigned short)m_charset);
+    g_sink = g_sink + text.size();
+  }
+
+private:
+  const int m_charset;
+  const std::vector<unsigned char> m_characters;
+};
+
+std::vector<unsigned char> generateText(unsigned long size, unsigned char low, unsigned char high, unsigned seed)
+{
+  Random random(seed);
+  std::vector<unsigned char> text;
+  text.reserve(size);
+  while (text.size() < size)
+  {
+    // words separated by spaces
+    const unsigned length = 2 + random.next(8);
+    for (unsigned i = 0; i < length && text.size() + 1 < size; ++i)
+      text.push_back((unsigned char)(low + random.next(high - low + 1)));
+    text.push_back(' ');
+  }
+  return text;
+}
+
+std::vector<unsigned char> generateDoubleByteText(unsigned long size, unsigned char leadLow, unsigned char leadHigh,
+                                                  unsigned char trailLow, unsigned char trailHigh, unsigned seed)
+{
+  Random random(seed);
+  std::vector<unsigned char> text;
+  text.reserve(size);
+  while (text.size() + 1 < size)
+  {
+    text.push_back((unsigned char)(leadLow + random.next(leadHigh - leadLow + 1)));
+    text.push_back((unsigned char)(trailLow + random.next(trailHigh - trailLow + 1)));
+  }
+  return text;
+}
+
+std::vector<unsigned char> generateUTF16Text(unsigned long size, unsigned seed)
+{
+  Random random(seed);
+  std::vector<unsigned char> text;
+  text.reserve(size);
+  while (text.size() + 1 < size)
+  {
+    // mostly Latin with some Cyrillic
+    const unsigned c = random.next(4) ? 0x61 + random.next(26) : 0x430 + random.next(32);
+    text.push_back((unsigned char)(c & 0xff));
+    text.push_back((unsigned char)(c >> 8));
+  }
+  return text;
+}
+
+std::vector<std::unique_ptr<MicroBenchmark> > createBenchmarks()
+{
+  std::vector<std::unique_ptr<MicroBenchmark> > benchmarks;
+
+  cdrsynthetic::SyntheticDocumentParams params;
+  params.pages = 1;
+  params.objectsPerPage = 2000;
+  const cdrsynthetic::SyntheticDocument document = cdrsynthetic::generateCDR(params);
+  uLongf compressedSize = compressBound((uLong)document.data.size());
+  std::vector<unsigned char> compressed(compressedSize);
+  if (compress2(&compressed[0], &compressedSize, &document.data[0], (uLong)document.data.size(), Z_DEFAULT_COMPRESSION) == Z_OK)
+  {
+    compressed.resize(compressedSize);
+    benchmarks.push_back(std::unique_ptr<MicroBenchmark>(new InflateBenchmark(compressed, document.data.size())));
+  }
+
+  benchmarks.push_back(std::unique_ptr<MicroBenchmark>(new ReadU32Benchmark(1024)));
+  benchmarks.push_back(std::unique_ptr<MicroBenchmark>(new ReadCoordinateBenchmark(libcdr::PRECISION_16BIT, 1024)));
+  benchmarks.push_back(std::unique_ptr<MicroBenchmark>(new ReadCoordinateBenchmark(libcdr::PRECISION_32BIT, 1024)));
+  benchmarks.push_back(std::unique_ptr<MicroBenchmark>(new ProcessPathBenchmark(32)));
+  benchmarks.push_back(std::unique_ptr<MicroBenchmark>(new ProcessPathBenchmark(2000)));
+  benchmarks.push_back(std::unique_ptr<MicroBenchmark>(new SplineBenchmark(16)));
+  benchmarks.push_back(std::unique_ptr<MicroBenchmark>(new SplineBenchmark(256)));
+  benchmarks.push_back(std::unique_ptr<MicroBenchmark>(new ApplyToArcBenchmark(1024)));
+
+  const struct
+  {
+    const char *name;
+    unsigned short model;
+  } colorModels[] =
+  {
+    { "pantone", 0x00 },
+    { "cmyk", 0x02 },
+    { "cmyk255", 0x03 },
+    { "cmy", 0x04 },
+    { "rgb", 0x05 },
+    { "hsb", 0x06 },
+    { "hls", 0x07 },
+    { "bw", 0x08 },
+    { "gray", 0x09 },
+    { "yiq", 0x0b },
+    { "lab", 0x12 },
+    { "registration", 0x14 }
+  };
+  for (const auto &colorModel : colorModels)
+    benchmarks.push_back(std::unique_ptr<MicroBenchmark>(new ColorBenchmark(colorModel.name, colorModel.model, 1024)));
+
+  // the combinations readRImage produces for the supported image types
+  const struct
+  {
+    const char *name;
+    unsigned model;
+    unsigned bpp;
+  } bitmapTypes[] =
+  {
+    { "rgb24", 1, 24 },
+    { "cmyk32", 2, 32 },
+    { "gray8", 5, 8 },
+    { "bw1", 6, 1 },
+    { "palette8", 1, 8 }
+  };
+  for (const auto &bitmapType : bitmapTypes)
+    benchmarks.push_back(std::unique_ptr<MicroBenchmark>(new BitmapBenchmark(bitmapType.name, bitmapType.model, bitmapType.bpp, 256, 256)));
+
+  const unsigned long textSize = 4096;
+  // charset 0 makes appendCharacters guess the encoding first
+  benchmarks.push_back(std::unique_ptr<MicroBenchmark>(new AppendCharactersBenchmark("detect", 0x00, generateText(textSize, 0x41, 0x7a, 9))));
+  benchmarks.push_back(std::unique_ptr<MicroBenchmark>(new AppendCharactersBenchmark("cp1252", 0x01, generateText(textSize, 0x41, 0x7a, 9))));
+  benchmarks.push_back(std::unique_ptr<MicroBenchmark>(new AppendCharactersBenchmark("cp1250", 0xee, generateText(textSize, 0xc0, 0xfe, 10))));
+  benchmarks.push_back(std::unique_ptr<MicroBenchmark>(new AppendCharactersBenchmark("cp1251", 0xcc, generateText(textSize, 0xc0, 0xff, 11))));
+  benchmarks.push_back(std::unique_ptr<MicroBenchmark>(new AppendCharactersBenchmark("cp1253", 0xa1, generateText(textSize, 0xc1, 0xf9, 12))));
+  benchmarks.push_back(std::unique_ptr<MicroBenchmark>(new AppendCharactersBenchmark("symbol", 0x02, generateText(textSize, 0x41, 0x7a, 13))));
+  benchmarks.push_back(std::unique_ptr<MicroBenchmark>(new AppendCharactersBenchmark("shift-jis", 0x80, generateDoubleByteText(textSize, 0x88, 0x9f, 0x40, 0x7e, 14))));
+  benchmarks.push_back(std::unique_ptr<MicroBenchmark>(new AppendCharactersBenchmark("gb2312", 0x86, generateDoubleByteText(textSize, 0xb0, 0xf7, 0xa1, 0xfe, 15))));
+  benchmarks.push_back(std::unique_ptr<MicroBenchmark>(new AppendCharactersBenchmark("utf-16", -1, generateUTF16Text(textSize, 16))));
+
+  return benchmarks;
+}
+
+struct Measurement
+{
+  double nanoseconds;
+  double allocations;
+  double allocatedBytes;
+};
+
+double runBatch(MicroBenchmark &benchmark, unsigned long iterations)
+{
+  const auto start = std::chrono::steady_clock::now();
+  for (unsigned long i = 0; i < iterations; ++i)
+    benchmark.run();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+Measurement measure(MicroBenchmark &benchmark, double minSeconds, unsigned repetitions)
+{
+  benchmark.run();
+
+  // grow the batch until it takes long enough to time reliably
+  unsigned long iterations = 1;
+  double seconds = runBatch(benchmark, iterations);
+  while (seconds < minSeconds && iterations < (1UL << 30))
+  {
+    const double factor = seconds > 0.0 ? 1.2 * minSeconds / seconds : 100.0;
+    iterations = (unsigned long)std::ceil(iterations * (factor < 100.0 ? (factor > 2.0 ? factor : 2.0) : 100.0));
+    seconds = runBatch(benchmark, iterations);
+  }
+
+  const unsigned long allocations = cdrbench::allocationCount();
+  const unsigned long long allocatedBytes = cdrbench::allocatedBytes();
+  for (unsigned i = 0; i < repetitions; ++i)
+  {
+    const double batch = runBatch(benchmark, iterations);
+    if (batch < seconds)
+      seconds = batch;
+  }
+
+  Measurement result;
+  result.nanoseconds = seconds * 1e9 / iterations;
+  result.allocations = (double)(cdrbench::allocationCount() - allocations) / ((double)iterations * repetitions);
+  result.allocatedBytes = (double)(cdrbench::allocatedBytes() - allocatedBytes) / ((double)iterations * repetitions);
+  return result;
+}
+
+bool matches(const std::string &name, const std::vector<const char *> &filters)
+{
+  if (filters.empty())
+    return true;
+  for (const char *filter : filters)
+  {
+    if (name.find(filter) != std::string::npos)
+      return true;
+  }
+  return false;
+}
+
+int printUsage()
+{
+  printf("`cdrmicrobench' measures individual parsing and conversion routines of libcdr.\n");
+  printf("\n");
+  printf("Usage: cdrmicrobench [OPTION]... [FILTER]...\n");
+  printf("\n");
+  printf("Only benchmarks whose name contains one of the FILTERs are run.\n");
+  printf("\n");
+  printf("Options:\n");
+  printf("\t--time MS             minimal duration of a measured batch (default 200)\n");
+  printf("\t--repetitions N       number of measured batches, the fastest counts (default 3)\n");
+  printf("\t--list                list the benchmarks and exit\n");
+  printf("\t--help                show this help message\n");
+  printf("\t--version             show version information and exit\n");
+  printf("\n");
+  printf("Report bugs to <https://bugs.documentfoundation.org/>.\n");
+  return -1;
+}
+
+int printVersion()
+{
+  printf("cdrmicrobench " VERSION "\n");
+  return 0;
+}
+
+} // anonymous namespace
+
+int main(int argc, char *argv[])
+{
+  unsigned long minMilliseconds = 200;
+  unsigned long repetitions = 3;
+  bool list = false;
+  std::vector<const char *> filters;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "--help"))
+      return printUsage();
+    else if (!strcmp(argv[i], "--version"))
+      return printVersion();
+    else if (!strcmp(argv[i], "--list"))
+      list = true;
+    else if (!strcmp(argv[i], "--time") && i + 1 < argc)
+      minMilliseconds = strtoul(argv[++i], nullptr, 10);
+    else if (!strcmp(argv[i], "--repetitions") && i + 1 < argc)
+      repetitions = strtoul(argv[++i], nullptr, 10);
+    else if (argv[i][0] == '-')
+      return printUsage();
+    else
+      filters.push_back(argv[i]);
+  }
+  if (!repetitions)
+    repetitions = 1;
+
+  const std::vector<std::unique_ptr<MicroBenchmark> > benchmarks = createBenchmarks();
+  if (list)
+  {
+    for (const auto &benchmark : benchmarks)
+      printf("%s\n", benchmark->name().c_str());
+    return 0;
+  }
+
+  printf("%-50s %12s %10s %10s %12s\n", "benchmark", "ns/op", "MB/s", "allocs/op", "B/op");
+  for (const auto &benchmark : benchmarks)
+  {
+    if (!matches(benchmark->name(), filters))
+      continue;
+    const Measurement result = measure(*benchmark, minMilliseconds / 1000.0, (unsigned)repetitions);
+    if (benchmark->bytesPerOp() && result.nanoseconds > 0.0)
+      printf("%-50s %12.1f %10.1f %10.1f %12.1f\n", benchmark->name().c_str(), result.nanoseconds,
+             benchmark->bytesPerOp() * 1000.0 / result.nanoseconds, result.allocations, result.allocatedBytes);
+    else
+      printf("%-50s %12.1f %10s %10.1f %12.1f\n", benchmark->name().c_str(), result.nanoseconds,
+             "-", result.allocations, result.allocatedBytes);
+    fflush(stdout);
+  }
+  return 0;
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
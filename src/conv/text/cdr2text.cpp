@@ -71,6 +71,8 @@ int main(int argc, char *argv[])
   librevenge::RVNGFileStream input(file);
   librevenge::RVNGStringVector pages;
   librevenge::RVNGTextDrawingGenerator painter(pages);
+  libcdr::CDRParseOptions options;
+  options.setTextOnly(true);
 
   if (!libcdr::CDRDocument::isSupported(&input))
   {
@@ -79,13 +81,13 @@ int main(int argc, char *argv[])
       fprintf(stderr, "ERROR: Unsupported file format (unsupported version) or file is encrypted!\n");
       return 1;
     }
-    else if (!libcdr::CMXDocument::parse(&input, &painter))
+    else if (libcdr::CMXDocument::parseWithOptions(&input, &painter, options) != libcdr::CDR_PARSE_SUCCESS)
     {
       fprintf(stderr, "ERROR: Parsing of document failed!\n");
       return 1;
     }
   }
-  else if (!libcdr::CDRDocument::parse(&input, &painter))
+  else if (libcdr::CDRDocument::parseWithOptions(&input, &painter, options) != libcdr::CDR_PARSE_SUCCESS)
   {
     fprintf(stderr, "ERROR: Parsing of document failed!\n");
     return 1;
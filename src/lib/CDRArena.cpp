@@ -0,0 +1,55 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libcdr project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "CDRArena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+libcdr::CDRArena::CDRArena(std::size_t blockSize)
+  : m_blocks(), m_currentBlock(0), m_offset(0), m_blockSize(blockSize)
+{
+}
+
+libcdr::CDRArena::~CDRArena()
+{
+}
+
+void *libcdr::CDRArena::allocate(std::size_t size, std::size_t alignment)
+{
+  if (!size)
+    size = 1;
+  while (m_currentBlock < m_blocks.size())
+  {
+    const Block &block = m_blocks[m_currentBlock];
+    const auto base = reinterpret_cast<std::uintptr_t>(block.data.get());
+    const std::size_t start = ((base + m_offset + alignment - 1) & ~(std::uintptr_t)(alignment - 1)) - base;
+    if (start <= block.size && size <= block.size - start)
+    {
+      m_offset = start + size;
+      return block.data.get() + start;
+    }
+    ++m_currentBlock;
+    m_offset = 0;
+  }
+  if (size > std::numeric_limits<std::size_t>::max() - alignment)
+    throw std::bad_alloc();
+  m_blocks.push_back(Block(std::max(m_blockSize, size + alignment)));
+  m_currentBlock = m_blocks.size() - 1;
+  m_offset = 0;
+  return allocate(size, alignment);
+}
+
+void libcdr::CDRArena::reset()
+{
+  m_currentBlock = 0;
+  m_offset = 0;
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
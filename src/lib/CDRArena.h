@@ -0,0 +1,109 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libcdr project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef __CDRARENA_H__
+#define __CDRARENA_H__
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace libcdr
+{
+
+/* Monotonic allocator. Memory is handed out from large blocks and only
+   given back all at once by reset(), which keeps the blocks for reuse. */
+class CDRArena
+{
+public:
+  explicit CDRArena(std::size_t blockSize = 64 * 1024);
+  ~CDRArena();
+
+  void *allocate(std::size_t size, std::size_t alignment);
+  void reset();
+
+private:
+  CDRArena(const CDRArena &);
+  CDRArena &operator=(const CDRArena &);
+
+  struct Block
+  {
+    explicit Block(std::size_t blockSize)
+      : data(new unsigned char[blockSize]), size(blockSize) {}
+
+    std::unique_ptr<unsigned char[]> data;
+    std::size_t size;
+  };
+
+  std::vector<Block> m_blocks;
+  std::size_t m_currentBlock;
+  std::size_t m_offset;
+  const std::size_t m_blockSize;
+};
+
+/* Standard allocator on top of CDRArena. Without an arena it falls back
+   to the global operator new, so containers using it behave like plain
+   standard containers when arenas are not enabled. */
+template<typename T>
+class CDRArenaAllocator
+{
+public:
+  typedef T value_type;
+
+  CDRArenaAllocator() noexcept : m_arena(nullptr) {}
+  explicit CDRArenaAllocator(CDRArena *arena) noexcept : m_arena(arena) {}
+  template<typename U>
+  CDRArenaAllocator(const CDRArenaAllocator<U> &other) noexcept : m_arena(other.getArena()) {}
+
+  T *allocate(std::size_t n)
+  {
+    if (n > std::numeric_limits<std::size_t>::max() / sizeof(T))
+      throw std::bad_alloc();
+    if (!m_arena)
+      return static_cast<T *>(::operator new(n * sizeof(T)));
+    return static_cast<T *>(m_arena->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T *p, std::size_t) noexcept
+  {
+    if (!m_arena)
+      ::operator delete(p);
+  }
+
+  CDRArena *getArena() const noexcept
+  {
+    return m_arena;
+  }
+
+private:
+  CDRArena *m_arena;
+};
+
+template<typename T, typename U>
+bool operator==(const CDRArenaAllocator<T> &left, const CDRArenaAllocator<U> &right) noexcept
+{
+  return left.getArena() == right.getArena();
+}
+
+template<typename T, typename U>
+bool operator!=(const CDRArenaAllocator<T> &left, const CDRArenaAllocator<U> &right) noexcept
+{
+  return !(left == right);
+}
+
+typedef std::vector<std::pair<double, double>, CDRArenaAllocator<std::pair<double, double> > > CDRPointVector;
+typedef std::vector<unsigned char, CDRArenaAllocator<unsigned char> > CDRPointTypeVector;
+
+} // namespace libcdr
+
+#endif // __CDRARENA_H__
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
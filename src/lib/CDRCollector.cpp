@@ -17,9 +17,10 @@
 #include "libcdr_utils.h"
 
 libcdr::CDRParserState::CDRParserState()
-  : m_bmps(), m_patterns(), m_vects(), m_pages(), m_documentPalette(), m_texts(),
+  : m_bmps(), m_pendingBmps(), m_bmpIds(), m_bmpKeys(), m_patterns(), m_vects(), m_pages(), m_documentPalette(), m_texts(),
     m_styles(), m_fillStyles(), m_lineStyles(),
-    m_colorTransformCMYK2RGB(nullptr), m_colorTransformLab2RGB(nullptr), m_colorTransformRGB2RGB(nullptr)
+    m_colorTransformCMYK2RGB(nullptr), m_colorTransformLab2RGB(nullptr), m_colorTransformRGB2RGB(nullptr),
+    m_colorTransformGeneration(0)
 {
   cmsHPROFILE tmpRGBProfile = cmsCreate_sRGBProfile();
   m_colorTransformRGB2RGB = cmsCreateTransform(tmpRGBProfile, TYPE_RGB_8, tmpRGBProfile, TYPE_RGB_8, INTENT_PERCEPTUAL, 0);
@@ -58,6 +59,7 @@ void libcdr::CDRParserState::setColorTransform(const std::vector<unsigned char>
     if (m_colorTransformCMYK2RGB)
       cmsDeleteTransform(m_colorTransformCMYK2RGB);
     m_colorTransformCMYK2RGB = cmsCreateTransform(tmpProfile, TYPE_CMYK_DBL, tmpRGBProfile, TYPE_RGB_8, INTENT_PERCEPTUAL, 0);
+    ++m_colorTransformGeneration;
   }
   break;
   case cmsSigRgbData:
@@ -65,6 +67,7 @@ void libcdr::CDRParserState::setColorTransform(const std::vector<unsigned char>
     if (m_colorTransformRGB2RGB)
       cmsDeleteTransform(m_colorTransformRGB2RGB);
     m_colorTransformRGB2RGB = cmsCreateTransform(tmpProfile, TYPE_RGB_8, tmpRGBProfile, TYPE_RGB_8, INTENT_PERCEPTUAL, 0);
+    ++m_colorTransformGeneration;
   }
   break;
   default:
@@ -120,6 +123,57 @@ unsigned libcdr::CDRParserState::getBMPColor(const CDRColor &color)
   }
 }
 
+void libcdr::CDRParserState::getBMPColors(unsigned short colorModel, std::vector<unsigned> &colors)
+{
+  if (colors.empty())
+    return;
+  const size_t count = colors.size();
+  switch (colorModel)
+  {
+  // RGB, passed to the color transform in one go
+  case 1:
+  case 10:
+  {
+    std::vector<unsigned char> input(count * 3);
+    std::vector<unsigned char> output(count * 3);
+    for (size_t i = 0; i < count; ++i)
+    {
+      input[i * 3] = (unsigned char)((colors[i] >> 16) & 0xff);
+      input[i * 3 + 1] = (unsigned char)((colors[i] >> 8) & 0xff);
+      input[i * 3 + 2] = (unsigned char)(colors[i] & 0xff);
+    }
+    cmsDoTransform(m_colorTransformRGB2RGB, &input[0], &output[0], (cmsUInt32Number)count);
+    for (size_t i = 0; i < count; ++i)
+      colors[i] = ((unsigned)output[i * 3] << 16) | ((unsigned)output[i * 3 + 1] << 8) | (unsigned)output[i * 3 + 2];
+    break;
+  }
+  // CMYK 255, passed to the color transform in one go
+  case 3:
+  {
+    std::vector<double> input(count * 4);
+    std::vector<unsigned char> output(count * 3);
+    for (size_t i = 0; i < count; ++i)
+    {
+      for (unsigned k = 0; k < 4; ++k)
+        input[i * 4 + k] = (double)((colors[i] >> (8 * k)) & 0xff)*100.0/255.0;
+    }
+    cmsDoTransform(m_colorTransformCMYK2RGB, &input[0], &output[0], (cmsUInt32Number)count);
+    for (size_t i = 0; i < count; ++i)
+      colors[i] = ((unsigned)output[i * 3] << 16) | ((unsigned)output[i * 3 + 1] << 8) | (unsigned)output[i * 3 + 2];
+    break;
+  }
+  case 8:
+  case 9:
+    break;
+  default:
+    if (colorModel > 11)
+      break;
+    for (size_t i = 0; i < count; ++i)
+      colors[i] = getBMPColor(CDRColor(colorModel, colors[i]));
+    break;
+  }
+}
+
 unsigned libcdr::CDRParserState::_getRGBColor(const CDRColor &color)
 {
   unsigned char red = 0;
@@ -615,4 +669,108 @@ void libcdr::CDRParserState::getRecursedStyle(CDRStyle &style, unsigned styleId)
   }
 }
 
+unsigned libcdr::CDRParserState::getColorTransformGeneration() const
+{
+  return m_colorTransformGeneration;
+}
+
+bool libcdr::CDRParserState::shareBmp(unsigned imageId, const CDRBmpKey &key)
+{
+  auto iterKey = m_bmpKeys.find(key);
+  if (iterKey == m_bmpKeys.end())
+    return false;
+  const unsigned sourceId = iterKey->second;
+  auto iterBmp = m_bmps.find(sourceId);
+  if (iterBmp != m_bmps.end())
+  {
+    // copies of RVNGBinaryData share the same buffer
+    m_bmps[imageId] = iterBmp->second;
+    m_pendingBmps.erase(imageId);
+  }
+  else
+  {
+    auto iterPending = m_pendingBmps.find(sourceId);
+    if (iterPending == m_pendingBmps.end())
+      return false;
+    m_pendingBmps[imageId] = iterPending->second;
+    m_bmps.erase(imageId);
+  }
+  m_bmpIds[imageId] = sourceId;
+  return true;
+}
+
+void libcdr::CDRParserState::_forgetBmp(unsigned imageId)
+{
+  if (m_bmps.find(imageId) == m_bmps.end() && m_pendingBmps.find(imageId) == m_pendingBmps.end())
+    return;
+  // The id is redefined; images that were found to be equal to its
+  // old content must not be reported as the same image any more.
+  for (auto &bmpId : m_bmpIds)
+  {
+    if (bmpId.second == imageId)
+      bmpId.second = bmpId.first;
+  }
+  for (auto iter = m_bmpKeys.begin(); iter != m_bmpKeys.end();)
+  {
+    if (iter->second == imageId)
+      iter = m_bmpKeys.erase(iter);
+    else
+      ++iter;
+  }
+  m_bmps.erase(imageId);
+  m_pendingBmps.erase(imageId);
+}
+
+void libcdr::CDRParserState::insertBmp(unsigned imageId, const CDRBmpKey &key, const librevenge::RVNGBinaryData &image)
+{
+  _forgetBmp(imageId);
+  m_bmps[imageId] = image;
+  m_bmpIds[imageId] = imageId;
+  m_bmpKeys[key] = imageId;
+}
+
+void libcdr::CDRParserState::insertBmp(unsigned imageId, const CDRBmpKey &key, const std::shared_future<librevenge::RVNGBinaryData> &image)
+{
+  _forgetBmp(imageId);
+  m_pendingBmps[imageId] = image;
+  m_bmpIds[imageId] = imageId;
+  m_bmpKeys[key] = imageId;
+}
+
+const librevenge::RVNGBinaryData *libcdr::CDRParserState::getBmp(unsigned imageId)
+{
+  auto iterPending = m_pendingBmps.find(imageId);
+  if (iterPending != m_pendingBmps.end())
+  {
+    // rethrows an interruption of the conversion
+    const librevenge::RVNGBinaryData &image = iterPending->second.get();
+    if (!image.empty())
+      m_bmps[imageId] = image;
+    m_pendingBmps.erase(iterPending);
+  }
+  auto iter = m_bmps.find(imageId);
+  if (iter == m_bmps.end())
+    return nullptr;
+  return &iter->second;
+}
+
+void libcdr::CDRParserState::forgetBmpKeys()
+{
+  m_bmpKeys.clear();
+}
+
+void libcdr::CDRParserState::waitForBmps() const
+{
+  for (const auto &pending : m_pendingBmps)
+    pending.second.wait();
+}
+
+unsigned libcdr::CDRParserState::getBmpId(unsigned imageId) const
+{
+  auto iter = m_bmpIds.find(imageId);
+  if (iter != m_bmpIds.end())
+    return iter->second;
+  return imageId;
+}
+
 /* vim:set shiftwidth=2 softtabstop=2 expandtab: */
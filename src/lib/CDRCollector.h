@@ -10,7 +10,9 @@
 #ifndef __CDRCOLLECTOR_H__
 #define __CDRCOLLECTOR_H__
 
+#include <future>
 #include <map>
+#include <tuple>
 #include <utility>
 #include <vector>
 
@@ -27,12 +29,44 @@ namespace libcdr
 class CDRPath;
 class CDRTransforms;
 
+/* Identifies the data an image was converted from by its parameters and
+   a 128-bit hash of the palette and pixels, so that the data itself need
+   not be kept to recognize it again */
+struct CDRBmpKey
+{
+  // of the color transforms used for the conversion; 0 for embedded image files
+  unsigned colorTransformGeneration;
+  unsigned colorModel;
+  unsigned width;
+  unsigned height;
+  unsigned bpp;
+  unsigned long paletteSize;
+  unsigned long size;
+  uint64_t hash1;
+  uint64_t hash2;
+  CDRBmpKey()
+    : colorTransformGeneration(0), colorModel(0), width(0), height(0), bpp(0), paletteSize(0), size(0), hash1(0), hash2(0) {}
+  CDRBmpKey(unsigned generation, unsigned cm, unsigned w, unsigned h, unsigned b, unsigned long ps, unsigned long s, uint64_t h1, uint64_t h2)
+    : colorTransformGeneration(generation), colorModel(cm), width(w), height(h), bpp(b), paletteSize(ps), size(s), hash1(h1), hash2(h2) {}
+  bool operator<(const CDRBmpKey &other) const
+  {
+    return std::tie(colorTransformGeneration, colorModel, width, height, bpp, paletteSize, size, hash1, hash2)
+           < std::tie(other.colorTransformGeneration, other.colorModel, other.width, other.height, other.bpp, other.paletteSize, other.size, other.hash1, other.hash2);
+  }
+};
+
 class CDRParserState
 {
 public:
   CDRParserState();
   ~CDRParserState();
   std::map<unsigned, librevenge::RVNGBinaryData> m_bmps;
+  // images that are still being converted; moved to m_bmps when they are needed
+  std::map<unsigned, std::shared_future<librevenge::RVNGBinaryData> > m_pendingBmps;
+  // image id -> id of the first image with the same content
+  std::map<unsigned, unsigned> m_bmpIds;
+  // key of the content -> id of the first image with that content
+  std::map<CDRBmpKey, unsigned> m_bmpKeys;
   std::map<unsigned, CDRPattern> m_patterns;
   std::map<unsigned, librevenge::RVNGBinaryData> m_vects;
   std::vector<CDRPage> m_pages;
@@ -44,6 +78,8 @@ public:
 
   unsigned _getRGBColor(const CDRColor &color);
   unsigned getBMPColor(const CDRColor &color);
+  // Converts a row of bitmap pixels in place, same as calling getBMPColor on each of them
+  void getBMPColors(unsigned short colorModel, std::vector<unsigned> &colors);
   librevenge::RVNGString getRGBColorString(const CDRColor &color);
   cmsHTRANSFORM m_colorTransformCMYK2RGB;
   cmsHTRANSFORM m_colorTransformLab2RGB;
@@ -51,9 +87,24 @@ public:
 
   void setColorTransform(const std::vector<unsigned char> &profile);
   void setColorTransform(librevenge::RVNGInputStream *input);
+  // Changes whenever one of the color transforms is replaced
+  unsigned getColorTransformGeneration() const;
   void getRecursedStyle(CDRStyle &style, unsigned styleId);
+  // Reuses an image converted from data with the same key, if there is one
+  bool shareBmp(unsigned imageId, const CDRBmpKey &key);
+  void insertBmp(unsigned imageId, const CDRBmpKey &key, const librevenge::RVNGBinaryData &image);
+  // An empty result of the conversion means that the image could not be converted
+  void insertBmp(unsigned imageId, const CDRBmpKey &key, const std::shared_future<librevenge::RVNGBinaryData> &image);
+  // Drops the keys kept for shareBmp once no more images are collected
+  void forgetBmpKeys();
+  // Returns null if there is no such image; waits for its conversion if needed
+  const librevenge::RVNGBinaryData *getBmp(unsigned imageId);
+  void waitForBmps() const;
+  unsigned getBmpId(unsigned imageId) const;
 
 private:
+  void _forgetBmp(unsigned imageId);
+  unsigned m_colorTransformGeneration;
   CDRParserState(const CDRParserState &);
   CDRParserState &operator=(const CDRParserState &);
 };
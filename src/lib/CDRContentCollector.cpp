@@ -9,11 +9,13 @@
 
 #include "CDRContentCollector.h"
 
+#include <algorithm>
 #include <math.h>
 #include <string.h>
 #include <librevenge/librevenge.h>
 #include <libcdr/libcdr.h>
 #include "CDROutputElementList.h"
+#include "CDRTrace.h"
 #include "libcdr_utils.h"
 
 #ifndef DUMP_PATTERN
@@ -57,20 +59,39 @@ void normalizeAngle(double &angle)
     angle += 360;
 }
 
+/// Whether the line width depends on the transformation of the object.
+bool isLineScaled(const CDRLineStyle &lineStyle)
+{
+  return lineStyle.lineType != (unsigned short)-1 && !(lineStyle.lineType & 0x1)
+         && (lineStyle.lineType & 0x6) && (lineStyle.lineType & 0x20);
+}
+
+/// Options of the nested parse of a vector pattern, which can only be interrupted like the outer parse.
+CDRParseOptions getPatternOptions(const CDRParseOptionsImpl &options)
+{
+  CDRParseOptions patternOptions;
+  patternOptions.setCancelFlag(options.cancelFlag);
+  patternOptions.setDeadline(options.deadline);
+  return patternOptions;
+}
+
 }
 }
 
 libcdr::CDRContentCollector::CDRContentCollector(libcdr::CDRParserState &ps, librevenge::RVNGDrawingInterface *painter,
-                                                 bool reverseOrder)
+                                                 bool reverseOrder, const CDRParseOptionsImpl &options,
+                                                 std::vector<std::unique_ptr<CDRPageIndex> > *pageIndices)
   : m_painter(painter), m_isDocumentStarted(false), m_isPageProperties(false), m_isPageStarted(false),
     m_ignorePage(false), m_page(ps.m_pages[0]), m_pageIndex(0), m_currentFillStyle(), m_currentLineStyle(),
     m_spnd(0), m_currentObjectLevel(0), m_currentGroupLevel(0), m_currentVectLevel(0), m_currentPageLevel(0),
-    m_currentStyleId(0), m_currentImage(), m_currentText(nullptr), m_currentBBox(), m_currentTextBox(), m_currentPath(),
+    m_currentStyleId(0), m_currentStyleKey(), m_styleTemplates(), m_retiredStyleTemplates(), m_currentImage(), m_currentText(nullptr), m_currentBBox(), m_currentTextBox(), m_currentPath(),
     m_currentTransforms(), m_fillTransforms(), m_polygon(), m_isInPolygon(false), m_isInSpline(false),
-    m_outputElementsStack(nullptr), m_contentOutputElementsStack(), m_fillOutputElementsStack(),
+    m_outputElementStorage(options.useArena), m_outputElementsStack(nullptr), m_contentOutputElementsStack(), m_fillOutputElementsStack(),
     m_outputElementsQueue(nullptr), m_contentOutputElementsQueue(), m_fillOutputElementsQueue(),
     m_groupLevels(), m_groupTransforms(), m_splineData(), m_fillOpacity(1.0), m_reverseOrder(reverseOrder),
-    m_ps(ps)
+    m_shareStyles(options.shareStyles), m_instanceGeometry(options.instanceGeometry), m_viewport(options.viewport),
+    m_detailTolerance(options.detailTolerance), m_patternOptions(getPatternOptions(options)), m_geometries(),
+    m_pageIndices(pageIndices), m_ps(ps)
 {
   m_outputElementsStack = &m_contentOutputElementsStack;
   m_outputElementsQueue = &m_contentOutputElementsQueue;
@@ -114,6 +135,8 @@ void libcdr::CDRContentCollector::_startPage(double width, double height)
   librevenge::RVNGPropertyList propList;
   propList.insert("svg:width", width);
   propList.insert("svg:height", height);
+  if (m_pageIndices)
+    m_pageIndices->push_back(std::unique_ptr<CDRPageIndex>(new CDRPageIndex(width, height)));
   if (m_painter)
     m_painter->startPage(propList);
   m_isPageStarted = true;
@@ -123,18 +146,32 @@ void libcdr::CDRContentCollector::_endPage()
 {
   if (!m_isPageStarted)
     return;
+  CDR_TRACE_SPAN(drawSpan, "_endPage");
+  CDR_TRACE_ARG(drawSpan, "objects", m_contentOutputElementsStack.size() + m_contentOutputElementsQueue.size());
+  CDRPageIndex *const pageIndex = m_pageIndices ? m_pageIndices->back().get() : nullptr;
+  unsigned currentStyleId = 0;
   while (!m_contentOutputElementsStack.empty())
   {
-    m_contentOutputElementsStack.top().draw(m_painter);
+    if (pageIndex)
+      pageIndex->addObject(m_contentOutputElementsStack.top());
+    else
+      m_contentOutputElementsStack.top().draw(m_painter, currentStyleId);
     m_contentOutputElementsStack.pop();
   }
   while (!m_contentOutputElementsQueue.empty())
   {
-    m_contentOutputElementsQueue.front().draw(m_painter);
+    if (pageIndex)
+      pageIndex->addObject(m_contentOutputElementsQueue.front());
+    else
+      m_contentOutputElementsQueue.front().draw(m_painter, currentStyleId);
     m_contentOutputElementsQueue.pop();
   }
+  if (pageIndex)
+    pageIndex->finish();
   if (m_painter)
     m_painter->endPage();
+  if (m_fillOutputElementsStack.empty() && m_fillOutputElementsQueue.empty())
+    m_outputElementStorage.clear();
   m_isPageStarted = false;
 }
 
@@ -155,6 +192,7 @@ void libcdr::CDRContentCollector::collectObject(unsigned level)
   m_currentFillStyle = CDRFillStyle();
   m_currentLineStyle = CDRLineStyle();
   m_currentStyleId = 0;
+  m_currentStyleKey = StyleKey();
   m_currentBBox = CDRBox();
 }
 
@@ -162,18 +200,17 @@ void libcdr::CDRContentCollector::collectGroup(unsigned level)
 {
   if (!m_isPageStarted && !m_currentVectLevel && !m_ignorePage)
     _startPage(m_page.width, m_page.height);
-  CDROutputElementList outputElement;
+  CDROutputElementList outputElement(m_outputElementStorage);
   if (m_reverseOrder)
   {
     // Since the CDR objects are drawn in reverse order, reverse the logic of groups too
     outputElement.addEndGroup();
-    m_outputElementsStack->push(outputElement);
+    m_outputElementsStack->push(std::move(outputElement));
   }
   else
   {
-    librevenge::RVNGPropertyList propList;
-    outputElement.addStartGroup(propList);
-    m_outputElementsQueue->push(outputElement);
+    outputElement.addStartGroup();
+    m_outputElementsQueue->push(std::move(outputElement));
   }
   m_groupLevels.push(level);
   m_groupTransforms.push(CDRTransforms());
@@ -216,17 +253,36 @@ void libcdr::CDRContentCollector::collectPath(const CDRPath &path)
 void libcdr::CDRContentCollector::_flushCurrentPath()
 {
   CDR_DEBUG_MSG(("CDRContentCollector::_flushCurrentPath\n"));
-  CDROutputElementList outputElement;
+  // Objects outside of the viewport or too small to be seen are dropped before
+  // any output is generated. Vector patterns are drawn in their own coordinates
+  // and never culled.
+  if (((m_viewport.width > 0.0 && m_viewport.height > 0.0) || m_detailTolerance > 0.0) && !m_currentVectLevel)
+  {
+    _completeCurrentPath();
+    if (!_isVisible())
+    {
+      m_currentPath.clear();
+      m_currentImage = libcdr::CDRImage();
+      m_currentTransforms.clear();
+      m_fillTransforms = libcdr::CDRTransforms();
+      m_fillOpacity = 1.0;
+      m_currentText = nullptr;
+      return;
+    }
+  }
+  CDROutputElementList outputElement(m_outputElementStorage);
+  // The index needs the extent on the page before the path is transformed
+  if (m_pageIndices && !m_currentVectLevel)
+  {
+    _completeCurrentPath();
+    double xmin = 0.0, ymin = 0.0, xmax = 0.0, ymax = 0.0, margin = 0.0;
+    if (_objectPageBox(xmin, ymin, xmax, ymax, margin))
+      outputElement.setBounds(xmin - margin, ymin - margin, xmax + margin, ymax + margin);
+  }
   if (!m_currentPath.empty() || (!m_splineData.empty() && m_isInSpline))
   {
-    if (m_polygon && m_isInPolygon)
-      m_polygon->create(m_currentPath);
-    m_polygon.reset();
-    m_isInPolygon = false;
-    if (!m_splineData.empty() && m_isInSpline)
-      m_splineData.create(m_currentPath);
-    m_splineData.clear();
-    m_isInSpline = false;
+    CDR_TRACE_SPAN(pathSpan, "_flushCurrentPath");
+    _completeCurrentPath();
     bool firstPoint = true;
     bool wasMove = false;
     double initialX = 0.0;
@@ -235,10 +291,20 @@ void libcdr::CDRContentCollector::_flushCurrentPath()
     double previousY = 0.0;
     double x = 0.0;
     double y = 0.0;
-    librevenge::RVNGPropertyList style;
-    _fillProperties(style);
-    _lineProperties(style);
-    outputElement.addStyle(style);
+    const StyleTemplate &styleTemplate = _styleTemplate();
+    if (styleTemplate.sharedId)
+      outputElement.addStyle(styleTemplate.properties, styleTemplate.sharedId);
+    else
+    {
+      librevenge::RVNGPropertyList &style = outputElement.addStyle();
+      style = styleTemplate.properties;
+      _objectStyleProperties(style, styleTemplate);
+    }
+    unsigned geometryId = 0;
+    librevenge::RVNGString geometryTransform;
+    // Simplification depends on the size on the page, so it breaks the copies apart
+    if (m_instanceGeometry && !m_currentVectLevel && !(m_detailTolerance > 0.0))
+      _geometryInstance(geometryId, geometryTransform);
     m_currentPath.transform(m_currentTransforms);
     if (!m_groupTransforms.empty())
       m_currentPath.transform(m_groupTransforms.top());
@@ -246,11 +312,14 @@ void libcdr::CDRContentCollector::_flushCurrentPath()
     m_currentPath.transform(tmpTrafo);
     tmpTrafo = CDRTransform(1.0, 0.0, 0.0, 0.0, -1.0, m_page.height);
     m_currentPath.transform(tmpTrafo);
+    if (m_detailTolerance > 0.0 && !m_currentVectLevel)
+      m_currentPath.simplify(m_detailTolerance);
 
     std::vector<librevenge::RVNGPropertyList> tmpPath;
 
     librevenge::RVNGPropertyListVector path;
     m_currentPath.writeOut(path);
+    CDR_TRACE_ARG(pathSpan, "nodes", path.count());
 
     bool isPathClosed = m_currentPath.isClosed();
 
@@ -341,10 +410,13 @@ void libcdr::CDRContentCollector::_flushCurrentPath()
       librevenge::RVNGPropertyListVector outputPath;
       for (std::vector<librevenge::RVNGPropertyList>::const_iterator iter = tmpPath.begin(); iter != tmpPath.end(); ++iter)
         outputPath.append(*iter);
-      librevenge::RVNGPropertyList propList;
+      librevenge::RVNGPropertyList &propList = outputElement.addPath();
       propList.insert("svg:d", outputPath);
-      outputElement.addPath(propList);
-
+      if (geometryId)
+      {
+        propList.insert("libcdr:geometry-id", (int)geometryId);
+        propList.insert("libcdr:geometry-transform", geometryTransform);
+      }
     }
     m_currentPath.clear();
   }
@@ -386,7 +458,7 @@ void libcdr::CDRContentCollector::_flushCurrentPath()
     double height = sqrt((corner2x - corner1x)*(corner2x - corner1x) + (corner2y - corner1y)*(corner2y - corner1y));
     double rotate = atan2(corner3y-corner2y, corner3x-corner2x);
 
-    librevenge::RVNGPropertyList propList;
+    librevenge::RVNGPropertyList &propList = outputElement.addGraphicObject();
 
     propList.insert("svg:x", cx - width / 2.0);
     propList.insert("svg:width", width);
@@ -414,7 +486,7 @@ void libcdr::CDRContentCollector::_flushCurrentPath()
 
     propList.insert("librevenge:mime-type", "image/bmp");
     propList.insert("office:binary-data", m_currentImage.getImage());
-    outputElement.addGraphicObject(propList);
+    propList.insert("libcdr:image-id", (int)m_currentImage.m_id);
   }
   if (m_currentText && !m_currentText->empty())
   {
@@ -471,7 +543,7 @@ void libcdr::CDRContentCollector::_flushCurrentPath()
     if (y1 > y2)
       std::swap(y1, y2);
 
-    librevenge::RVNGPropertyList textFrameProps;
+    librevenge::RVNGPropertyList &textFrameProps = outputElement.addStartTextObject();
     textFrameProps.insert("svg:width", fabs(x2-x1));
     textFrameProps.insert("svg:height", fabs(y2-y1));
     textFrameProps.insert("svg:x", x1);
@@ -480,13 +552,12 @@ void libcdr::CDRContentCollector::_flushCurrentPath()
     textFrameProps.insert("fo:padding-bottom", 0.0);
     textFrameProps.insert("fo:padding-left", 0.0);
     textFrameProps.insert("fo:padding-right", 0.0);
-    outputElement.addStartTextObject(textFrameProps);
     for (const auto &i : *m_currentText)
     {
       const std::vector<CDRText> &currentLine = i.m_line;
       if (currentLine.empty())
         continue;
-      librevenge::RVNGPropertyList paraProps;
+      librevenge::RVNGPropertyList &paraProps = outputElement.addOpenParagraph();
       bool rtl = false;
       switch (currentLine[0].m_style.m_align)
       {
@@ -515,19 +586,17 @@ void libcdr::CDRContentCollector::_flushCurrentPath()
       default:
         break;
       }
-      outputElement.addOpenParagraph(paraProps);
       for (const auto &j : currentLine)
       {
         if (!j.m_text.empty())
         {
-          librevenge::RVNGPropertyList spanProps;
+          librevenge::RVNGPropertyList &spanProps = outputElement.addOpenSpan();
           double fontSize = (double)cdr_round(144.0*j.m_style.m_fontSize) / 2.0;
           spanProps.insert("fo:font-size", fontSize, librevenge::RVNG_POINT);
           if (j.m_style.m_fontName.len())
             spanProps.insert("style:font-name", j.m_style.m_fontName);
           if (j.m_style.m_fillStyle.fillType != (unsigned short)-1)
             spanProps.insert("fo:color", m_ps.getRGBColorString(j.m_style.m_fillStyle.color1));
-          outputElement.addOpenSpan(spanProps);
           outputElement.addInsertText(j.m_text);
           outputElement.addCloseSpan();
         }
@@ -540,9 +609,9 @@ void libcdr::CDRContentCollector::_flushCurrentPath()
   if (!outputElement.empty())
   {
     if (m_reverseOrder)
-      m_outputElementsStack->push(outputElement);
+      m_outputElementsStack->push(std::move(outputElement));
     else
-      m_outputElementsQueue->push(outputElement);
+      m_outputElementsQueue->push(std::move(outputElement));
   }
   m_currentTransforms.clear();
   m_fillTransforms = libcdr::CDRTransforms();
@@ -550,6 +619,123 @@ void libcdr::CDRContentCollector::_flushCurrentPath()
   m_currentText = nullptr;
 }
 
+std::size_t libcdr::CDRContentCollector::GeometryHash::operator()(const std::vector<double> &geometry) const
+{
+  std::size_t seed = geometry.size();
+  for (double value : geometry)
+    seed ^= std::hash<double>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+  return seed;
+}
+
+void libcdr::CDRContentCollector::_pathToPage(double &x, double &y) const
+{
+  // same as the transformations applied to the path in _flushCurrentPath
+  m_currentTransforms.applyToPoint(x, y);
+  if (!m_groupTransforms.empty())
+    m_groupTransforms.top().applyToPoint(x, y);
+  x -= m_page.offsetX;
+  y = m_page.height - (y - m_page.offsetY);
+}
+
+void libcdr::CDRContentCollector::_completeCurrentPath()
+{
+  if (m_polygon && m_isInPolygon)
+    m_polygon->create(m_currentPath);
+  m_polygon.reset();
+  m_isInPolygon = false;
+  if (!m_splineData.empty() && m_isInSpline)
+    m_splineData.create(m_currentPath);
+  m_splineData.clear();
+  m_isInSpline = false;
+}
+
+void libcdr::CDRContentCollector::_extendPageBox(CDRPathBBox &box, double x1, double y1, double x2, double y2) const
+{
+  // the corners of a rectangle of the object, which may be rotated on the page
+  const double corners[4][2] = { { x1, y1 }, { x1, y2 }, { x2, y1 }, { x2, y2 } };
+  for (const auto &corner : corners)
+  {
+    double x = corner[0];
+    double y = corner[1];
+    _pathToPage(x, y);
+    box.addPoint(x, y);
+  }
+}
+
+bool libcdr::CDRContentCollector::_objectPageBox(double &xmin, double &ymin, double &xmax, double &ymax, double &margin)
+{
+  CDRPathBBox box;
+  margin = 0.0;
+  if (m_currentPath.boundingBox(xmin, ymin, xmax, ymax))
+  {
+    _extendPageBox(box, xmin, ymin, xmax, ymax);
+    double scale = std::max(m_currentTransforms.getScaleX(), m_currentTransforms.getScaleY());
+    if (!m_groupTransforms.empty())
+      scale *= std::max(m_groupTransforms.top().getScaleX(), m_groupTransforms.top().getScaleY());
+    const CDRLineStyle &lineStyle = _styleTemplate().lineStyle;
+    if (lineStyle.lineType != (unsigned short)-1 && !(lineStyle.lineType & 0x1))
+    {
+      // miter joins reach up to twice the line width out, like the SVG default miter limit
+      margin = 2.0 * lineStyle.lineWidth * (isLineScaled(lineStyle) ? scale * lineStyle.stretch : 1.0);
+      // arrow heads are placed at the end points in document units
+      const std::shared_ptr<const CDRPath> markers[2] = { lineStyle.startMarker, lineStyle.endMarker };
+      for (const auto &marker : markers)
+      {
+        double mxmin = 0.0, mymin = 0.0, mxmax = 0.0, mymax = 0.0;
+        if (marker && marker->boundingBox(mxmin, mymin, mxmax, mymax))
+          margin = std::max(margin, scale * std::max(std::max(fabs(mxmin), fabs(mxmax)), std::max(fabs(mymin), fabs(mymax))));
+      }
+    }
+  }
+  if (m_currentImage.getImage().size())
+    _extendPageBox(box, m_currentImage.m_x1, m_currentImage.m_y1, m_currentImage.m_x2, m_currentImage.m_y2);
+  if (m_currentText && !m_currentText->empty())
+  {
+    if (CDR_ALMOST_ZERO(m_currentTextBox.m_h) || CDR_ALMOST_ZERO(m_currentTextBox.m_w))
+      return false;
+    _extendPageBox(box, m_currentTextBox.m_x, m_currentTextBox.m_y - m_currentTextBox.m_h,
+                   m_currentTextBox.m_x + m_currentTextBox.m_w, m_currentTextBox.m_y);
+  }
+  if (box.empty())
+    return false;
+  box.get(xmin, ymin, xmax, ymax);
+  return true;
+}
+
+bool libcdr::CDRContentCollector::_isVisible()
+{
+  double xmin = 0.0, ymin = 0.0, xmax = 0.0, ymax = 0.0, margin = 0.0;
+  // without a known extent, let the normal output decide
+  if (!_objectPageBox(xmin, ymin, xmax, ymax, margin))
+    return true;
+  if (m_viewport.width > 0.0 && m_viewport.height > 0.0
+      && (xmax + margin < m_viewport.x || xmin - margin > m_viewport.x + m_viewport.width
+          || ymax + margin < m_viewport.y || ymin - margin > m_viewport.y + m_viewport.height))
+    return false;
+  if (xmax - xmin + 2.0 * margin < m_detailTolerance && ymax - ymin + 2.0 * margin < m_detailTolerance)
+    return false;
+  return true;
+}
+
+void libcdr::CDRContentCollector::_geometryInstance(unsigned &geometryId, librevenge::RVNGString &geometryTransform)
+{
+  // All transformations are affine, so three points determine the matrix
+  double x0 = 0.0, y0 = 0.0, x1 = 1.0, y1 = 0.0, x2 = 0.0, y2 = 1.0;
+  _pathToPage(x0, y0);
+  _pathToPage(x1, y1);
+  _pathToPage(x2, y2);
+  // Generators recover the geometry from any copy, so it must be invertible
+  if ((x1 - x0) * (y2 - y0) - (y1 - y0) * (x2 - x0) == 0.0)
+    return;
+
+  std::vector<double> geometry;
+  m_currentPath.appendGeometry(geometry);
+  const unsigned nextId = (unsigned)m_geometries.size() + 1;
+  geometryId = m_geometries.insert(std::make_pair(std::move(geometry), nextId)).first->second;
+  geometryTransform.sprintf("matrix(%.10g %.10g %.10g %.10g %.10g %.10g)",
+                            x1 - x0, y1 - y0, x2 - x0, y2 - y0, x0, y0);
+}
+
 void libcdr::CDRContentCollector::collectTransform(const CDRTransforms &transforms, bool considerGroupTransform)
 {
   if (m_currentObjectLevel)
@@ -572,18 +758,17 @@ void libcdr::CDRContentCollector::collectLevel(unsigned level)
   }
   while (!m_groupLevels.empty() && level <= m_groupLevels.top())
   {
-    CDROutputElementList outputElement;
+    CDROutputElementList outputElement(m_outputElementStorage);
     // since the CDR objects are drawn in reverse order, reverse group marks too
     if (m_reverseOrder)
     {
-      librevenge::RVNGPropertyList propList;
-      outputElement.addStartGroup(propList);
-      m_outputElementsStack->push(outputElement);
+      outputElement.addStartGroup();
+      m_outputElementsStack->push(std::move(outputElement));
     }
     else
     {
       outputElement.addEndGroup();
-      m_outputElementsQueue->push(outputElement);
+      m_outputElementsQueue->push(std::move(outputElement));
     }
     m_groupLevels.pop();
     m_groupTransforms.pop();
@@ -614,7 +799,7 @@ void libcdr::CDRContentCollector::collectLevel(unsigned level)
         "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n<!DOCTYPE svg PUBLIC \"-//W3C//DTD SVG 1.1//EN\" \"http://www.w3.org/Graphics/SVG/1.1/DTD/svg11.dtd\">\n";
       librevenge::RVNGBinaryData output((const unsigned char *)header, strlen(header));
       output.append((const unsigned char *)svgOutput[0].cstr(), strlen(svgOutput[0].cstr()));
-      m_ps.m_vects[m_spnd] = output;
+      _setVectorPattern(m_spnd, output);
     }
 #if DUMP_VECT
     librevenge::RVNGString filename;
@@ -652,14 +837,22 @@ void libcdr::CDRContentCollector::collectFillStyleId(unsigned id)
 {
   std::map<unsigned, CDRFillStyle>::const_iterator iter = m_ps.m_fillStyles.find(id);
   if (iter != m_ps.m_fillStyles.end())
+  {
     m_currentFillStyle = iter->second;
+    m_currentStyleKey.fillSource = STYLE_SOURCE_ID;
+    m_currentStyleKey.fillId = id;
+  }
 }
 
 void libcdr::CDRContentCollector::collectLineStyleId(unsigned id)
 {
   std::map<unsigned, CDRLineStyle>::const_iterator iter = m_ps.m_lineStyles.find(id);
   if (iter != m_ps.m_lineStyles.end())
+  {
     m_currentLineStyle = iter->second;
+    m_currentStyleKey.lineSource = STYLE_SOURCE_ID;
+    m_currentStyleKey.lineId = id;
+  }
 }
 
 void libcdr::CDRContentCollector::collectRotate(double angle, double cx, double cy)
@@ -687,50 +880,127 @@ void libcdr::CDRContentCollector::collectPolygonTransform(unsigned numAngles, un
   m_polygon.reset(new CDRPolygon(numAngles, nextPoint, rx, ry, cx, cy));
 }
 
-void libcdr::CDRContentCollector::_fillProperties(librevenge::RVNGPropertyList &propList)
+const libcdr::CDRContentCollector::StyleTemplate &libcdr::CDRContentCollector::_styleTemplate()
 {
+  // Styles that are not set fall back to the ones of the style id
+  StyleKey key(m_currentStyleKey);
   if (m_currentFillStyle.fillType == (unsigned short)-1 && m_currentStyleId)
   {
+    key.fillSource = STYLE_SOURCE_STYLE;
+    key.fillId = m_currentStyleId;
+  }
+  if (m_currentLineStyle.lineType == (unsigned short)-1 && m_currentStyleId)
+  {
+    key.lineSource = STYLE_SOURCE_STYLE;
+    key.lineId = m_currentStyleId;
+  }
+  key.opacity = m_fillOpacity;
+
+  auto iter = m_styleTemplates.find(key);
+  if (iter == m_styleTemplates.end())
+  {
+    const CDRFillStyle *fillStyle = &m_currentFillStyle;
+    const CDRLineStyle *lineStyle = &m_currentLineStyle;
     CDRStyle tmpStyle;
-    m_ps.getRecursedStyle(tmpStyle, m_currentStyleId);
-    m_currentFillStyle = tmpStyle.m_fillStyle;
+    if (key.fillSource == STYLE_SOURCE_STYLE || key.lineSource == STYLE_SOURCE_STYLE)
+    {
+      m_ps.getRecursedStyle(tmpStyle, m_currentStyleId);
+      if (key.fillSource == STYLE_SOURCE_STYLE)
+        fillStyle = &tmpStyle.m_fillStyle;
+      if (key.lineSource == STYLE_SOURCE_STYLE)
+        lineStyle = &tmpStyle.m_lineStyle;
+    }
+    iter = m_styleTemplates.insert(std::make_pair(key, std::unique_ptr<StyleTemplate>(new StyleTemplate()))).first;
+    StyleTemplate &styleTemplate = *iter->second;
+    _fillProperties(styleTemplate.properties, *fillStyle);
+    _lineProperties(styleTemplate.properties, *lineStyle);
+    const librevenge::RVNGProperty *fill = styleTemplate.properties["draw:fill"];
+    styleTemplate.hasImageFill = fill && fill->getStr() == "bitmap";
+    styleTemplate.hasVectorFill = fillStyle->fillType == 10;
+    styleTemplate.imageFill = fillStyle->imageFill;
+    styleTemplate.lineStyle = *lineStyle;
+    if (m_shareStyles && !styleTemplate.hasImageFill && !isLineScaled(*lineStyle)
+        && !(lineStyle->startMarker && !lineStyle->startMarker->empty())
+        && !(lineStyle->endMarker && !lineStyle->endMarker->empty()))
+    {
+      // retired templates keep their ids
+      styleTemplate.sharedId = (unsigned)(m_styleTemplates.size() + m_retiredStyleTemplates.size());
+      styleTemplate.properties.insert("libcdr:style-id", (int)styleTemplate.sharedId);
+    }
   }
+  return *iter->second;
+}
 
+void libcdr::CDRContentCollector::_setVectorPattern(unsigned id, const librevenge::RVNGBinaryData &vect)
+{
+  m_ps.m_vects[id] = vect;
+  // Vector patterns are collected in this pass, possibly after the first
+  // object filled with them, so the templates built without them are stale.
+  for (auto iter = m_styleTemplates.begin(); iter != m_styleTemplates.end();)
+  {
+    if (iter->second->hasVectorFill && iter->second->imageFill.id == id)
+    {
+      m_retiredStyleTemplates.push_back(std::move(iter->second));
+      iter = m_styleTemplates.erase(iter);
+    }
+    else
+      ++iter;
+  }
+}
+
+void libcdr::CDRContentCollector::_objectStyleProperties(librevenge::RVNGPropertyList &propList, const StyleTemplate &styleTemplate)
+{
+  if (styleTemplate.hasImageFill)
+    _fillImageProperties(propList, styleTemplate.imageFill);
+  const CDRLineStyle &lineStyle = styleTemplate.lineStyle;
+  if (isLineScaled(lineStyle)) // scale line with image
+  {
+    double scale = m_currentTransforms.getScaleX();
+    double scaleY = m_currentTransforms.getScaleY();
+    if (scaleY > scale)
+      scale = scaleY;
+    _lineWidthProperties(propList, lineStyle, scale * lineStyle.stretch);
+  }
+  _lineMarkerProperties(propList, lineStyle);
+}
+
+void libcdr::CDRContentCollector::_fillProperties(librevenge::RVNGPropertyList &propList, const CDRFillStyle &fillStyle)
+{
   if (m_fillOpacity < 1.0)
     propList.insert("draw:opacity", m_fillOpacity, librevenge::RVNG_PERCENT);
-  if (m_currentFillStyle.fillType == 0)
+  if (fillStyle.fillType == 0)
     propList.insert("draw:fill", "none");
   else
   {
-    if (m_currentFillStyle.fillType == (unsigned short)-1)
+    if (fillStyle.fillType == (unsigned short)-1)
       propList.insert("draw:fill", "none");
     else
     {
-      switch (m_currentFillStyle.fillType)
+      switch (fillStyle.fillType)
       {
       case 1: // Solid
         propList.insert("draw:fill", "solid");
-        propList.insert("draw:fill-color", m_ps.getRGBColorString(m_currentFillStyle.color1));
+        propList.insert("draw:fill-color", m_ps.getRGBColorString(fillStyle.color1));
         propList.insert("svg:fill-rule", "evenodd");
         break;
       case 2: // Gradient
-        if (m_currentFillStyle.gradient.m_stops.empty())
+        if (fillStyle.gradient.m_stops.empty())
           propList.insert("draw:fill", "none");
-        else if (m_currentFillStyle.gradient.m_stops.size() == 1)
+        else if (fillStyle.gradient.m_stops.size() == 1)
         {
           propList.insert("draw:fill", "solid");
-          propList.insert("draw:fill-color", m_ps.getRGBColorString(m_currentFillStyle.gradient.m_stops[0].m_color));
+          propList.insert("draw:fill-color", m_ps.getRGBColorString(fillStyle.gradient.m_stops[0].m_color));
           propList.insert("svg:fill-rule", "evenodd");
         }
-        else if (m_currentFillStyle.gradient.m_stops.size() == 2)
+        else if (fillStyle.gradient.m_stops.size() == 2)
         {
-          double angle = m_currentFillStyle.gradient.m_angle * 180 / M_PI;
+          double angle = fillStyle.gradient.m_angle * 180 / M_PI;
           normalizeAngle(angle);
           propList.insert("draw:fill", "gradient");
-          propList.insert("draw:start-color", m_ps.getRGBColorString(m_currentFillStyle.gradient.m_stops[0].m_color));
-          propList.insert("draw:end-color", m_ps.getRGBColorString(m_currentFillStyle.gradient.m_stops[1].m_color));
+          propList.insert("draw:start-color", m_ps.getRGBColorString(fillStyle.gradient.m_stops[0].m_color));
+          propList.insert("draw:end-color", m_ps.getRGBColorString(fillStyle.gradient.m_stops[1].m_color));
           propList.insert("draw:angle", (int)angle);
-          switch (m_currentFillStyle.gradient.m_type)
+          switch (fillStyle.gradient.m_type)
           {
           case 1: // linear
           case 3: // conical
@@ -738,19 +1008,19 @@ void libcdr::CDRContentCollector::_fillProperties(librevenge::RVNGPropertyList &
             angle += 90.0;
             normalizeAngle(angle);
             propList.insert("draw:angle", (int)angle);
-            propList.insert("draw:border", (double)(m_currentFillStyle.gradient.m_edgeOffset)/100.0, librevenge::RVNG_PERCENT);
+            propList.insert("draw:border", (double)(fillStyle.gradient.m_edgeOffset)/100.0, librevenge::RVNG_PERCENT);
             break;
           case 2: // radial
-            propList.insert("draw:border", (2.0 * (double)(m_currentFillStyle.gradient.m_edgeOffset)/100.0), librevenge::RVNG_PERCENT);
+            propList.insert("draw:border", (2.0 * (double)(fillStyle.gradient.m_edgeOffset)/100.0), librevenge::RVNG_PERCENT);
             propList.insert("draw:style", "radial");
-            propList.insert("svg:cx", (double)(0.5 + m_currentFillStyle.gradient.m_centerXOffset/200.0), librevenge::RVNG_PERCENT);
-            propList.insert("svg:cy", (double)(0.5 + m_currentFillStyle.gradient.m_centerXOffset/200.0), librevenge::RVNG_PERCENT);
+            propList.insert("svg:cx", (double)(0.5 + fillStyle.gradient.m_centerXOffset/200.0), librevenge::RVNG_PERCENT);
+            propList.insert("svg:cy", (double)(0.5 + fillStyle.gradient.m_centerXOffset/200.0), librevenge::RVNG_PERCENT);
             break;
           case 4: // square
-            propList.insert("draw:border", (2.0 * (double)(m_currentFillStyle.gradient.m_edgeOffset)/100.0), librevenge::RVNG_PERCENT);
+            propList.insert("draw:border", (2.0 * (double)(fillStyle.gradient.m_edgeOffset)/100.0), librevenge::RVNG_PERCENT);
             propList.insert("draw:style", "square");
-            propList.insert("svg:cx", (double)(0.5 + m_currentFillStyle.gradient.m_centerXOffset/200.0), librevenge::RVNG_PERCENT);
-            propList.insert("svg:cy", (double)(0.5 + m_currentFillStyle.gradient.m_centerXOffset/200.0), librevenge::RVNG_PERCENT);
+            propList.insert("svg:cx", (double)(0.5 + fillStyle.gradient.m_centerXOffset/200.0), librevenge::RVNG_PERCENT);
+            propList.insert("svg:cy", (double)(0.5 + fillStyle.gradient.m_centerXOffset/200.0), librevenge::RVNG_PERCENT);
             break;
           default:
             propList.insert("draw:style", "linear");
@@ -758,7 +1028,7 @@ void libcdr::CDRContentCollector::_fillProperties(librevenge::RVNGPropertyList &
             normalizeAngle(angle);
             propList.insert("draw:angle", (int)angle);
             librevenge::RVNGPropertyListVector vec;
-            for (auto &gradStop : m_currentFillStyle.gradient.m_stops)
+            for (auto &gradStop : fillStyle.gradient.m_stops)
             {
               librevenge::RVNGPropertyList stopElement;
               stopElement.insert("svg:offset", gradStop.m_offset, librevenge::RVNG_PERCENT);
@@ -774,12 +1044,12 @@ void libcdr::CDRContentCollector::_fillProperties(librevenge::RVNGPropertyList &
         {
           propList.insert("draw:fill", "gradient");
           propList.insert("draw:style", "linear");
-          double angle = m_currentFillStyle.gradient.m_angle * 180 / M_PI;
+          double angle = fillStyle.gradient.m_angle * 180 / M_PI;
           angle += 90.0;
           normalizeAngle(angle);
           propList.insert("draw:angle", (int)angle);
           librevenge::RVNGPropertyListVector vec;
-          for (auto &gradStop : m_currentFillStyle.gradient.m_stops)
+          for (auto &gradStop : fillStyle.gradient.m_stops)
           {
             librevenge::RVNGPropertyList stopElement;
             stopElement.insert("svg:offset", gradStop.m_offset, librevenge::RVNG_PERCENT);
@@ -793,15 +1063,15 @@ void libcdr::CDRContentCollector::_fillProperties(librevenge::RVNGPropertyList &
       case 7: // Pattern
       case 8: // Pattern
       {
-        auto iterPattern = m_ps.m_patterns.find(m_currentFillStyle.imageFill.id);
+        auto iterPattern = m_ps.m_patterns.find(fillStyle.imageFill.id);
         if (iterPattern != m_ps.m_patterns.end())
         {
           propList.insert("draw:fill", "bitmap");
           librevenge::RVNGBinaryData image;
-          _generateBitmapFromPattern(image, iterPattern->second, m_currentFillStyle.color1, m_currentFillStyle.color2);
+          _generateBitmapFromPattern(image, iterPattern->second, fillStyle.color1, fillStyle.color2);
 #if DUMP_PATTERN
           librevenge::RVNGString filename;
-          filename.sprintf("pattern%.8x.bmp", m_currentFillStyle.imageFill.id);
+          filename.sprintf("pattern%.8x.bmp", fillStyle.imageFill.id);
           FILE *f = fopen(filename.cstr(), "wb");
           if (f)
           {
@@ -814,52 +1084,12 @@ void libcdr::CDRContentCollector::_fillProperties(librevenge::RVNGPropertyList &
           propList.insert("draw:fill-image", image);
           propList.insert("librevenge:mime-type", "image/bmp");
           propList.insert("style:repeat", "repeat");
-          if (m_currentFillStyle.imageFill.isRelative)
-          {
-            propList.insert("svg:width", m_currentFillStyle.imageFill.width, librevenge::RVNG_PERCENT);
-            propList.insert("svg:height", m_currentFillStyle.imageFill.height, librevenge::RVNG_PERCENT);
-          }
-          else
-          {
-            double scaleX = 1.0;
-            double scaleY = 1.0;
-            if (m_currentFillStyle.imageFill.flags & 0x04) // scale fill with image
-            {
-              scaleX = m_currentTransforms.getScaleX();
-              scaleY = m_currentTransforms.getScaleY();
-            }
-            propList.insert("svg:width", m_currentFillStyle.imageFill.width * scaleX);
-            propList.insert("svg:height", m_currentFillStyle.imageFill.height * scaleY);
-          }
-          propList.insert("draw:fill-image-ref-point", "bottom-left");
-          if (m_currentFillStyle.imageFill.isRelative)
-          {
-            if (!CDR_ALMOST_ZERO(m_currentFillStyle.imageFill.xOffset) && !CDR_ALMOST_ZERO(m_currentFillStyle.imageFill.xOffset))
-              propList.insert("draw:fill-image-ref-point-x", m_currentFillStyle.imageFill.xOffset, librevenge::RVNG_PERCENT);
-            if (!CDR_ALMOST_ZERO(m_currentFillStyle.imageFill.yOffset) && !CDR_ALMOST_ZERO(m_currentFillStyle.imageFill.yOffset))
-              propList.insert("draw:fill-image-ref-point-y", m_currentFillStyle.imageFill.yOffset, librevenge::RVNG_PERCENT);
-          }
-          else
-          {
-            if (!CDR_ALMOST_ZERO(m_fillTransforms.getTranslateX()))
-            {
-              double xOffset = m_fillTransforms.getTranslateX() / m_currentFillStyle.imageFill.width;
-              normalize(xOffset);
-              propList.insert("draw:fill-image-ref-point-x", xOffset, librevenge::RVNG_PERCENT);
-            }
-            if (!CDR_ALMOST_ZERO(m_fillTransforms.getTranslateY()))
-            {
-              double yOffset = m_fillTransforms.getTranslateY() / m_currentFillStyle.imageFill.width;
-              normalize(yOffset);
-              propList.insert("draw:fill-image-ref-point-y", 1.0 - yOffset, librevenge::RVNG_PERCENT);
-            }
-          }
         }
         else
         {
           // We did not find the pattern, so fill solid with the background colour
           propList.insert("draw:fill", "solid");
-          propList.insert("draw:fill-color", m_ps.getRGBColorString(m_currentFillStyle.color2));
+          propList.insert("draw:fill-color", m_ps.getRGBColorString(fillStyle.color2));
           propList.insert("svg:fill-rule", "evenodd");
         }
       }
@@ -867,59 +1097,14 @@ void libcdr::CDRContentCollector::_fillProperties(librevenge::RVNGPropertyList &
       case 9: // Bitmap
       case 11: // Texture
       {
-        auto iterBmp = m_ps.m_bmps.find(m_currentFillStyle.imageFill.id);
-        if (iterBmp != m_ps.m_bmps.end())
+        const librevenge::RVNGBinaryData *image = m_ps.getBmp(fillStyle.imageFill.id);
+        if (image)
         {
           propList.insert("librevenge:mime-type", "image/bmp");
           propList.insert("draw:fill", "bitmap");
-          propList.insert("draw:fill-image", iterBmp->second);
+          propList.insert("draw:fill-image", *image);
+          propList.insert("libcdr:image-id", (int)m_ps.getBmpId(fillStyle.imageFill.id));
           propList.insert("style:repeat", "repeat");
-          if (m_currentFillStyle.imageFill.isRelative)
-          {
-            propList.insert("svg:width", m_currentFillStyle.imageFill.width, librevenge::RVNG_PERCENT);
-            propList.insert("svg:height", m_currentFillStyle.imageFill.height, librevenge::RVNG_PERCENT);
-          }
-          else
-          {
-            double scaleX = 1.0;
-            double scaleY = 1.0;
-            if (m_currentFillStyle.imageFill.flags & 0x04) // scale fill with image
-            {
-              scaleX = m_currentTransforms.getScaleX();
-              scaleY = m_currentTransforms.getScaleY();
-            }
-            propList.insert("svg:width", m_currentFillStyle.imageFill.width * scaleX);
-            propList.insert("svg:height", m_currentFillStyle.imageFill.height * scaleY);
-          }
-          propList.insert("draw:fill-image-ref-point", "bottom-left");
-          if (m_currentFillStyle.imageFill.isRelative)
-          {
-            if (!CDR_ALMOST_ZERO(m_currentFillStyle.imageFill.xOffset) && !CDR_ALMOST_ZERO(m_currentFillStyle.imageFill.xOffset))
-              propList.insert("draw:fill-image-ref-point-x", m_currentFillStyle.imageFill.xOffset, librevenge::RVNG_PERCENT);
-            if (!CDR_ALMOST_ZERO(m_currentFillStyle.imageFill.yOffset) && !CDR_ALMOST_ZERO(m_currentFillStyle.imageFill.yOffset))
-              propList.insert("draw:fill-image-ref-point-y", m_currentFillStyle.imageFill.yOffset, librevenge::RVNG_PERCENT);
-          }
-          else
-          {
-            if (!CDR_ALMOST_ZERO(m_fillTransforms.getTranslateX()))
-            {
-              double xOffset = m_fillTransforms.getTranslateX() / m_currentFillStyle.imageFill.width;
-              while (xOffset < 0.0)
-                xOffset += 1.0;
-              while (xOffset > 1.0)
-                xOffset -= 1.0;
-              propList.insert("draw:fill-image-ref-point-x", xOffset, librevenge::RVNG_PERCENT);
-            }
-            if (!CDR_ALMOST_ZERO(m_fillTransforms.getTranslateY()))
-            {
-              double yOffset = m_fillTransforms.getTranslateY() / m_currentFillStyle.imageFill.width;
-              while (yOffset < 0.0)
-                yOffset += 1.0;
-              while (yOffset > 1.0)
-                yOffset -= 1.0;
-              propList.insert("draw:fill-image-ref-point-y", 1.0 - yOffset, librevenge::RVNG_PERCENT);
-            }
-          }
         }
         else
           propList.insert("draw:fill", "none");
@@ -927,59 +1112,13 @@ void libcdr::CDRContentCollector::_fillProperties(librevenge::RVNGPropertyList &
       break;
       case 10: // Full color
       {
-        auto iterVect = m_ps.m_vects.find(m_currentFillStyle.imageFill.id);
+        auto iterVect = m_ps.m_vects.find(fillStyle.imageFill.id);
         if (iterVect != m_ps.m_vects.end())
         {
           propList.insert("draw:fill", "bitmap");
           propList.insert("librevenge:mime-type", "image/svg+xml");
           propList.insert("draw:fill-image", iterVect->second);
           propList.insert("style:repeat", "repeat");
-          if (m_currentFillStyle.imageFill.isRelative)
-          {
-            propList.insert("svg:width", m_currentFillStyle.imageFill.width, librevenge::RVNG_PERCENT);
-            propList.insert("svg:height", m_currentFillStyle.imageFill.height, librevenge::RVNG_PERCENT);
-          }
-          else
-          {
-            double scaleX = 1.0;
-            double scaleY = 1.0;
-            if (m_currentFillStyle.imageFill.flags & 0x04) // scale fill with image
-            {
-              scaleX = m_currentTransforms.getScaleX();
-              scaleY = m_currentTransforms.getScaleY();
-            }
-            propList.insert("svg:width", m_currentFillStyle.imageFill.width * scaleX);
-            propList.insert("svg:height", m_currentFillStyle.imageFill.height * scaleY);
-          }
-          propList.insert("draw:fill-image-ref-point", "bottom-left");
-          if (m_currentFillStyle.imageFill.isRelative)
-          {
-            if (!CDR_ALMOST_ZERO(m_currentFillStyle.imageFill.xOffset) && !CDR_ALMOST_ZERO(m_currentFillStyle.imageFill.xOffset))
-              propList.insert("draw:fill-image-ref-point-x", m_currentFillStyle.imageFill.xOffset, librevenge::RVNG_PERCENT);
-            if (!CDR_ALMOST_ZERO(m_currentFillStyle.imageFill.yOffset) && !CDR_ALMOST_ZERO(m_currentFillStyle.imageFill.yOffset))
-              propList.insert("draw:fill-image-ref-point-y", m_currentFillStyle.imageFill.yOffset, librevenge::RVNG_PERCENT);
-          }
-          else
-          {
-            if (!CDR_ALMOST_ZERO(m_fillTransforms.getTranslateX()))
-            {
-              double xOffset = m_fillTransforms.getTranslateX() / m_currentFillStyle.imageFill.width;
-              while (xOffset < 0.0)
-                xOffset += 1.0;
-              while (xOffset > 1.0)
-                xOffset -= 1.0;
-              propList.insert("draw:fill-image-ref-point-x", xOffset, librevenge::RVNG_PERCENT);
-            }
-            if (!CDR_ALMOST_ZERO(m_fillTransforms.getTranslateY()))
-            {
-              double yOffset = m_fillTransforms.getTranslateY() / m_currentFillStyle.imageFill.width;
-              while (yOffset < 0.0)
-                yOffset += 1.0;
-              while (yOffset > 1.0)
-                yOffset -= 1.0;
-              propList.insert("draw:fill-image-ref-point-y", 1.0 - yOffset, librevenge::RVNG_PERCENT);
-            }
-          }
         }
         else
           propList.insert("draw:fill", "none");
@@ -993,42 +1132,71 @@ void libcdr::CDRContentCollector::_fillProperties(librevenge::RVNGPropertyList &
   }
 }
 
-void libcdr::CDRContentCollector::_lineProperties(librevenge::RVNGPropertyList &propList)
+void libcdr::CDRContentCollector::_fillImageProperties(librevenge::RVNGPropertyList &propList, const CDRImageFill &imageFill)
 {
-  if (m_currentLineStyle.lineType == (unsigned short)-1 && m_currentStyleId)
+  if (imageFill.isRelative)
   {
-    CDRStyle tmpStyle;
-    m_ps.getRecursedStyle(tmpStyle, m_currentStyleId);
-    m_currentLineStyle = tmpStyle.m_lineStyle;
+    propList.insert("svg:width", imageFill.width, librevenge::RVNG_PERCENT);
+    propList.insert("svg:height", imageFill.height, librevenge::RVNG_PERCENT);
   }
+  else
+  {
+    double scaleX = 1.0;
+    double scaleY = 1.0;
+    if (imageFill.flags & 0x04) // scale fill with image
+    {
+      scaleX = m_currentTransforms.getScaleX();
+      scaleY = m_currentTransforms.getScaleY();
+    }
+    propList.insert("svg:width", imageFill.width * scaleX);
+    propList.insert("svg:height", imageFill.height * scaleY);
+  }
+  propList.insert("draw:fill-image-ref-point", "bottom-left");
+  if (imageFill.isRelative)
+  {
+    if (!CDR_ALMOST_ZERO(imageFill.xOffset) && !CDR_ALMOST_ZERO(imageFill.xOffset))
+      propList.insert("draw:fill-image-ref-point-x", imageFill.xOffset, librevenge::RVNG_PERCENT);
+    if (!CDR_ALMOST_ZERO(imageFill.yOffset) && !CDR_ALMOST_ZERO(imageFill.yOffset))
+      propList.insert("draw:fill-image-ref-point-y", imageFill.yOffset, librevenge::RVNG_PERCENT);
+  }
+  else
+  {
+    if (!CDR_ALMOST_ZERO(m_fillTransforms.getTranslateX()))
+    {
+      double xOffset = m_fillTransforms.getTranslateX() / imageFill.width;
+      normalize(xOffset);
+      propList.insert("draw:fill-image-ref-point-x", xOffset, librevenge::RVNG_PERCENT);
+    }
+    if (!CDR_ALMOST_ZERO(m_fillTransforms.getTranslateY()))
+    {
+      double yOffset = m_fillTransforms.getTranslateY() / imageFill.width;
+      normalize(yOffset);
+      propList.insert("draw:fill-image-ref-point-y", 1.0 - yOffset, librevenge::RVNG_PERCENT);
+    }
+  }
+}
 
-  if (m_currentLineStyle.lineType == (unsigned short)-1)
+void libcdr::CDRContentCollector::_lineProperties(librevenge::RVNGPropertyList &propList, const CDRLineStyle &lineStyle)
+{
+  if (lineStyle.lineType == (unsigned short)-1)
     /* No line style specified and also no line style from the style id,
        the shape has no outline then. */
     propList.insert("draw:stroke", "none");
   else
   {
-    if (m_currentLineStyle.lineType & 0x1)
+    if (lineStyle.lineType & 0x1)
       propList.insert("draw:stroke", "none");
-    else if (m_currentLineStyle.lineType & 0x6)
+    else if (lineStyle.lineType & 0x6)
     {
-      if (m_currentLineStyle.dashArray.size() && (m_currentLineStyle.lineType & 0x4))
+      if (lineStyle.dashArray.size() && (lineStyle.lineType & 0x4))
         propList.insert("draw:stroke", "dash");
       else
         propList.insert("draw:stroke", "solid");
-      double scale = 1.0;
-      if (m_currentLineStyle.lineType & 0x20) // scale line with image
-      {
-        scale = m_currentTransforms.getScaleX();
-        double scaleY = m_currentTransforms.getScaleY();
-        if (scaleY > scale)
-          scale = scaleY;
-      }
-      scale *= m_currentLineStyle.stretch;
-      propList.insert("svg:stroke-width", m_currentLineStyle.lineWidth * scale);
-      propList.insert("svg:stroke-color", m_ps.getRGBColorString(m_currentLineStyle.color));
+      if (!(lineStyle.lineType & 0x20))
+        _lineWidthProperties(propList, lineStyle, lineStyle.stretch);
+      propList.insert("svg:stroke-color", m_ps.getRGBColorString(lineStyle.color));
 
-      switch (m_currentLineStyle.capsType)
+      switch (lineStyle.capsType)
       {
       case 1:
         propList.insert("svg:stroke-linecap", "round");
@@ -1040,7 +1208,7 @@ void libcdr::CDRContentCollector::_lineProperties(librevenge::RVNGPropertyList &
         propList.insert("svg:stroke-linecap", "butt");
       }
 
-      switch (m_currentLineStyle.joinType)
+      switch (lineStyle.joinType)
       {
       case 1:
         propList.insert("svg:stroke-linejoin", "round");
@@ -1051,57 +1219,6 @@ void libcdr::CDRContentCollector::_lineProperties(librevenge::RVNGPropertyList &
       default:
         propList.insert("svg:stroke-linejoin", "miter");
       }
-
-      if (m_currentLineStyle.dashArray.size())
-      {
-        int dots1 = 0;
-        int dots2 = 0;
-        unsigned dots1len = 0;
-        unsigned dots2len = 0;
-        unsigned gap = 0;
-
-        if (m_currentLineStyle.dashArray.size() >= 2)
-        {
-          dots1len = m_currentLineStyle.dashArray[0];
-          gap = m_currentLineStyle.dashArray[1];
-        }
-
-        unsigned long count = m_currentLineStyle.dashArray.size() / 2;
-        unsigned i = 0;
-        for (; i < count;)
-        {
-          if (dots1len == m_currentLineStyle.dashArray[2*i])
-            dots1++;
-          else
-            break;
-          gap = gap < m_currentLineStyle.dashArray[2*i+1] ?  m_currentLineStyle.dashArray[2*i+1] : gap;
-          i++;
-        }
-        if (i < count)
-        {
-          dots2len = m_currentLineStyle.dashArray[2*i];
-          gap = gap < m_currentLineStyle.dashArray[2*i+1] ? m_currentLineStyle.dashArray[2*i+1] : gap;
-        }
-        for (; i < count;)
-        {
-          if (dots2len == m_currentLineStyle.dashArray[2*i])
-            dots2++;
-          else
-            break;
-          gap = gap < m_currentLineStyle.dashArray[2*i+1] ? m_currentLineStyle.dashArray[2*i+1] : gap;
-          i++;
-        }
-        if (!dots2)
-        {
-          dots2 = dots1;
-          dots2len = dots1len;
-        }
-        propList.insert("draw:dots1", dots1);
-        propList.insert("draw:dots1-length", 72.0*(m_currentLineStyle.lineWidth * scale)*dots1len, librevenge::RVNG_POINT);
-        propList.insert("draw:dots2", dots2);
-        propList.insert("draw:dots2-length", 72.0*(m_currentLineStyle.lineWidth * scale)*dots2len, librevenge::RVNG_POINT);
-        propList.insert("draw:distance", 72.0*(m_currentLineStyle.lineWidth * scale)*gap, librevenge::RVNG_POINT);
-      }
     }
     else
     {
@@ -1110,11 +1227,68 @@ void libcdr::CDRContentCollector::_lineProperties(librevenge::RVNGPropertyList &
       propList.insert("svg:stroke-color", "#000000");
     }
   }
+}
+
+void libcdr::CDRContentCollector::_lineWidthProperties(librevenge::RVNGPropertyList &propList, const CDRLineStyle &lineStyle, double scale)
+{
+  propList.insert("svg:stroke-width", lineStyle.lineWidth * scale);
+  if (lineStyle.dashArray.size())
+  {
+    int dots1 = 0;
+    int dots2 = 0;
+    unsigned dots1len = 0;
+    unsigned dots2len = 0;
+    unsigned gap = 0;
+
+    if (lineStyle.dashArray.size() >= 2)
+    {
+      dots1len = lineStyle.dashArray[0];
+      gap = lineStyle.dashArray[1];
+    }
+
+    unsigned long count = lineStyle.dashArray.size() / 2;
+    unsigned i = 0;
+    for (; i < count;)
+    {
+      if (dots1len == lineStyle.dashArray[2*i])
+        dots1++;
+      else
+        break;
+      gap = gap < lineStyle.dashArray[2*i+1] ?  lineStyle.dashArray[2*i+1] : gap;
+      i++;
+    }
+    if (i < count)
+    {
+      dots2len = lineStyle.dashArray[2*i];
+      gap = gap < lineStyle.dashArray[2*i+1] ? lineStyle.dashArray[2*i+1] : gap;
+    }
+    for (; i < count;)
+    {
+      if (dots2len == lineStyle.dashArray[2*i])
+        dots2++;
+      else
+        break;
+      gap = gap < lineStyle.dashArray[2*i+1] ? lineStyle.dashArray[2*i+1] : gap;
+      i++;
+    }
+    if (!dots2)
+    {
+      dots2 = dots1;
+      dots2len = dots1len;
+    }
+    propList.insert("draw:dots1", dots1);
+    propList.insert("draw:dots1-length", 72.0*(lineStyle.lineWidth * scale)*dots1len, librevenge::RVNG_POINT);
+    propList.insert("draw:dots2", dots2);
+    propList.insert("draw:dots2-length", 72.0*(lineStyle.lineWidth * scale)*dots2len, librevenge::RVNG_POINT);
+    propList.insert("draw:distance", 72.0*(lineStyle.lineWidth * scale)*gap, librevenge::RVNG_POINT);
+  }
+}
 
-  // Deal with line markers (arrows, etc.)
-  if (!m_currentLineStyle.startMarker.empty())
+void libcdr::CDRContentCollector::_lineMarkerProperties(librevenge::RVNGPropertyList &propList, const CDRLineStyle &lineStyle)
+{
+  if (lineStyle.startMarker && !lineStyle.startMarker->empty())
   {
-    CDRPath startMarker(m_currentLineStyle.startMarker);
+    CDRPath startMarker(*lineStyle.startMarker);
     startMarker.transform(m_currentTransforms);
     if (!m_groupTransforms.empty())
       startMarker.transform(m_groupTransforms.top());
@@ -1127,9 +1301,9 @@ void libcdr::CDRContentCollector::_lineProperties(librevenge::RVNGPropertyList &
     propList.insert("draw:marker-start-path", path);
     // propList.insert("draw:marker-start-width", width);
   }
-  if (!m_currentLineStyle.endMarker.empty())
+  if (lineStyle.endMarker && !lineStyle.endMarker->empty())
   {
-    CDRPath endMarker(m_currentLineStyle.endMarker);
+    CDRPath endMarker(*lineStyle.endMarker);
     endMarker.transform(m_currentTransforms);
     if (!m_groupTransforms.empty())
       endMarker.transform(m_groupTransforms.top());
@@ -1142,9 +1316,6 @@ void libcdr::CDRContentCollector::_lineProperties(librevenge::RVNGPropertyList &
     propList.insert("draw:marker-end-path", path);
     // propList.insert("draw:marker-end-width", width);
   }
-
-
-
 }
 
 void libcdr::CDRContentCollector::_generateBitmapFromPattern(librevenge::RVNGBinaryData &bitmap, const CDRPattern &pattern, const CDRColor &fgColor, const CDRColor &bgColor)
@@ -1220,9 +1391,9 @@ void libcdr::CDRContentCollector::_generateBitmapFromPattern(librevenge::RVNGBin
 
 void libcdr::CDRContentCollector::collectBitmap(unsigned imageId, double x1, double x2, double y1, double y2)
 {
-  auto iter = m_ps.m_bmps.find(imageId);
-  if (iter != m_ps.m_bmps.end())
-    m_currentImage = CDRImage(iter->second, x1, x2, y1, y2);
+  const librevenge::RVNGBinaryData *image = m_ps.getBmp(imageId);
+  if (image)
+    m_currentImage = CDRImage(*image, m_ps.getBmpId(imageId), x1, x2, y1, y2);
 }
 
 void libcdr::CDRContentCollector::collectPpdt(const std::vector<std::pair<double, double> > &points, const std::vector<unsigned> &knotVector)
@@ -1265,10 +1436,15 @@ void libcdr::CDRContentCollector::collectVectorPattern(unsigned id, const librev
   input->seek(0, librevenge::RVNG_SEEK_SET);
   if (!libcdr::CMXDocument::isSupported(input))
     return;
+  CDR_TRACE_SPAN(patternSpan, "collectVectorPattern");
+  CDR_TRACE_ARG(patternSpan, "bytes", data.size());
   input->seek(0, librevenge::RVNG_SEEK_SET);
   librevenge::RVNGStringVector svgOutput;
   librevenge::RVNGSVGDrawingGenerator generator(svgOutput, "");
-  if (!libcdr::CMXDocument::parse(input, &generator))
+  const CDRParseStatus status = libcdr::CMXDocument::parseWithOptions(input, &generator, m_patternOptions);
+  if (status == CDR_PARSE_CANCELLED || status == CDR_PARSE_DEADLINE_EXCEEDED)
+    throw ParseInterruptedException(status);
+  if (status != CDR_PARSE_SUCCESS)
     return;
   if (!svgOutput.empty())
   {
@@ -1276,7 +1452,7 @@ void libcdr::CDRContentCollector::collectVectorPattern(unsigned id, const librev
       "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n<!DOCTYPE svg PUBLIC \"-//W3C//DTD SVG 1.1//EN\" \"http://www.w3.org/Graphics/SVG/1.1/DTD/svg11.dtd\">\n";
     librevenge::RVNGBinaryData output((const unsigned char *)header, strlen(header));
     output.append((const unsigned char *)svgOutput[0].cstr(), strlen(svgOutput[0].cstr()));
-    m_ps.m_vects[id] = output;
+    _setVectorPattern(id, output);
   }
 #if DUMP_VECT
   librevenge::RVNGString filename;
@@ -16,10 +16,15 @@
 #include <vector>
 #include <stack>
 #include <queue>
+#include <tuple>
+#include <unordered_map>
 
 #include <librevenge/librevenge.h>
 
+#include "CDRParseOptionsImpl.h"
+
 #include "CDROutputElementList.h"
+#include "CDRPageIndex.h"
 #include "CDRTransforms.h"
 #include "CDRTypes.h"
 #include "CDRPath.h"
@@ -31,7 +36,10 @@ namespace libcdr
 class CDRContentCollector : public CDRCollector
 {
 public:
-  CDRContentCollector(CDRParserState &ps, librevenge::RVNGDrawingInterface *painter, bool reverseOrder = true);
+  // With page indices, every page is kept there instead of being drawn
+  CDRContentCollector(CDRParserState &ps, librevenge::RVNGDrawingInterface *painter, bool reverseOrder = true,
+                      const CDRParseOptionsImpl &options = CDRParseOptionsImpl(),
+                      std::vector<std::unique_ptr<CDRPageIndex> > *pageIndices = nullptr);
   ~CDRContentCollector() override;
 
   // collector functions
@@ -83,8 +91,64 @@ private:
   void _endPage();
   void _flushCurrentPath();
 
-  void _fillProperties(librevenge::RVNGPropertyList &propList);
-  void _lineProperties(librevenge::RVNGPropertyList &propList);
+  // Where the current fill or line style comes from
+  enum StyleSource
+  {
+    STYLE_SOURCE_DEFAULT = 0,
+    STYLE_SOURCE_ID,
+    STYLE_SOURCE_STYLE
+  };
+
+  struct StyleKey
+  {
+    StyleKey() : fillSource(STYLE_SOURCE_DEFAULT), fillId(0), lineSource(STYLE_SOURCE_DEFAULT), lineId(0), opacity(1.0) {}
+    bool operator<(const StyleKey &other) const
+    {
+      return std::tie(fillSource, fillId, lineSource, lineId, opacity)
+             < std::tie(other.fillSource, other.fillId, other.lineSource, other.lineId, other.opacity);
+    }
+    StyleSource fillSource;
+    unsigned fillId;
+    StyleSource lineSource;
+    unsigned lineId;
+    double opacity;
+  };
+
+  /* The part of an object's style that only depends on its fill and line
+     styles. It is built once per distinct StyleKey and copied into the
+     style of every object using it. */
+  struct StyleTemplate
+  {
+    StyleTemplate() : properties(), lineStyle(), imageFill(), hasImageFill(false), hasVectorFill(false), sharedId(0) {}
+    librevenge::RVNGPropertyList properties;
+    CDRLineStyle lineStyle;
+    CDRImageFill imageFill;
+    bool hasImageFill;
+    // the fill refers to the vector pattern imageFill.id
+    bool hasVectorFill;
+    // if non-zero, the template is the complete style and can be shared
+    unsigned sharedId;
+  };
+
+  struct GeometryHash
+  {
+    std::size_t operator()(const std::vector<double> &geometry) const;
+  };
+
+  void _geometryInstance(unsigned &geometryId, librevenge::RVNGString &geometryTransform);
+  void _pathToPage(double &x, double &y) const;
+  void _completeCurrentPath();
+  void _extendPageBox(CDRPathBBox &box, double x1, double y1, double x2, double y2) const;
+  bool _objectPageBox(double &xmin, double &ymin, double &xmax, double &ymax, double &margin);
+  bool _isVisible();
+  const StyleTemplate &_styleTemplate();
+  void _setVectorPattern(unsigned id, const librevenge::RVNGBinaryData &vect);
+  void _objectStyleProperties(librevenge::RVNGPropertyList &propList, const StyleTemplate &styleTemplate);
+  void _fillProperties(librevenge::RVNGPropertyList &propList, const CDRFillStyle &fillStyle);
+  void _fillImageProperties(librevenge::RVNGPropertyList &propList, const CDRImageFill &imageFill);
+  void _lineProperties(librevenge::RVNGPropertyList &propList, const CDRLineStyle &lineStyle);
+  void _lineWidthProperties(librevenge::RVNGPropertyList &propList, const CDRLineStyle &lineStyle, double scale);
+  void _lineMarkerProperties(librevenge::RVNGPropertyList &propList, const CDRLineStyle &lineStyle);
   void _generateBitmapFromPattern(librevenge::RVNGBinaryData &bitmap, const CDRPattern &pattern, const CDRColor &fgColor, const CDRColor &bgColor);
 
   librevenge::RVNGDrawingInterface *m_painter;
@@ -100,6 +164,10 @@ private:
   CDRLineStyle m_currentLineStyle;
   unsigned m_spnd;
   unsigned m_currentObjectLevel, m_currentGroupLevel, m_currentVectLevel, m_currentPageLevel, m_currentStyleId;
+  StyleKey m_currentStyleKey;
+  std::map<StyleKey, std::unique_ptr<StyleTemplate> > m_styleTemplates;
+  // replaced templates, kept alive for the output elements that still refer to them
+  std::vector<std::unique_ptr<StyleTemplate> > m_retiredStyleTemplates;
   CDRImage m_currentImage;
   const std::vector<CDRTextLine> *m_currentText;
   CDRBox m_currentBBox;
@@ -111,6 +179,7 @@ private:
   std::unique_ptr<CDRPolygon> m_polygon;
   bool m_isInPolygon;
   bool m_isInSpline;
+  CDROutputElementStorage m_outputElementStorage;
   std::stack<CDROutputElementList> *m_outputElementsStack;
   std::stack<CDROutputElementList> m_contentOutputElementsStack;
   std::stack<CDROutputElementList> m_fillOutputElementsStack;
@@ -122,6 +191,14 @@ private:
   CDRSplineData m_splineData;
   double m_fillOpacity;
   bool m_reverseOrder;
+  bool m_shareStyles;
+  bool m_instanceGeometry;
+  const CDRViewport m_viewport;
+  const double m_detailTolerance;
+  const CDRParseOptions m_patternOptions;
+  // ids of the geometries seen so far
+  std::unordered_map<std::vector<double>, unsigned, GeometryHash> m_geometries;
+  std::vector<std::unique_ptr<CDRPageIndex> > *m_pageIndices;
 
   CDRParserState &m_ps;
 };
@@ -14,6 +14,7 @@
 #include "CDRParser.h"
 #include "CDRContentCollector.h"
 #include "CDRStylesCollector.h"
+#include "CDRTrace.h"
 #include "libcdr_utils.h"
 #include "CDRDocumentStructure.h"
 
@@ -101,9 +102,17 @@ CDRPaintInterface class implementation when needed. This is often commonly calle
 */
 CDRAPI bool libcdr::CDRDocument::parse(librevenge::RVNGInputStream *input_, librevenge::RVNGDrawingInterface *painter)
 {
-  if (!input_ || !painter)
-    return false;
+  return parseWithOptions(input_, painter, CDRParseOptions()) == CDR_PARSE_SUCCESS;
+}
+
+namespace
+{
 
+// Draws the document with the painter, or keeps its pages in the indices if they are given
+CDRParseStatus parseDocument(librevenge::RVNGInputStream *input_, librevenge::RVNGDrawingInterface *painter,
+                             std::vector<std::unique_ptr<CDRPageIndex> > *pageIndices, const CDRParseOptionsImpl &options)
+{
+  CDR_TRACE_SPAN(parseSpan, "CDRDocument::parse");
   std::shared_ptr<librevenge::RVNGInputStream> input(input_, CDRDummyDeleter());
 
   input->seek(0, librevenge::RVNG_SEEK_SET);
@@ -112,36 +121,50 @@ CDRAPI bool libcdr::CDRDocument::parse(librevenge::RVNGInputStream *input_, libr
   try
   {
     version = getCDRVersion(input.get());
+    CDR_TRACE_ARG(parseSpan, "version", version);
     if (version)
     {
       input->seek(0, librevenge::RVNG_SEEK_SET);
       CDRParserState ps;
-      std::vector<std::unique_ptr<librevenge::RVNGInputStream>> dummyDataStreams;
-      CDRStylesCollector stylesCollector(ps);
-      CDRParser stylesParser(dummyDataStreams, &stylesCollector);
-      if (version >= 300)
-        retVal = stylesParser.parseRecords(input.get());
-      else
-        retVal = stylesParser.parseWaldo(input.get());
+      CDRExternalStreams dummyDataStreams;
+      CDRStylesCollector stylesCollector(ps, options);
+      CDRParser stylesParser(dummyDataStreams, &stylesCollector, options);
+      {
+        CDR_TRACE_SPAN(stylesSpan, "styles pass");
+        if (version >= 300)
+          retVal = stylesParser.parseRecords(input.get());
+        else
+          retVal = stylesParser.parseWaldo(input.get());
+        CDR_TRACE_ARG(stylesSpan, "pages", ps.m_pages.size());
+        CDR_TRACE_ARG(stylesSpan, "bitmaps", ps.m_bmps.size() + ps.m_pendingBmps.size());
+      }
+      ps.forgetBmpKeys();
       if (ps.m_pages.empty())
         retVal = false;
       if (retVal)
       {
+        CDR_TRACE_SPAN(contentSpan, "content pass");
         input->seek(0, librevenge::RVNG_SEEK_SET);
-        CDRContentCollector contentCollector(ps, painter);
-        CDRParser contentParser(dummyDataStreams, &contentCollector);
+        CDRContentCollector contentCollector(ps, painter, true, options, pageIndices);
+        CDRParser contentParser(dummyDataStreams, &contentCollector, options);
+        contentParser.setProgressPhase(CDR_PARSE_PHASE_CONTENT);
+        contentParser.setSkipBitmaps(true);
         if (version >= 300)
           retVal = contentParser.parseRecords(input.get());
         else
           retVal = contentParser.parseWaldo(input.get());
       }
-      return retVal;
+      return retVal ? CDR_PARSE_SUCCESS : CDR_PARSE_FAILURE;
     }
   }
   catch (libcdr::EndOfStreamException const &)
   {
     // This can only happen if isSupported() has not been called before
-    return false;
+    return CDR_PARSE_FAILURE;
+  }
+  catch (libcdr::ParseInterruptedException const &e)
+  {
+    return e.getStatus();
   }
 
   librevenge::RVNGInputStream *tmpInput = input_;
@@ -179,17 +202,8 @@ CDRAPI bool libcdr::CDRDocument::parse(librevenge::RVNGInputStream *input_, libr
         }
       }
     }
-    std::vector<std::unique_ptr<librevenge::RVNGInputStream>> dataStreams;
-    dataStreams.reserve(dataFiles.size());
-    for (const auto &dataFile : dataFiles)
-    {
-      std::string streamName("content/data/");
-      streamName += dataFile;
-      CDR_DEBUG_MSG(("Extracting stream: %s\n", streamName.c_str()));
-      tmpInput->seek(0, librevenge::RVNG_SEEK_SET);
-      std::unique_ptr<librevenge::RVNGInputStream> strm(tmpInput->getSubStreamByName(streamName.c_str()));
-      dataStreams.push_back(std::move(strm));
-    }
+    // The data streams are extracted when a record refers to them
+    CDRExternalStreams dataStreams(tmpInput, dataFiles);
     if (!input)
       input.reset(tmpInput, CDRDummyDeleter());
     CDRParserState ps;
@@ -207,17 +221,34 @@ CDRAPI bool libcdr::CDRDocument::parse(librevenge::RVNGInputStream *input_, libr
       if (rgbProfile)
         ps.setColorTransform(rgbProfile.get());
     }
-    CDRStylesCollector stylesCollector(ps);
-    CDRParser stylesParser(dataStreams, &stylesCollector);
+    // From here on, the container is only used through dataStreams
+    if (options.prefetchStreams)
+      dataStreams.prefetch();
+    CDRStylesCollector stylesCollector(ps, options);
+    CDRParser stylesParser(dataStreams, &stylesCollector, options);
     input->seek(0, librevenge::RVNG_SEEK_SET);
-    retVal = stylesParser.parseRecords(input.get());
+    {
+      CDR_TRACE_SPAN(stylesSpan, "styles pass");
+      retVal = stylesParser.parseRecords(input.get());
+      CDR_TRACE_ARG(stylesSpan, "pages", ps.m_pages.size());
+      CDR_TRACE_ARG(stylesSpan, "bitmaps", ps.m_bmps.size() + ps.m_pendingBmps.size());
+      CDR_TRACE_ARG(stylesSpan, "streams", dataStreams.size());
+    }
+    /* Bitmaps, the bulk of the data streams, are not read again by the
+       content pass. The streams that only held bitmaps are closed, the
+       ones with records of other kinds stay open for the content pass. */
+    dataStreams.releaseTransient();
+    ps.forgetBmpKeys();
     if (ps.m_pages.empty())
       retVal = false;
     if (retVal)
     {
+      CDR_TRACE_SPAN(contentSpan, "content pass");
       input->seek(0, librevenge::RVNG_SEEK_SET);
-      CDRContentCollector contentCollector(ps, painter);
-      CDRParser contentParser(dataStreams, &contentCollector);
+      CDRContentCollector contentCollector(ps, painter, true, options, pageIndices);
+      CDRParser contentParser(dataStreams, &contentCollector, options);
+      contentParser.setProgressPhase(CDR_PARSE_PHASE_CONTENT);
+      contentParser.setSkipBitmaps(true);
       retVal = contentParser.parseRecords(input.get());
     }
   }
@@ -225,7 +256,57 @@ CDRAPI bool libcdr::CDRDocument::parse(librevenge::RVNGInputStream *input_, libr
   {
     retVal = false;
   }
-  return retVal;
+  catch (libcdr::ParseInterruptedException const &e)
+  {
+    return e.getStatus();
+  }
+  return retVal ? CDR_PARSE_SUCCESS : CDR_PARSE_FAILURE;
+}
+
+} // anonymous namespace
+
+/**
+Parses the input stream content like parse, using the given options to
+control what is extracted from the document. Unlike parse, it returns
+CDR_PARSE_SUCCESS, which is 0, if the parsing was successful.
+\param input_ The input stream
+\param painter A CDRPainterInterface implementation
+\param options Options controlling the parsing
+\return A value that indicates whether the parsing was successful, or why it was
+stopped early
+*/
+CDRAPI libcdr::CDRParseStatus libcdr::CDRDocument::parseWithOptions(librevenge::RVNGInputStream *input_, librevenge::RVNGDrawingInterface *painter,
+                                                                    const CDRParseOptions &options)
+{
+  if (!input_ || !painter)
+    return CDR_PARSE_FAILURE;
+  return parseDocument(input_, painter, nullptr, *options.m_impl);
+}
+
+/**
+Parses the input stream content and keeps the drawing of its pages in an
+index instead of passing it to a painter, so that parts of the pages can
+be drawn later through CDRDocumentIndex::renderViewport.
+Like the other parseWithOptions, it returns CDR_PARSE_SUCCESS, which is 0,
+if the parsing was successful.
+\param input_ The input stream
+\param index The index to fill; its previous content is dropped, and it is
+left empty if the parsing fails
+\param options Options controlling the parsing
+
+\return A value that indicates whether the parsing was successful, or why it was
+stopped early
+*/
+CDRAPI libcdr::CDRParseStatus libcdr::CDRDocument::parseWithOptions(librevenge::RVNGInputStream *input_, CDRDocumentIndex &index,
+                                                                    const CDRParseOptions &options)
+{
+  index.m_impl->m_pages.clear();
+  if (!input_)
+    return CDR_PARSE_FAILURE;
+  const CDRParseStatus status = parseDocument(input_, nullptr, &index.m_impl->m_pages, *options.m_impl);
+  if (status != CDR_PARSE_SUCCESS)
+    index.m_impl->m_pages.clear();
+  return status;
 }
 
 /* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,51 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libcdr project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <libcdr/libcdr.h>
+#include "CDRPageIndex.h"
+
+CDRAPI libcdr::CDRDocumentIndex::CDRDocumentIndex()
+  : m_impl(new CDRDocumentIndexImpl())
+{
+}
+
+CDRAPI libcdr::CDRDocumentIndex::~CDRDocumentIndex()
+{
+  delete m_impl;
+}
+
+CDRAPI unsigned libcdr::CDRDocumentIndex::getPageCount() const
+{
+  return (unsigned)m_impl->m_pages.size();
+}
+
+/**
+Draws a part of a page of the parsed document.
+\param page The index of the page, starting with 0
+\param viewport The rectangle of the page to draw, in inches
+\param painter A RVNGDrawingInterface implementation
+\return A value that indicates whether the page exists
+*/
+CDRAPI bool libcdr::CDRDocumentIndex::renderViewport(unsigned page, const CDRViewport &viewport, librevenge::RVNGDrawingInterface *painter) const
+{
+  if (page >= m_impl->m_pages.size() || !painter)
+    return false;
+  const CDRPageIndex &pageIndex = *m_impl->m_pages[page];
+  librevenge::RVNGPropertyList propList;
+  painter->startDocument(propList);
+  propList.insert("svg:width", pageIndex.getWidth());
+  propList.insert("svg:height", pageIndex.getHeight());
+  painter->startPage(propList);
+  pageIndex.draw(painter, viewport);
+  painter->endPage();
+  painter->endDocument();
+  return true;
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
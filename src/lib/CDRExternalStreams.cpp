@@ -0,0 +1,145 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libcdr project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "CDRExternalStreams.h"
+
+#include "CDRTrace.h"
+#include "libcdr_utils.h"
+
+libcdr::CDRExternalStreams::CDRExternalStreams()
+  : m_container(nullptr), m_names(), m_streams(), m_states(), m_kept(), m_readers(0), m_mutex(), m_opened(),
+    m_containerMutex(), m_prefetcher(), m_stopPrefetch(false)
+{
+}
+
+libcdr::CDRExternalStreams::CDRExternalStreams(librevenge::RVNGInputStream *container, const std::vector<std::string> &names)
+  : m_container(container), m_names(names), m_streams(names.size()), m_states(names.size(), STREAM_CLOSED),
+    m_kept(names.size(), false), m_readers(0), m_mutex(), m_opened(), m_containerMutex(), m_prefetcher(), m_stopPrefetch(false)
+{
+}
+
+libcdr::CDRExternalStreams::~CDRExternalStreams()
+{
+  _stopPrefetch();
+}
+
+std::size_t libcdr::CDRExternalStreams::size() const
+{
+  return m_names.size();
+}
+
+librevenge::RVNGInputStream *libcdr::CDRExternalStreams::get(unsigned index, bool transient)
+{
+  if (index >= m_names.size())
+    return nullptr;
+  std::unique_lock<std::mutex> lock(m_mutex);
+  // the prefetcher may be extracting this very stream
+  while (m_states[index] == STREAM_OPENING)
+    m_opened.wait(lock);
+  // a stream that failed to open is not tried again
+  if (m_states[index] == STREAM_CLOSED)
+  {
+    m_states[index] = STREAM_OPENING;
+    ++m_readers;
+    lock.unlock();
+    librevenge::RVNGInputStream *stream = _extract(index);
+    lock.lock();
+    --m_readers;
+    m_streams[index].reset(stream);
+    m_states[index] = STREAM_OPENED;
+    m_opened.notify_all();
+  }
+  if (!transient)
+    m_kept[index] = true;
+  return m_streams[index].get();
+}
+
+void libcdr::CDRExternalStreams::prefetch()
+{
+  if (m_names.empty() || m_prefetcher.joinable())
+    return;
+  m_stopPrefetch = false;
+  try
+  {
+    m_prefetcher = std::thread(&CDRExternalStreams::_prefetch, this);
+  }
+  catch (const std::system_error &)
+  {
+    // the streams are extracted when they are needed, as without prefetch
+  }
+}
+
+void libcdr::CDRExternalStreams::releaseTransient()
+{
+  _stopPrefetch();
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (std::size_t index = 0; index < m_streams.size(); ++index)
+  {
+    if (m_kept[index])
+      continue;
+    m_streams[index].reset();
+    m_states[index] = STREAM_CLOSED;
+  }
+}
+
+librevenge::RVNGInputStream *libcdr::CDRExternalStreams::_extract(unsigned index)
+{
+  std::string streamName("content/data/");
+  streamName += m_names[index];
+  CDR_DEBUG_MSG(("Extracting stream: %s\n", streamName.c_str()));
+  std::lock_guard<std::mutex> lock(m_containerMutex);
+  CDR_TRACE_SPAN(openSpan, "open stream");
+  CDR_TRACE_ARG(openSpan, "index", index);
+  try
+  {
+    m_container->seek(0, librevenge::RVNG_SEEK_SET);
+    return m_container->getSubStreamByName(streamName.c_str());
+  }
+  catch (...)
+  {
+    return nullptr;
+  }
+}
+
+void libcdr::CDRExternalStreams::_prefetch()
+{
+  for (unsigned index = 0; index < m_names.size() && !m_stopPrefetch; ++index)
+  {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      // the parser needs its stream now, the rest can wait
+      while (m_readers && !m_stopPrefetch)
+        m_opened.wait(lock);
+      if (m_stopPrefetch)
+        break;
+      if (m_states[index] != STREAM_CLOSED)
+        continue;
+      m_states[index] = STREAM_OPENING;
+    }
+    librevenge::RVNGInputStream *stream = _extract(index);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_streams[index].reset(stream);
+    m_states[index] = STREAM_OPENED;
+    m_opened.notify_all();
+  }
+}
+
+void libcdr::CDRExternalStreams::_stopPrefetch()
+{
+  if (!m_prefetcher.joinable())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopPrefetch = true;
+  }
+  m_opened.notify_all();
+  m_prefetcher.join();
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
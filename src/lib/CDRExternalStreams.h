@@ -0,0 +1,87 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libcdr project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef __CDREXTERNALSTREAMS_H__
+#define __CDREXTERNALSTREAMS_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <librevenge-stream/librevenge-stream.h>
+
+namespace libcdr
+{
+
+/* The data streams of a zip based X6+ document, numbered in the order of
+   content/dataFileList.dat. A stream is only extracted from the container
+   when a record first refers to it, unless prefetch() extracts them ahead
+   on a background thread. Streams that were only read for records that
+   are not read again can be closed with releaseTransient(). */
+class CDRExternalStreams
+{
+public:
+  CDRExternalStreams();
+  CDRExternalStreams(librevenge::RVNGInputStream *container, const std::vector<std::string> &names);
+  ~CDRExternalStreams();
+
+  std::size_t size() const;
+  /* Returns null if there is no such stream or it cannot be opened. A
+     transient use does not keep the stream open through releaseTransient(). */
+  librevenge::RVNGInputStream *get(unsigned index, bool transient = false);
+  /* Starts extracting all streams in order on a background thread. The
+     container extracts one stream at a time, so get() of a stream that is
+     not extracted yet still waits for the one the thread is extracting,
+     but the thread then lets get() go first. If no thread can be started,
+     streams are only extracted by get(). */
+  void prefetch();
+  /* Stops prefetching and closes every stream that has only been got as
+     transient, or not at all. A closed stream is opened again if it is
+     needed after all. */
+  void releaseTransient();
+
+private:
+  enum StreamState
+  {
+    STREAM_CLOSED = 0,
+    STREAM_OPENING,
+    STREAM_OPENED
+  };
+
+  librevenge::RVNGInputStream *m_container;
+  std::vector<std::string> m_names;
+  std::vector<std::unique_ptr<librevenge::RVNGInputStream>> m_streams;
+  std::vector<StreamState> m_states;
+  std::vector<bool> m_kept;
+  // number of get() calls extracting a stream, which the prefetcher waits for
+  unsigned m_readers;
+  // guards m_streams, m_states, m_kept and m_readers
+  std::mutex m_mutex;
+  std::condition_variable m_opened;
+  // the container can only extract one stream at a time
+  std::mutex m_containerMutex;
+  std::thread m_prefetcher;
+  std::atomic<bool> m_stopPrefetch;
+
+  librevenge::RVNGInputStream *_extract(unsigned index);
+  void _prefetch();
+  void _stopPrefetch();
+  CDRExternalStreams(const CDRExternalStreams &);
+  CDRExternalStreams &operator=(const CDRExternalStreams &);
+};
+
+} // namespace libcdr
+
+#endif // __CDREXTERNALSTREAMS_H__
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -12,6 +12,8 @@
 #include <zlib.h>
 #include <string.h>  // for memcpy
 
+#include "CDRTrace.h"
+
 
 #define CHUNK 16384
 
@@ -43,6 +45,8 @@ libcdr::CDRInternalStream::CDRInternalStream(librevenge::RVNGInputStream *input,
   }
   else
   {
+    CDR_TRACE_SPAN(inflateSpan, "inflate");
+    CDR_TRACE_ARG(inflateSpan, "compressed bytes", size);
     int ret;
     z_stream strm;
     unsigned char out[CHUNK];
@@ -94,6 +98,7 @@ libcdr::CDRInternalStream::CDRInternalStream(librevenge::RVNGInputStream *input,
     }
     while (strm.avail_out == 0);
     (void)inflateEnd(&strm);
+    CDR_TRACE_ARG(inflateSpan, "bytes", m_buffer.size());
   }
 }
 
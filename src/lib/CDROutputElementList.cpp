@@ -9,6 +9,8 @@
 
 #include "CDROutputElementList.h"
 
+#include <algorithm>
+
 namespace libcdr
 {
 
@@ -96,323 +98,244 @@ static void separateSpacesAndInsertText(librevenge::RVNGDrawingInterface *iface,
 
 } // anonymous namespace
 
-class CDROutputElement
-{
-public:
-  CDROutputElement() {}
-  virtual ~CDROutputElement() {}
-  virtual void draw(librevenge::RVNGDrawingInterface *painter) = 0;
-};
-
-
-class CDRStyleOutputElement : public CDROutputElement
-{
-public:
-  CDRStyleOutputElement(const librevenge::RVNGPropertyList &propList);
-  ~CDRStyleOutputElement() override {}
-  void draw(librevenge::RVNGDrawingInterface *painter) override;
-private:
-  librevenge::RVNGPropertyList m_propList;
-};
-
-
-class CDRPathOutputElement : public CDROutputElement
-{
-public:
-  CDRPathOutputElement(const librevenge::RVNGPropertyList &propList);
-  ~CDRPathOutputElement() override {}
-  void draw(librevenge::RVNGDrawingInterface *painter) override;
-private:
-  librevenge::RVNGPropertyList m_propList;
-};
-
-
-class CDRGraphicObjectOutputElement : public CDROutputElement
-{
-public:
-  CDRGraphicObjectOutputElement(const librevenge::RVNGPropertyList &propList);
-  ~CDRGraphicObjectOutputElement() override {}
-  void draw(librevenge::RVNGDrawingInterface *painter) override;
-private:
-  librevenge::RVNGPropertyList m_propList;
-};
-
-
-class CDRStartTextObjectOutputElement : public CDROutputElement
-{
-public:
-  CDRStartTextObjectOutputElement(const librevenge::RVNGPropertyList &propList);
-  ~CDRStartTextObjectOutputElement() override {}
-  void draw(librevenge::RVNGDrawingInterface *painter) override;
-private:
-  librevenge::RVNGPropertyList m_propList;
-};
-
-
-class CDROpenParagraphOutputElement : public CDROutputElement
-{
-public:
-  CDROpenParagraphOutputElement(const librevenge::RVNGPropertyList &propList);
-  ~CDROpenParagraphOutputElement() override {}
-  void draw(librevenge::RVNGDrawingInterface *painter) override;
-private:
-  librevenge::RVNGPropertyList m_propList;
-};
-
-
-class CDROpenSpanOutputElement : public CDROutputElement
+CDROutputElementStorage::CDROutputElementStorage(bool useArena)
+  : m_propLists(), m_texts(), m_sharedPropLists(), m_arena(useArena ? new CDRArena() : nullptr)
 {
-public:
-  CDROpenSpanOutputElement(const librevenge::RVNGPropertyList &propList);
-  ~CDROpenSpanOutputElement() override {}
-  void draw(librevenge::RVNGDrawingInterface *painter) override;
-private:
-  librevenge::RVNGPropertyList m_propList;
-};
-
-
-class CDRInsertTextOutputElement : public CDROutputElement
-{
-public:
-  CDRInsertTextOutputElement(const librevenge::RVNGString &text);
-  ~CDRInsertTextOutputElement() override {}
-  void draw(librevenge::RVNGDrawingInterface *painter) override;
-private:
-  librevenge::RVNGString m_text;
-};
-
-
-class CDRCloseSpanOutputElement : public CDROutputElement
-{
-public:
-  CDRCloseSpanOutputElement();
-  ~CDRCloseSpanOutputElement() override {}
-  void draw(librevenge::RVNGDrawingInterface *painter) override;
-};
-
-
-class CDRCloseParagraphOutputElement : public CDROutputElement
-{
-public:
-  CDRCloseParagraphOutputElement();
-  ~CDRCloseParagraphOutputElement() override {}
-  void draw(librevenge::RVNGDrawingInterface *painter) override;
-};
-
-
-class CDREndTextObjectOutputElement : public CDROutputElement
-{
-public:
-  CDREndTextObjectOutputElement();
-  ~CDREndTextObjectOutputElement() override {}
-  void draw(librevenge::RVNGDrawingInterface *painter) override;
-};
-
-class CDRStartLayerOutputElement : public CDROutputElement
-{
-public:
-  CDRStartLayerOutputElement(const librevenge::RVNGPropertyList &propList);
-  ~CDRStartLayerOutputElement() override {}
-  void draw(librevenge::RVNGDrawingInterface *painter) override;
-private:
-  librevenge::RVNGPropertyList m_propList;
-};
+}
 
-class CDREndLayerOutputElement : public CDROutputElement
+CDROutputElementStorage::~CDROutputElementStorage()
 {
-public:
-  CDREndLayerOutputElement();
-  ~CDREndLayerOutputElement() override {}
-  void draw(librevenge::RVNGDrawingInterface *painter) override;
-};
-
-CDRStyleOutputElement::CDRStyleOutputElement(const librevenge::RVNGPropertyList &propList) :
-  m_propList(propList) {}
+}
 
-void CDRStyleOutputElement::draw(librevenge::RVNGDrawingInterface *painter)
+librevenge::RVNGPropertyList &CDROutputElementStorage::addPropList()
 {
-  if (painter)
-    painter->setStyle(m_propList);
+  m_propLists.emplace_back();
+  return m_propLists.back();
 }
 
-
-CDRPathOutputElement::CDRPathOutputElement(const librevenge::RVNGPropertyList &propList) :
-  m_propList(propList) {}
-
-void CDRPathOutputElement::draw(librevenge::RVNGDrawingInterface *painter)
+const librevenge::RVNGPropertyList &CDROutputElementStorage::addSharedPropList(unsigned id, const librevenge::RVNGPropertyList &propList)
 {
-  if (painter)
-    painter->drawPath(m_propList);
+  auto iter = m_sharedPropLists.find(id);
+  if (iter == m_sharedPropLists.end())
+  {
+    librevenge::RVNGPropertyList &copy = addPropList();
+    copy = propList;
+    iter = m_sharedPropLists.insert(std::make_pair(id, &copy)).first;
+  }
+  return *iter->second;
 }
 
-
-CDRGraphicObjectOutputElement::CDRGraphicObjectOutputElement(const librevenge::RVNGPropertyList &propList) :
-  m_propList(propList) {}
-
-void CDRGraphicObjectOutputElement::draw(librevenge::RVNGDrawingInterface *painter)
+CDRArenaAllocator<char> CDROutputElementStorage::getAllocator() const
 {
-  if (painter)
-    painter->drawGraphicObject(m_propList);
+  return CDRArenaAllocator<char>(m_arena.get());
 }
 
-
-CDRStartTextObjectOutputElement::CDRStartTextObjectOutputElement(const librevenge::RVNGPropertyList &propList) :
-  m_propList(propList) {}
-
-void CDRStartTextObjectOutputElement::draw(librevenge::RVNGDrawingInterface *painter)
+const librevenge::RVNGString &CDROutputElementStorage::addText(const librevenge::RVNGString &text)
 {
-  if (painter)
-    painter->startTextObject(m_propList);
+  m_texts.push_back(text);
+  return m_texts.back();
 }
 
-CDROpenSpanOutputElement::CDROpenSpanOutputElement(const librevenge::RVNGPropertyList &propList) :
-  m_propList(propList) {}
-
-void CDROpenSpanOutputElement::draw(librevenge::RVNGDrawingInterface *painter)
+void CDROutputElementStorage::clear()
 {
-  if (painter)
-    painter->openSpan(m_propList);
+  m_propLists.clear();
+  m_texts.clear();
+  m_sharedPropLists.clear();
+  if (m_arena)
+    m_arena->reset();
 }
 
 
-CDROpenParagraphOutputElement::CDROpenParagraphOutputElement(const librevenge::RVNGPropertyList &propList) :
-  m_propList(propList) {}
-
-void CDROpenParagraphOutputElement::draw(librevenge::RVNGDrawingInterface *painter)
+CDROutputElementList::CDROutputElementList(CDROutputElementStorage &storage)
+  : m_storage(&storage), m_elements(storage.getAllocator()), m_hasBounds(false), m_bounds()
 {
-  if (painter)
-    painter->openParagraph(m_propList);
 }
 
-
-CDRInsertTextOutputElement::CDRInsertTextOutputElement(const librevenge::RVNGString &text) :
-  m_text(text) {}
-
-void CDRInsertTextOutputElement::draw(librevenge::RVNGDrawingInterface *painter)
+CDROutputElementList::CDROutputElementList(const CDROutputElementList &other, CDROutputElementStorage &storage)
+  : m_storage(&storage), m_elements(storage.getAllocator()), m_hasBounds(other.m_hasBounds), m_bounds()
 {
-  if (painter)
-    separateSpacesAndInsertText(painter, m_text);
+  std::copy(other.m_bounds, other.m_bounds + 4, m_bounds);
+  m_elements.reserve(other.m_elements.size());
+  for (const auto &element : other.m_elements)
+  {
+    Element copy = element;
+    if (element.propList)
+    {
+      if (element.styleId)
+        copy.propList = &storage.addSharedPropList(element.styleId, *element.propList);
+      else
+      {
+        librevenge::RVNGPropertyList &propList = storage.addPropList();
+        propList = *element.propList;
+        copy.propList = &propList;
+      }
+    }
+    if (element.text)
+      copy.text = &storage.addText(*element.text);
+    m_elements.push_back(copy);
+  }
 }
 
-CDRCloseSpanOutputElement::CDRCloseSpanOutputElement() {}
-
-void CDRCloseSpanOutputElement::draw(librevenge::RVNGDrawingInterface *painter)
+CDROutputElementList::~CDROutputElementList()
 {
-  if (painter)
-    painter->closeSpan();
 }
 
-
-CDRCloseParagraphOutputElement::CDRCloseParagraphOutputElement() {}
-
-void CDRCloseParagraphOutputElement::draw(librevenge::RVNGDrawingInterface *painter)
+void CDROutputElementList::setBounds(double xmin, double ymin, double xmax, double ymax)
 {
-  if (painter)
-    painter->closeParagraph();
+  m_hasBounds = true;
+  m_bounds[0] = xmin;
+  m_bounds[1] = ymin;
+  m_bounds[2] = xmax;
+  m_bounds[3] = ymax;
 }
 
-
-CDREndTextObjectOutputElement::CDREndTextObjectOutputElement() {}
-
-void CDREndTextObjectOutputElement::draw(librevenge::RVNGDrawingInterface *painter)
+bool CDROutputElementList::getBounds(double &xmin, double &ymin, double &xmax, double &ymax) const
 {
-  if (painter)
-    painter->endTextObject();
+  if (!m_hasBounds)
+    return false;
+  xmin = m_bounds[0];
+  ymin = m_bounds[1];
+  xmax = m_bounds[2];
+  ymax = m_bounds[3];
+  return true;
 }
 
-
-CDREndLayerOutputElement::CDREndLayerOutputElement() {}
-
-void CDREndLayerOutputElement::draw(librevenge::RVNGDrawingInterface *painter)
+void CDROutputElementList::draw(librevenge::RVNGDrawingInterface *painter) const
 {
-  if (painter)
-    painter->endLayer();
+  unsigned currentStyleId = 0;
+  draw(painter, currentStyleId);
 }
 
-
-CDRStartLayerOutputElement::CDRStartLayerOutputElement(const librevenge::RVNGPropertyList &propList) :
-  m_propList(propList) {}
-
-void CDRStartLayerOutputElement::draw(librevenge::RVNGDrawingInterface *painter)
+void CDROutputElementList::draw(librevenge::RVNGDrawingInterface *painter, unsigned &currentStyleId) const
 {
-  if (painter)
-    painter->startLayer(m_propList);
+  if (!painter)
+    return;
+  for (const auto &element : m_elements)
+  {
+    switch (element.opcode)
+    {
+    case OP_STYLE:
+      if (!element.styleId || element.styleId != currentStyleId)
+        painter->setStyle(*element.propList);
+      currentStyleId = element.styleId;
+      break;
+    case OP_PATH:
+      painter->drawPath(*element.propList);
+      break;
+    case OP_GRAPHIC_OBJECT:
+      painter->drawGraphicObject(*element.propList);
+      break;
+    case OP_START_TEXT_OBJECT:
+      painter->startTextObject(*element.propList);
+      break;
+    case OP_OPEN_PARAGRAPH:
+      painter->openParagraph(*element.propList);
+      break;
+    case OP_OPEN_SPAN:
+      painter->openSpan(*element.propList);
+      break;
+    case OP_INSERT_TEXT:
+      separateSpacesAndInsertText(painter, *element.text);
+      break;
+    case OP_CLOSE_SPAN:
+      painter->closeSpan();
+      break;
+    case OP_CLOSE_PARAGRAPH:
+      painter->closeParagraph();
+      break;
+    case OP_END_TEXT_OBJECT:
+      painter->endTextObject();
+      break;
+    case OP_START_LAYER:
+      painter->startLayer(*element.propList);
+      break;
+    case OP_END_LAYER:
+      painter->endLayer();
+      break;
+    default:
+      break;
+    }
+  }
 }
 
-
-CDROutputElementList::CDROutputElementList()
-  : m_elements()
+librevenge::RVNGPropertyList &CDROutputElementList::_addElement(Opcode opcode)
 {
+  librevenge::RVNGPropertyList &propList = m_storage->addPropList();
+  Element element = { opcode, 0, &propList, nullptr };
+  m_elements.push_back(element);
+  return propList;
 }
 
-CDROutputElementList::~CDROutputElementList()
+void CDROutputElementList::_addElement(Opcode opcode, const librevenge::RVNGString *text)
 {
+  Element element = { opcode, 0, nullptr, text };
+  m_elements.push_back(element);
 }
 
-void CDROutputElementList::draw(librevenge::RVNGDrawingInterface *painter) const
+librevenge::RVNGPropertyList &CDROutputElementList::addStyle()
 {
-  for (const auto &element : m_elements)
-    element->draw(painter);
+  return _addElement(OP_STYLE);
 }
 
-void CDROutputElementList::addStyle(const librevenge::RVNGPropertyList &propList)
+void CDROutputElementList::addStyle(const librevenge::RVNGPropertyList &style, unsigned styleId)
 {
-  m_elements.push_back(std::make_shared<CDRStyleOutputElement>(propList));
+  Element element = { OP_STYLE, styleId, &style, nullptr };
+  m_elements.push_back(element);
 }
 
-void CDROutputElementList::addPath(const librevenge::RVNGPropertyList &propList)
+librevenge::RVNGPropertyList &CDROutputElementList::addPath()
 {
-  m_elements.push_back(std::make_shared<CDRPathOutputElement>(propList));
+  return _addElement(OP_PATH);
 }
 
-void CDROutputElementList::addGraphicObject(const librevenge::RVNGPropertyList &propList)
+librevenge::RVNGPropertyList &CDROutputElementList::addGraphicObject()
 {
-  m_elements.push_back(std::make_shared<CDRGraphicObjectOutputElement>(propList));
+  return _addElement(OP_GRAPHIC_OBJECT);
 }
 
-void CDROutputElementList::addStartTextObject(const librevenge::RVNGPropertyList &propList)
+librevenge::RVNGPropertyList &CDROutputElementList::addStartTextObject()
 {
-  m_elements.push_back(std::make_shared<CDRStartTextObjectOutputElement>(propList));
+  return _addElement(OP_START_TEXT_OBJECT);
 }
 
-void CDROutputElementList::addOpenParagraph(const librevenge::RVNGPropertyList &propList)
+librevenge::RVNGPropertyList &CDROutputElementList::addOpenParagraph()
 {
-  m_elements.push_back(std::make_shared<CDROpenParagraphOutputElement>(propList));
+  return _addElement(OP_OPEN_PARAGRAPH);
 }
 
-void CDROutputElementList::addOpenSpan(const librevenge::RVNGPropertyList &propList)
+librevenge::RVNGPropertyList &CDROutputElementList::addOpenSpan()
 {
-  m_elements.push_back(std::make_shared<CDROpenSpanOutputElement>(propList));
+  return _addElement(OP_OPEN_SPAN);
 }
 
 void CDROutputElementList::addInsertText(const librevenge::RVNGString &text)
 {
-  m_elements.push_back(std::make_shared<CDRInsertTextOutputElement>(text));
+  _addElement(OP_INSERT_TEXT, &m_storage->addText(text));
 }
 
 void CDROutputElementList::addCloseSpan()
 {
-  m_elements.push_back(std::make_shared<CDRCloseSpanOutputElement>());
+  _addElement(OP_CLOSE_SPAN, nullptr);
 }
 
 void CDROutputElementList::addCloseParagraph()
 {
-  m_elements.push_back(std::make_shared<CDRCloseParagraphOutputElement>());
+  _addElement(OP_CLOSE_PARAGRAPH, nullptr);
 }
 
 void CDROutputElementList::addEndTextObject()
 {
-  m_elements.push_back(std::make_shared<CDREndTextObjectOutputElement>());
+  _addElement(OP_END_TEXT_OBJECT, nullptr);
 }
 
-void CDROutputElementList::addStartGroup(const librevenge::RVNGPropertyList &propList)
+librevenge::RVNGPropertyList &CDROutputElementList::addStartGroup()
 {
-  m_elements.push_back(std::make_shared<CDRStartLayerOutputElement>(propList));
+  return _addElement(OP_START_LAYER);
 }
 
 void CDROutputElementList::addEndGroup()
 {
-  m_elements.push_back(std::make_shared<CDREndLayerOutputElement>());
+  _addElement(OP_END_LAYER, nullptr);
 }
 
 } // namespace libcdr
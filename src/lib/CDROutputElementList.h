@@ -10,40 +10,113 @@
 #ifndef __CDROUTPUTELEMENTLIST_H__
 #define __CDROUTPUTELEMENTLIST_H__
 
+#include <deque>
+#include <map>
 #include <memory>
 #include <vector>
 
 #include <librevenge/librevenge.h>
 
+#include "CDRArena.h"
+
 namespace libcdr
 {
 
-class CDROutputElement;
+/* Owns the property lists and texts referenced by output element lists.
+   The content collector keeps one instance and releases everything in
+   bulk once the lists of a page have been drawn. */
+class CDROutputElementStorage
+{
+public:
+  explicit CDROutputElementStorage(bool useArena = false);
+  ~CDROutputElementStorage();
+  librevenge::RVNGPropertyList &addPropList();
+  // Returns the copy of the shared style with this id, creating it if needed
+  const librevenge::RVNGPropertyList &addSharedPropList(unsigned id, const librevenge::RVNGPropertyList &propList);
+  CDRArenaAllocator<char> getAllocator() const;
+  const librevenge::RVNGString &addText(const librevenge::RVNGString &text);
+  void clear();
+private:
+  CDROutputElementStorage(const CDROutputElementStorage &);
+  CDROutputElementStorage &operator=(const CDROutputElementStorage &);
+
+  // deques do not move their elements when growing
+  std::deque<librevenge::RVNGPropertyList> m_propLists;
+  std::deque<librevenge::RVNGString> m_texts;
+  std::map<unsigned, const librevenge::RVNGPropertyList *> m_sharedPropLists;
+  // backs the element vectors of the lists, if enabled
+  std::unique_ptr<CDRArena> m_arena;
+};
 
+/* Sequence of painter calls. The add functions that take properties
+   return a list owned by the storage, which the caller fills in place.
+   Shared styles are referenced instead and must outlive the list; a
+   shared style is not set again if it is already the current one. */
 class CDROutputElementList
 {
 public:
-  CDROutputElementList();
+  explicit CDROutputElementList(CDROutputElementStorage &storage);
+  // Copies share the storage of the original
+  CDROutputElementList(const CDROutputElementList &other) = default;
+  CDROutputElementList &operator=(const CDROutputElementList &other) = default;
+  // Copies the list with its properties and texts into another storage
+  CDROutputElementList(const CDROutputElementList &other, CDROutputElementStorage &storage);
   ~CDROutputElementList();
   void draw(librevenge::RVNGDrawingInterface *painter) const;
-  void addStyle(const librevenge::RVNGPropertyList &propList);
-  void addPath(const librevenge::RVNGPropertyList &propList);
-  void addGraphicObject(const librevenge::RVNGPropertyList &propList);
-  void addStartTextObject(const librevenge::RVNGPropertyList &propList);
-  void addOpenParagraph(const librevenge::RVNGPropertyList &propList);
-  void addOpenSpan(const librevenge::RVNGPropertyList &propList);
+  void draw(librevenge::RVNGDrawingInterface *painter, unsigned &currentStyleId) const;
+  librevenge::RVNGPropertyList &addStyle();
+  void addStyle(const librevenge::RVNGPropertyList &style, unsigned styleId);
+  librevenge::RVNGPropertyList &addPath();
+  librevenge::RVNGPropertyList &addGraphicObject();
+  librevenge::RVNGPropertyList &addStartTextObject();
+  librevenge::RVNGPropertyList &addOpenParagraph();
+  librevenge::RVNGPropertyList &addOpenSpan();
   void addInsertText(const librevenge::RVNGString &text);
   void addCloseSpan();
   void addCloseParagraph();
   void addEndTextObject();
-  void addStartGroup(const librevenge::RVNGPropertyList &propList);
+  librevenge::RVNGPropertyList &addStartGroup();
   void addEndGroup();
   bool empty() const
   {
     return m_elements.empty();
   }
+  // The extent of the output on the page, if it is known
+  void setBounds(double xmin, double ymin, double xmax, double ymax);
+  bool getBounds(double &xmin, double &ymin, double &xmax, double &ymax) const;
 private:
-  std::vector<std::shared_ptr<CDROutputElement>> m_elements;
+  enum Opcode
+  {
+    OP_STYLE,
+    OP_PATH,
+    OP_GRAPHIC_OBJECT,
+    OP_START_TEXT_OBJECT,
+    OP_OPEN_PARAGRAPH,
+    OP_OPEN_SPAN,
+    OP_INSERT_TEXT,
+    OP_CLOSE_SPAN,
+    OP_CLOSE_PARAGRAPH,
+    OP_END_TEXT_OBJECT,
+    OP_START_LAYER,
+    OP_END_LAYER
+  };
+
+  struct Element
+  {
+    Opcode opcode;
+    // id of a shared style, 0 otherwise
+    unsigned styleId;
+    const librevenge::RVNGPropertyList *propList;
+    const librevenge::RVNGString *text;
+  };
+
+  librevenge::RVNGPropertyList &_addElement(Opcode opcode);
+  void _addElement(Opcode opcode, const librevenge::RVNGString *text);
+
+  CDROutputElementStorage *m_storage;
+  std::vector<Element, CDRArenaAllocator<Element> > m_elements;
+  bool m_hasBounds;
+  double m_bounds[4];
 };
 
 
@@ -0,0 +1,122 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libcdr project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "CDRPageIndex.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace
+{
+
+// The grid has about this many objects per cell, up to a maximum size
+const unsigned OBJECTS_PER_CELL = 8;
+const unsigned MAX_GRID_SIZE = 256;
+// Objects covering more cells are tested for every viewport instead
+const unsigned MAX_OBJECT_CELLS = 64;
+
+unsigned cellOf(double value, double size, unsigned count)
+{
+  if (!(value > 0.0) || size <= 0.0)
+    return 0;
+  const double cell = value / size * count;
+  if (cell >= (double)(count - 1))
+    return count - 1;
+  return (unsigned)cell;
+}
+
+}
+
+libcdr::CDRPageIndex::CDRPageIndex(double width, double height)
+  : m_width(width), m_height(height), m_storage(), m_objects(), m_bounds(), m_unindexed(),
+    m_columns(0), m_rows(0), m_cells()
+{
+}
+
+libcdr::CDRPageIndex::~CDRPageIndex()
+{
+}
+
+void libcdr::CDRPageIndex::addObject(const CDROutputElementList &object)
+{
+  Bounds bounds = { -HUGE_VAL, -HUGE_VAL, HUGE_VAL, HUGE_VAL };
+  object.getBounds(bounds.xmin, bounds.ymin, bounds.xmax, bounds.ymax);
+  m_objects.emplace_back(object, m_storage);
+  m_bounds.push_back(bounds);
+}
+
+void libcdr::CDRPageIndex::_cellRange(const Bounds &bounds, unsigned &column1, unsigned &row1, unsigned &column2, unsigned &row2) const
+{
+  column1 = cellOf(bounds.xmin, m_width, m_columns);
+  column2 = cellOf(bounds.xmax, m_width, m_columns);
+  row1 = cellOf(bounds.ymin, m_height, m_rows);
+  row2 = cellOf(bounds.ymax, m_height, m_rows);
+}
+
+void libcdr::CDRPageIndex::finish()
+{
+  const unsigned size = std::min(MAX_GRID_SIZE, (unsigned)ceil(sqrt((double)m_objects.size() / OBJECTS_PER_CELL)));
+  m_columns = std::max(size, 1U);
+  m_rows = m_columns;
+  m_cells.assign(m_columns * m_rows, std::vector<unsigned>());
+  m_unindexed.clear();
+  // Objects outside of the page end up in the border cells
+  for (unsigned i = 0; i < m_objects.size(); ++i)
+  {
+    const Bounds &bounds = m_bounds[i];
+    unsigned column1 = 0, row1 = 0, column2 = 0, row2 = 0;
+    _cellRange(bounds, column1, row1, column2, row2);
+    if (bounds.xmin == -HUGE_VAL || (column2 - column1 + 1) * (row2 - row1 + 1) > MAX_OBJECT_CELLS)
+    {
+      m_unindexed.push_back(i);
+      continue;
+    }
+    for (unsigned row = row1; row <= row2; ++row)
+    {
+      for (unsigned column = column1; column <= column2; ++column)
+        m_cells[row * m_columns + column].push_back(i);
+    }
+  }
+}
+
+void libcdr::CDRPageIndex::draw(librevenge::RVNGDrawingInterface *painter, const CDRViewport &viewport) const
+{
+  unsigned currentStyleId = 0;
+  if (!(viewport.width > 0.0 && viewport.height > 0.0))
+  {
+    for (const auto &object : m_objects)
+      object.draw(painter, currentStyleId);
+    return;
+  }
+
+  const Bounds area = { viewport.x, viewport.y, viewport.x + viewport.width, viewport.y + viewport.height };
+  std::vector<unsigned> candidates(m_unindexed);
+  unsigned column1 = 0, row1 = 0, column2 = 0, row2 = 0;
+  _cellRange(area, column1, row1, column2, row2);
+  for (unsigned row = row1; row <= row2; ++row)
+  {
+    for (unsigned column = column1; column <= column2; ++column)
+    {
+      const std::vector<unsigned> &cell = m_cells[row * m_columns + column];
+      candidates.insert(candidates.end(), cell.begin(), cell.end());
+    }
+  }
+  // back to the paint order, without the objects found in several cells
+  std::sort(candidates.begin(), candidates.end());
+  candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+  for (unsigned i : candidates)
+  {
+    const Bounds &bounds = m_bounds[i];
+    if (bounds.xmax < area.xmin || bounds.xmin > area.xmax || bounds.ymax < area.ymin || bounds.ymin > area.ymax)
+      continue;
+    m_objects[i].draw(painter, currentStyleId);
+  }
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,88 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libcdr project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef __CDRPAGEINDEX_H__
+#define __CDRPAGEINDEX_H__
+
+#include <memory>
+#include <vector>
+
+#include <librevenge/librevenge.h>
+
+#include <libcdr/CDRParseOptions.h>
+
+#include "CDROutputElementList.h"
+
+namespace libcdr
+{
+
+/* The output of one page, kept to be drawn any number of times. The
+   objects are entered in a grid over the page by their bounds, so that
+   drawing a small part of a big page only visits the objects near it.
+   Output without bounds, like group marks, is drawn every time. */
+class CDRPageIndex
+{
+public:
+  CDRPageIndex(double width, double height);
+  ~CDRPageIndex();
+
+  // Copies the list
+  void addObject(const CDROutputElementList &object);
+  // Builds the grid; called once all the objects are added
+  void finish();
+  void draw(librevenge::RVNGDrawingInterface *painter, const CDRViewport &viewport) const;
+
+  double getWidth() const
+  {
+    return m_width;
+  }
+  double getHeight() const
+  {
+    return m_height;
+  }
+
+private:
+  CDRPageIndex(const CDRPageIndex &);
+  CDRPageIndex &operator=(const CDRPageIndex &);
+
+  struct Bounds
+  {
+    double xmin;
+    double ymin;
+    double xmax;
+    double ymax;
+  };
+
+  void _cellRange(const Bounds &bounds, unsigned &column1, unsigned &row1, unsigned &column2, unsigned &row2) const;
+
+  double m_width;
+  double m_height;
+  CDROutputElementStorage m_storage;
+  std::vector<CDROutputElementList> m_objects;
+  std::vector<Bounds> m_bounds;
+  // objects that are tested for every viewport: the ones without bounds
+  // and the ones covering too many cells
+  std::vector<unsigned> m_unindexed;
+  unsigned m_columns;
+  unsigned m_rows;
+  std::vector<std::vector<unsigned> > m_cells;
+};
+
+class CDRDocumentIndexImpl
+{
+public:
+  CDRDocumentIndexImpl() : m_pages() {}
+
+  std::vector<std::unique_ptr<CDRPageIndex> > m_pages;
+};
+
+} // namespace libcdr
+
+#endif // __CDRPAGEINDEX_H__
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,99 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libcdr project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <libcdr/libcdr.h>
+#include "CDRParseOptionsImpl.h"
+
+CDRAPI libcdr::CDRParseOptions::CDRParseOptions()
+  : m_impl(new CDRParseOptionsImpl())
+{
+}
+
+CDRAPI libcdr::CDRParseOptions::CDRParseOptions(const CDRParseOptions &other)
+  : m_impl(new CDRParseOptionsImpl(*other.m_impl))
+{
+}
+
+CDRAPI libcdr::CDRParseOptions::~CDRParseOptions()
+{
+  delete m_impl;
+}
+
+CDRAPI libcdr::CDRParseOptions &libcdr::CDRParseOptions::operator=(const CDRParseOptions &other)
+{
+  *m_impl = *other.m_impl;
+  return *this;
+}
+
+CDRAPI void libcdr::CDRParseOptions::setTextOnly(bool textOnly)
+{
+  m_impl->textOnly = textOnly;
+}
+
+CDRAPI void libcdr::CDRParseOptions::setCancelFlag(const std::atomic<bool> *cancelFlag)
+{
+  m_impl->cancelFlag = cancelFlag;
+}
+
+CDRAPI void libcdr::CDRParseOptions::setDeadline(std::chrono::steady_clock::time_point deadline)
+{
+  m_impl->deadline = deadline;
+}
+
+CDRAPI void libcdr::CDRParseOptions::setProgressCallback(const std::function<void (const CDRParseProgress &)> &progressCallback)
+{
+  m_impl->progressCallback = progressCallback;
+}
+
+CDRAPI void libcdr::CDRParseOptions::setProgressInterval(std::chrono::steady_clock::duration progressInterval)
+{
+  m_impl->progressInterval = progressInterval;
+}
+
+CDRAPI void libcdr::CDRParseOptions::setMaxBitmapPixels(unsigned long maxBitmapPixels)
+{
+  m_impl->maxBitmapPixels = maxBitmapPixels;
+}
+
+CDRAPI void libcdr::CDRParseOptions::setUseArena(bool useArena)
+{
+  m_impl->useArena = useArena;
+}
+
+CDRAPI void libcdr::CDRParseOptions::setShareStyles(bool shareStyles)
+{
+  m_impl->shareStyles = shareStyles;
+}
+
+CDRAPI void libcdr::CDRParseOptions::setInstanceGeometry(bool instanceGeometry)
+{
+  m_impl->instanceGeometry = instanceGeometry;
+}
+
+CDRAPI void libcdr::CDRParseOptions::setViewport(const CDRViewport &viewport)
+{
+  m_impl->viewport = viewport;
+}
+
+CDRAPI void libcdr::CDRParseOptions::setDetailTolerance(double detailTolerance)
+{
+  m_impl->detailTolerance = detailTolerance;
+}
+
+CDRAPI void libcdr::CDRParseOptions::setPrefetchStreams(bool prefetchStreams)
+{
+  m_impl->prefetchStreams = prefetchStreams;
+}
+
+CDRAPI void libcdr::CDRParseOptions::setBitmapThreads(unsigned bitmapThreads)
+{
+  m_impl->bitmapThreads = bitmapThreads;
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
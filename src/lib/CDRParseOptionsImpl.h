@@ -0,0 +1,63 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libcdr project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef __CDRPARSEOPTIONSIMPL_H__
+#define __CDRPARSEOPTIONSIMPL_H__
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+#include <libcdr/CDRParseOptions.h>
+
+namespace libcdr
+{
+
+/* The values behind CDRParseOptions, which the parsers and collectors
+   read directly. The setters of CDRParseOptions describe every field. */
+class CDRParseOptionsImpl
+{
+public:
+  CDRParseOptionsImpl()
+    : textOnly(false)
+    , cancelFlag(nullptr)
+    , deadline(std::chrono::steady_clock::time_point::max())
+    , progressCallback()
+    , progressInterval(std::chrono::milliseconds(100))
+    , maxBitmapPixels(0)
+    , useArena(false)
+    , shareStyles(false)
+    , instanceGeometry(false)
+    , viewport()
+    , detailTolerance(0.0)
+    , prefetchStreams(false)
+    , bitmapThreads(0) {}
+  // The cancel flag is not owned, copies refer to the same one
+  CDRParseOptionsImpl(const CDRParseOptionsImpl &other) = default;
+  CDRParseOptionsImpl &operator=(const CDRParseOptionsImpl &other) = default;
+
+  bool textOnly;
+  const std::atomic<bool> *cancelFlag;
+  std::chrono::steady_clock::time_point deadline;
+  std::function<void (const CDRParseProgress &)> progressCallback;
+  std::chrono::steady_clock::duration progressInterval;
+  unsigned long maxBitmapPixels;
+  bool useArena;
+  bool shareStyles;
+  bool instanceGeometry;
+  CDRViewport viewport;
+  double detailTolerance;
+  bool prefetchStreams;
+  unsigned bitmapThreads;
+};
+
+} // namespace libcdr
+
+#endif //  __CDRPARSEOPTIONSIMPL_H__
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
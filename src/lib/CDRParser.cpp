@@ -13,7 +13,6 @@
 #include <math.h>
 #include <string.h>
 #include <sstream>
-#include <set>
 #ifndef BOOST_ALL_NO_LIB
 #define BOOST_ALL_NO_LIB 1
 #endif
@@ -29,6 +28,7 @@
 #include "CDRDocumentStructure.h"
 #include "CDRInternalStream.h"
 #include "CDRCollector.h"
+#include "CDRTrace.h"
 #include "CDRColorPalettes.h"
 
 #ifndef DUMP_PREVIEW_IMAGE
@@ -231,22 +231,57 @@ void normalizeAngle(double &angle)
     angle += 2*M_PI;
 }
 
+// Records that are needed to extract the text of a document and to place it
+// on its page. Everything else is skipped in text-only mode.
+bool isTextRecord(unsigned fourCC)
+{
+  switch (fourCC)
+  {
+  case CDR_FOURCC_loda:
+  case CDR_FOURCC_lobj:
+  case CDR_FOURCC_vrsn:
+  case CDR_FOURCC_trfd:
+  case CDR_FOURCC_fild: // text colour is a fill
+  case CDR_FOURCC_fill:
+  case CDR_FOURCC_flgs:
+  case CDR_FOURCC_mcfg:
+  case CDR_FOURCC_bbox:
+  case CDR_FOURCC_spnd: // links text objects to their text
+  case CDR_FOURCC_uidr:
+  case CDR_FOURCC_font:
+  case CDR_FOURCC_stlt:
+  case CDR_FOURCC_txsm:
+  case CDR_FOURCC_styd:
+    return true;
+  default:
+    return false;
+  }
+}
+
 } // anonymous namespace
 
-libcdr::CDRParser::CDRParser(const std::vector<std::unique_ptr<librevenge::RVNGInputStream>> &externalStreams, libcdr::CDRCollector *collector)
-  : CommonParser(collector), m_externalStreams(externalStreams),
-    m_fonts(), m_fillStyles(), m_lineStyles(), m_arrows(), m_version(0), m_waldoOutlId(0), m_waldoFillId(0) {}
+libcdr::CDRParser::CDRParser(CDRExternalStreams &externalStreams, libcdr::CDRCollector *collector,
+                             const CDRParseOptionsImpl &options)
+  : CommonParser(collector, options), m_externalStreams(externalStreams),
+    m_fonts(), m_fillStyles(), m_lineStyles(), m_arrows(), m_version(0), m_waldoOutlId(0), m_waldoFillId(0),
+    m_progressOffset(0), m_compressedListDepth(0), m_skipBitmaps(false) {}
 
 libcdr::CDRParser::~CDRParser()
 {
   m_collector->collectLevel(0);
 }
 
+void libcdr::CDRParser::setSkipBitmaps(bool skip)
+{
+  m_skipBitmaps = skip;
+}
+
 bool libcdr::CDRParser::parseWaldo(librevenge::RVNGInputStream *input)
 {
   try
   {
     input->seek(0, librevenge::RVNG_SEEK_SET);
+    startProgress(input);
     unsigned short magic = readU16(input);
     if (magic != 0x4c57)
       return false;
@@ -266,33 +301,29 @@ bool libcdr::CDRParser::parseWaldo(librevenge::RVNGInputStream *input)
     CDR_DEBUG_MSG(("CDRParser::parseWaldo, Mcfg offset 0x%x\n", (unsigned)input->tell()));
     readMcfg(input, 275);
     std::vector<WaldoRecordInfo> records;
-    std::map<unsigned, WaldoRecordInfo> records2;
-    std::map<unsigned, WaldoRecordInfo> records3;
-    std::map<unsigned, WaldoRecordInfo> records4;
-    std::map<unsigned, WaldoRecordInfo> records6;
-    std::map<unsigned, WaldoRecordInfo> records8;
-    std::map<unsigned, WaldoRecordInfo> records7;
-    std::map<unsigned, WaldoRecordInfo> recordsOther;
     if (offsets[3])
     {
       input->seek(offsets[3], librevenge::RVNG_SEEK_SET);
-      if (!gatherWaldoInformation(input, records, records2, records3, records4, records6, records7, records8, recordsOther))
+      if (!gatherWaldoInformation(input, records))
         return false;
     }
     if (offsets[5])
     {
       input->seek(offsets[5], librevenge::RVNG_SEEK_SET);
-      gatherWaldoInformation(input, records, records2, records3, records4, records6, records7, records8, recordsOther);
+      gatherWaldoInformation(input, records);
     }
     if (offsets[11])
     {
       input->seek(offsets[11], librevenge::RVNG_SEEK_SET);
-      gatherWaldoInformation(input, records, records2, records3, records4, records6, records7, records8, recordsOther);
+      gatherWaldoInformation(input, records);
     }
-    std::map<unsigned, WaldoRecordType1> records1;
-    for (auto &record : records)
+    sortWaldoRecords(records);
+    std::vector<WaldoRecordType1> records1;
+    std::pair<std::vector<WaldoRecordInfo>::const_iterator, std::vector<WaldoRecordInfo>::const_iterator> range = getWaldoRecords(records, 1);
+    records1.reserve(range.second - range.first);
+    for (std::vector<WaldoRecordInfo>::const_iterator record = range.first; record != range.second; ++record)
     {
-      input->seek(record.offset, librevenge::RVNG_SEEK_SET);
+      input->seek(record->offset, librevenge::RVNG_SEEK_SET);
       unsigned length = readU32(input);
       if (length != 0x18)
       {
@@ -313,9 +344,9 @@ bool libcdr::CDRParser::parseWaldo(librevenge::RVNGInputStream *input)
       CDRTransform trafo;
       if (moreDataID)
       {
-        std::map<unsigned, WaldoRecordInfo>::const_iterator iter7 = records7.find(moreDataID);
-        if (iter7 != records7.end())
-          input->seek(iter7->second.offset, librevenge::RVNG_SEEK_SET);
+        const WaldoRecordInfo *record7 = findWaldoRecord(records, 7, moreDataID);
+        if (record7)
+          input->seek(record7->offset, librevenge::RVNG_SEEK_SET);
         input->seek(0x26, librevenge::RVNG_SEEK_CUR);
         double v0 = readFixedPoint(input);
         double v1 = readFixedPoint(input);
@@ -325,85 +356,80 @@ bool libcdr::CDRParser::parseWaldo(librevenge::RVNGInputStream *input)
         double v5 = readFixedPoint(input) / 1000.0;
         trafo = CDRTransform(v0, v1, v2, v3, v4, v5);
       }
-      records1[record.id] = WaldoRecordType1(record.id, next, previous, child, parent, flags, x0, y0, x1, y1, trafo);
+      // the records come sorted by id, so records1 is sorted too
+      records1.push_back(WaldoRecordType1(record->id, next, previous, child, parent, flags, x0, y0, x1, y1, trafo));
+    }
+    static const unsigned char recordTypes[] = { 3, 6, 8 };
+    for (unsigned char recordType : recordTypes)
+    {
+      range = getWaldoRecords(records, recordType);
+      for (std::vector<WaldoRecordInfo>::const_iterator record = range.first; record != range.second; ++record)
+        readWaldoRecord(input, *record);
     }
-    std::map<unsigned, WaldoRecordInfo>::const_iterator iter;
-    for (iter = records3.begin(); iter != records3.end(); ++iter)
-      readWaldoRecord(input, iter->second);
-    for (iter = records6.begin(); iter != records6.end(); ++iter)
-      readWaldoRecord(input, iter->second);
-    for (iter = records8.begin(); iter != records8.end(); ++iter)
-      readWaldoRecord(input, iter->second);
-    for (iter = recordsOther.begin(); iter != recordsOther.end(); ++iter)
-      readWaldoRecord(input, iter->second);
-    if (!records1.empty() && !records2.empty())
+    for (const auto &record : records)
+    {
+      switch (record.type)
+      {
+      case 1:
+      case 2:
+      case 3:
+      case 4:
+      case 6:
+      case 7:
+      case 8:
+        break;
+      default:
+        readWaldoRecord(input, record);
+        break;
+      }
+    }
+    range = getWaldoRecords(records, 2);
+    if (!records1.empty() && range.first != range.second)
     {
 
-      auto iter1 = records1.find(1);
+      const WaldoRecordType1 *record1 = findWaldoRecord(records1, 1);
       std::stack<WaldoRecordType1> waldoStack;
-      if (iter1 != records1.end())
+      if (record1)
       {
-        waldoStack.push(iter1->second);
+        waldoStack.push(*record1);
         m_collector->collectVect((unsigned)(waldoStack.size()));
-        parseWaldoStructure(input, waldoStack, records1, records2);
+        parseWaldoStructure(input, waldoStack, records1, records);
       }
-      iter1 = records1.find(0);
-      if (iter1 == records1.end())
+      record1 = findWaldoRecord(records1, 0);
+      if (!record1)
         return false;
       waldoStack = std::stack<WaldoRecordType1>();
-      waldoStack.push(iter1->second);
+      waldoStack.push(*record1);
+      nextProgressPage();
       m_collector->collectPage((unsigned)(waldoStack.size()));
-      if (!parseWaldoStructure(input, waldoStack, records1, records2))
+      if (!parseWaldoStructure(input, waldoStack, records1, records))
         return false;
     }
+    finishProgress();
     return true;
   }
+  catch (const ParseInterruptedException &)
+  {
+    throw;
+  }
   catch (...)
   {
     return false;
   }
 }
 
-bool libcdr::CDRParser::gatherWaldoInformation(librevenge::RVNGInputStream *input, std::vector<WaldoRecordInfo> &records, std::map<unsigned, WaldoRecordInfo> &records2,
-                                               std::map<unsigned, WaldoRecordInfo> &records3, std::map<unsigned, WaldoRecordInfo> &records4,
-                                               std::map<unsigned, WaldoRecordInfo> &records6, std::map<unsigned, WaldoRecordInfo> &records7,
-                                               std::map<unsigned, WaldoRecordInfo> &records8, std::map<unsigned, WaldoRecordInfo> recordsOther)
+bool libcdr::CDRParser::gatherWaldoInformation(librevenge::RVNGInputStream *input, std::vector<WaldoRecordInfo> &records)
 {
   try
   {
     unsigned short numRecords = readU16(input);
+    records.reserve(records.size() + numRecords);
     for (; numRecords > 0 && !input->isEnd(); --numRecords)
     {
       unsigned char recordType = readU8(input);
       unsigned recordId = readU32(input);
       unsigned recordOffset = readU32(input);
-      switch (recordType)
-      {
-      case 1:
-        records.push_back(WaldoRecordInfo(recordType, recordId, recordOffset));
-        break;
-      case 2:
-        records2[recordId]  = WaldoRecordInfo(recordType, recordId, recordOffset);
-        break;
-      case 3:
-        records3[recordId]  = WaldoRecordInfo(recordType, recordId, recordOffset);
-        break;
-      case 4:
-        records4[recordId]  = WaldoRecordInfo(recordType, recordId, recordOffset);
-        break;
-      case 6:
-        records6[recordId]  = WaldoRecordInfo(recordType, recordId, recordOffset);
-        break;
-      case 7:
-        records7[recordId]  = WaldoRecordInfo(recordType, recordId, recordOffset);
-        break;
-      case 8:
-        records8[recordId]  = WaldoRecordInfo(recordType, recordId, recordOffset);
-        break;
-      default:
-        recordsOther[recordId]  = WaldoRecordInfo(recordType, recordId, recordOffset);
-        break;
-      }
+      records.push_back(WaldoRecordInfo(recordType, recordId, recordOffset));
     }
     return true;
   }
@@ -416,13 +442,21 @@ bool libcdr::CDRParser::gatherWaldoInformation(librevenge::RVNGInputStream *inpu
 
 
 bool libcdr::CDRParser::parseWaldoStructure(librevenge::RVNGInputStream *input, std::stack<WaldoRecordType1> &waldoStack,
-                                            const std::map<unsigned, WaldoRecordType1> &records1, std::map<unsigned, WaldoRecordInfo> &records2)
+                                            const std::vector<WaldoRecordType1> &records1, const std::vector<WaldoRecordInfo> &records)
 {
-  std::set<unsigned> visited;
-  while (!waldoStack.empty() && visited.insert(waldoStack.top().m_id).second)
+  // indexed like records1
+  std::vector<bool> visited(records1.size(), false);
+  while (!waldoStack.empty())
   {
+    const WaldoRecordType1 *current = findWaldoRecord(records1, waldoStack.top().m_id);
+    if (current)
+    {
+      if (visited[current - &records1[0]])
+        break;
+      visited[current - &records1[0]] = true;
+    }
     m_collector->collectBBox(waldoStack.top().m_x0, waldoStack.top().m_y0, waldoStack.top().m_x1, waldoStack.top().m_y1);
-    std::map<unsigned, WaldoRecordType1>::const_iterator iter1;
+    const WaldoRecordType1 *record1 = nullptr;
     if (waldoStack.top().m_flags & 0x01)
     {
       if (waldoStack.size() > 1)
@@ -433,29 +467,29 @@ bool libcdr::CDRParser::parseWaldoStructure(librevenge::RVNGInputStream *input,
         trafos.append(waldoStack.top().m_trafo);
         m_collector->collectTransform(trafos, true);
       }
-      iter1 = records1.find(waldoStack.top().m_child);
-      if (iter1 == records1.end())
+      record1 = findWaldoRecord(records1, waldoStack.top().m_child);
+      if (!record1)
         return false;
-      waldoStack.push(iter1->second);
+      waldoStack.push(*record1);
       m_collector->collectLevel((unsigned)(waldoStack.size()));
     }
     else
     {
       if (waldoStack.size() > 1)
         m_collector->collectObject((unsigned)(waldoStack.size()));
-      std::map<unsigned, WaldoRecordInfo>::const_iterator iter2 = records2.find(waldoStack.top().m_child);
-      if (iter2 == records2.end())
+      const WaldoRecordInfo *record2 = findWaldoRecord(records, 2, waldoStack.top().m_child);
+      if (!record2)
         return false;
-      readWaldoRecord(input, iter2->second);
+      readWaldoRecord(input, *record2);
       while (!waldoStack.empty() && !waldoStack.top().m_next)
         waldoStack.pop();
       m_collector->collectLevel((unsigned)(waldoStack.size()));
       if (waldoStack.empty())
         return true;
-      iter1 = records1.find(waldoStack.top().m_next);
-      if (iter1 == records1.end())
+      record1 = findWaldoRecord(records1, waldoStack.top().m_next);
+      if (!record1)
         return false;
-      waldoStack.top() = iter1->second;
+      waldoStack.top() = *record1;
     }
   }
   return waldoStack.empty();
@@ -464,6 +498,11 @@ bool libcdr::CDRParser::parseWaldoStructure(librevenge::RVNGInputStream *input,
 void libcdr::CDRParser::readWaldoRecord(librevenge::RVNGInputStream *input, const WaldoRecordInfo &info)
 {
   CDR_DEBUG_MSG(("CDRParser::readWaldoRecord, type %i, id %x, offset %x\n", info.type, info.id, info.offset));
+  checkInterruption(m_options);
+  updateProgress(info.offset);
+  resetRecordArena();
+  if (m_options.textOnly)
+    return; // text objects are not supported in WALDO files yet
   input->seek(info.offset, librevenge::RVNG_SEEK_SET);
   switch (info.type)
   {
@@ -576,12 +615,16 @@ bool libcdr::CDRParser::parseRecords(librevenge::RVNGInputStream *input, const s
   }
   if (level > MAX_RECORD_NESTING)
     return false;
+  if (!level)
+    startProgress(input);
   m_collector->collectLevel(level);
   while (!input->isEnd())
   {
     if (!parseRecord(input, blockLengths, level))
       return false;
   }
+  if (!level)
+    finishProgress();
   return true;
 }
 
@@ -593,6 +636,9 @@ bool libcdr::CDRParser::parseRecord(librevenge::RVNGInputStream *input, const st
   }
   try
   {
+    checkInterruption(m_options);
+    if (!m_compressedListDepth)
+      updateProgress(m_progressOffset + input->tell());
     m_collector->collectLevel(level);
     while (!input->isEnd() && readU8(input) == 0)
     {
@@ -633,7 +679,10 @@ bool libcdr::CDRParser::parseRecord(librevenge::RVNGInputStream *input, const st
           return false;
       }
       else if (listType == CDR_FOURCC_page)
+      {
+        nextProgressPage();
         m_collector->collectPage(level);
+      }
       else if (listType == CDR_FOURCC_obj)
         m_collector->collectObject(level);
       else if (listType == CDR_FOURCC_grp || listType == CDR_FOURCC_lnkg)
@@ -647,13 +696,29 @@ bool libcdr::CDRParser::parseRecord(librevenge::RVNGInputStream *input, const st
           m_precision = libcdr::PRECISION_32BIT;
       }
       else if (listType == CDR_FOURCC_vect || listType == CDR_FOURCC_clpt)
+      {
+        if (m_options.textOnly)
+        {
+          // vector patterns and clipping paths do not contain any text
+          input->seek(position + length, librevenge::RVNG_SEEK_SET);
+          return true;
+        }
         m_collector->collectVect(level);
+      }
 
       bool compressed = (listType == CDR_FOURCC_cmpr ? true : false);
+      CDR_TRACE_SPAN(listSpan, listType == CDR_FOURCC_page ? "page" : (compressed ? "cmpr" : nullptr));
+      CDR_TRACE_ARG(listSpan, "offset", position);
+      CDR_TRACE_ARG(listSpan, "bytes", length);
+      const unsigned long progressOffset = m_progressOffset;
+      const long streamStart = input->tell();
       CDRInternalStream tmpStream(input, cmprsize, compressed);
       if (!compressed)
       {
-        if (!parseRecords(&tmpStream, blockLengths, level+1))
+        m_progressOffset += streamStart;
+        const bool parsed = parseRecords(&tmpStream, blockLengths, level+1);
+        m_progressOffset = progressOffset;
+        if (!parsed)
           return false;
       }
       else
@@ -666,16 +731,27 @@ bool libcdr::CDRParser::parseRecord(librevenge::RVNGInputStream *input, const st
         CDRInternalStream tmpBlocksStream(input, blocksLength, compressed);
         while (!tmpBlocksStream.isEnd())
           tmpBlockLengths.push_back(readU32(&tmpBlocksStream));
-        if (!parseRecords(&tmpStream, tmpBlockLengths, level+1))
+        // offsets inside the decompressed data do not map to the main stream
+        ++m_compressedListDepth;
+        const bool parsed = parseRecords(&tmpStream, tmpBlockLengths, level+1);
+        --m_compressedListDepth;
+        if (!parsed)
           return false;
       }
     }
     else
+    {
       readRecord(fourCC, length, input);
+      resetRecordArena();
+    }
 
     input->seek(position + length, librevenge::RVNG_SEEK_SET);
     return true;
   }
+  catch (const ParseInterruptedException &)
+  {
+    throw;
+  }
   catch (...)
   {
     return false;
@@ -684,6 +760,11 @@ bool libcdr::CDRParser::parseRecord(librevenge::RVNGInputStream *input, const st
 
 void libcdr::CDRParser::readRecord(unsigned fourCC, unsigned length, librevenge::RVNGInputStream *input)
 {
+  if (m_options.textOnly && !isTextRecord(fourCC))
+    return;
+  // before the body is looked for in the data streams
+  if (m_skipBitmaps && (fourCC == CDR_FOURCC_bmp || fourCC == CDR_FOURCC_bmpf))
+    return;
   long recordStart = input->tell();
   switch (fourCC)
   {
@@ -1047,8 +1128,8 @@ void libcdr::CDRParser::readLineAndCurve(librevenge::RVNGInputStream *input)
   input->seek(2, librevenge::RVNG_SEEK_CUR);
   if (pointNum > getRemainingLength(input) / pointSize)
     pointNum = getRemainingLength(input) / pointSize;
-  std::vector<std::pair<double, double> > points;
-  std::vector<unsigned char> pointTypes;
+  CDRPointVector points(recordAllocator());
+  CDRPointTypeVector pointTypes(recordAllocator());
   points.reserve(pointNum);
   pointTypes.reserve(pointNum);
   for (unsigned long j=0; j<pointNum; j++)
@@ -1076,8 +1157,8 @@ void libcdr::CDRParser::readPath(librevenge::RVNGInputStream *input)
   else if (pointNum > (maxLength - 16) / pointSize)
     pointNum = (maxLength - 16) / pointSize;
   input->seek(16, librevenge::RVNG_SEEK_CUR);
-  std::vector<std::pair<double, double> > points;
-  std::vector<unsigned char> pointTypes;
+  CDRPointVector points(recordAllocator());
+  CDRPointTypeVector pointTypes(recordAllocator());
   points.reserve(pointNum);
   pointTypes.reserve(pointNum);
   for (unsigned long j=0; j<pointNum; j++)
@@ -1109,12 +1190,12 @@ void libcdr::CDRParser::readArrw(librevenge::RVNGInputStream *input, unsigned le
   else if (pointNum > (maxLength - 5) / pointSize)
     pointNum = (maxLength - 5) / pointSize;
   input->seek(4, librevenge::RVNG_SEEK_CUR);
-  std::vector<unsigned char> pointTypes;
+  CDRPointTypeVector pointTypes(recordAllocator());
   pointTypes.reserve(pointSize);
   for (unsigned long k=0; k<pointNum; k++)
     pointTypes.push_back(readU8(input));
   input->seek(1, librevenge::RVNG_SEEK_CUR);
-  std::vector<std::pair<double, double> > points;
+  CDRPointVector points(recordAllocator());
   points.reserve(pointSize);
   for (unsigned long j=0; j<pointNum; j++)
   {
@@ -1123,8 +1204,8 @@ void libcdr::CDRParser::readArrw(librevenge::RVNGInputStream *input, unsigned le
     point.first = (double)readCoordinate(input);
     points.push_back(point);
   }
-  CDRPath path;
-  processPath(points, pointTypes, path);
+  auto path = std::make_shared<CDRPath>();
+  processPath(points, pointTypes, *path);
   m_arrows[arrowId] = path;
 }
 
@@ -1178,8 +1259,8 @@ void libcdr::CDRParser::readBitmap(librevenge::RVNGInputStream *input)
     const unsigned short pointSize = 2 * (m_precision == PRECISION_16BIT ? 2 : 4) + 1;
     if (pointNum > getRemainingLength(input) / pointSize)
       pointNum = getRemainingLength(input) / pointSize;
-    std::vector<std::pair<double, double> > points;
-    std::vector<unsigned char> pointTypes;
+    CDRPointVector points(recordAllocator());
+    CDRPointTypeVector pointTypes(recordAllocator());
     points.reserve(pointNum);
     pointTypes.reserve(pointNum);
     for (unsigned long j=0; j<pointNum; j++)
@@ -1216,13 +1297,13 @@ void libcdr::CDRParser::readWaldoOutl(librevenge::RVNGInputStream *input)
   unsigned short joinType = readU16(input);
   unsigned short capsType = readU16(input);
   unsigned startMarkerId = readU32(input);
-  std::map<unsigned, CDRPath>::const_iterator iter = m_arrows.find(startMarkerId);
-  CDRPath startMarker;
+  auto iter = m_arrows.find(startMarkerId);
+  std::shared_ptr<const CDRPath> startMarker;
   if (iter != m_arrows.end())
     startMarker = iter->second;
   unsigned endMarkerId = readU32(input);
   iter = m_arrows.find(endMarkerId);
-  CDRPath endMarker;
+  std::shared_ptr<const CDRPath> endMarker;
   if (iter != m_arrows.end())
     endMarker = iter->second;
   m_collector->collectLineStyle(++m_waldoOutlId, CDRLineStyle(lineType, capsType, joinType, lineWidth, stretch, angle, color, dashArray, startMarker, endMarker));
@@ -1719,13 +1800,13 @@ void libcdr::CDRParser::readOutl(librevenge::RVNGInputStream *input, unsigned le
   else
     input->seek(fixPosition + 22, librevenge::RVNG_SEEK_SET);
   unsigned startMarkerId = readU32(input);
-  std::map<unsigned, CDRPath>::const_iterator iter = m_arrows.find(startMarkerId);
-  CDRPath startMarker;
+  auto iter = m_arrows.find(startMarkerId);
+  std::shared_ptr<const CDRPath> startMarker;
   if (iter != m_arrows.end())
     startMarker = iter->second;
   unsigned endMarkerId = readU32(input);
   iter = m_arrows.find(endMarkerId);
-  CDRPath endMarker;
+  std::shared_ptr<const CDRPath> endMarker;
   if (iter != m_arrows.end())
     endMarker = iter->second;
   m_lineStyles[lineId] = CDRLineStyle(lineType, capsType, joinType, lineWidth, stretch, angle, color, dashArray, startMarker, endMarker);
@@ -1753,8 +1834,10 @@ void libcdr::CDRParser::readLoda(librevenge::RVNGInputStream *input, unsigned le
   if (numOfArgs > (length - startOfArgs) / 4) // avoid extra big allocation in case of a broken file
     numOfArgs = (length - startOfArgs) / 4;
   unsigned chunkType = readUnsigned(input);
-  if (chunkType == 0x26)
+  if (chunkType == 0x26 && !m_options.textOnly)
     m_collector->collectSpline();
+  const bool isText = (m_version >= 400 && (chunkType == 0x04 || chunkType == 0x06))
+                      || (m_version < 400 && (chunkType == 0x03 || chunkType == 0x05));
   std::vector<unsigned> argOffsets(numOfArgs, 0);
   std::vector<unsigned> argTypes(numOfArgs, 0);
   size_t i = 0;
@@ -1767,6 +1850,9 @@ void libcdr::CDRParser::readLoda(librevenge::RVNGInputStream *input, unsigned le
 
   for (i=0; i < argTypes.size(); i++)
   {
+    // In text-only mode, keep just the text frames and what places them on the page
+    if (m_options.textOnly && !(argTypes[i] == 0x1e && isText) && argTypes[i] != 0x64 && argTypes[i] != 0x4aba)
+      continue;
     input->seek(startPosition+argOffsets[i], librevenge::RVNG_SEEK_SET);
     if (argTypes[i] == 0x1e) // loda coords
     {
@@ -1877,8 +1963,8 @@ void libcdr::CDRParser::readPolygonCoords(librevenge::RVNGInputStream *input)
   if (pointNum > getRemainingLength(input) / pointSize)
     pointNum = getRemainingLength(input) / pointSize;
   input->seek(2, librevenge::RVNG_SEEK_CUR);
-  std::vector<std::pair<double, double> > points;
-  std::vector<unsigned char> pointTypes;
+  CDRPointVector points(recordAllocator());
+  CDRPointTypeVector pointTypes(recordAllocator());
   points.reserve(pointNum);
   pointTypes.reserve(pointNum);
   for (unsigned long j=0; j<pointNum; j++)
@@ -1941,7 +2027,8 @@ void libcdr::CDRParser::readWaldoBmp(librevenge::RVNGInputStream *input, unsigne
 
 void libcdr::CDRParser::readBmp(librevenge::RVNGInputStream *input, unsigned length)
 {
-  if (!_redirectX6Chunk(&input, length))
+  // bitmaps are only read by the styles pass
+  if (!_redirectX6Chunk(&input, length, true))
     throw GenericException();
   unsigned imageId = readUnsigned(input);
   std::vector<unsigned char> bitmap;
@@ -1986,7 +2073,7 @@ void libcdr::CDRParser::readOpacity(librevenge::RVNGInputStream *input, unsigned
 
 void libcdr::CDRParser::readBmpf(librevenge::RVNGInputStream *input, unsigned length)
 {
-  if (!_redirectX6Chunk(&input, length))
+  if (!_redirectX6Chunk(&input, length, true))
     throw GenericException();
   unsigned patternId = readU32(input);
   unsigned width{}, height{};
@@ -2069,7 +2156,7 @@ void libcdr::CDRParser::readVersion(librevenge::RVNGInputStream *input, unsigned
     m_precision = libcdr::PRECISION_32BIT;
 }
 
-bool libcdr::CDRParser::_redirectX6Chunk(librevenge::RVNGInputStream **input, unsigned &length)
+bool libcdr::CDRParser::_redirectX6Chunk(librevenge::RVNGInputStream **input, unsigned &length, bool transient)
 {
   if (m_version >= 1600 && length == 0x10)
   {
@@ -2078,7 +2165,7 @@ bool libcdr::CDRParser::_redirectX6Chunk(librevenge::RVNGInputStream **input, un
     if (streamNumber < m_externalStreams.size())
     {
       unsigned streamOffset = readU32(*input);
-      *input = m_externalStreams[streamNumber].get();
+      *input = m_externalStreams.get(streamNumber, transient);
       if (*input)
       {
         (*input)->seek(streamOffset, librevenge::RVNG_SEEK_SET);
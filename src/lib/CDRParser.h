@@ -15,6 +15,7 @@
 #include <map>
 #include <stack>
 #include <librevenge-stream/librevenge-stream.h>
+#include "CDRExternalStreams.h"
 #include "CDRTypes.h"
 #include "CommonParser.h"
 
@@ -26,22 +27,23 @@ class CDRCollector;
 class CDRParser : protected CommonParser
 {
 public:
-  explicit CDRParser(const std::vector<std::unique_ptr<librevenge::RVNGInputStream>> &externalStreams, CDRCollector *collector);
+  explicit CDRParser(CDRExternalStreams &externalStreams, CDRCollector *collector,
+                     const CDRParseOptionsImpl &options = CDRParseOptionsImpl());
   ~CDRParser() override;
   bool parseRecords(librevenge::RVNGInputStream *input, const std::vector<unsigned> &blockLengths = std::vector<unsigned>(), unsigned level = 0);
   bool parseWaldo(librevenge::RVNGInputStream *input);
+  using CommonParser::setProgressPhase;
+  // Skips bitmap and bitmap pattern records, for collectors that do not use them
+  void setSkipBitmaps(bool skip);
 
 private:
   CDRParser();
   CDRParser(const CDRParser &);
   CDRParser &operator=(const CDRParser &);
   bool parseWaldoStructure(librevenge::RVNGInputStream *input, std::stack<WaldoRecordType1> &waldoStack,
-                           const std::map<unsigned, WaldoRecordType1> &records1,
-                           std::map<unsigned, WaldoRecordInfo> &records2);
-  bool gatherWaldoInformation(librevenge::RVNGInputStream *input, std::vector<WaldoRecordInfo> &records, std::map<unsigned, WaldoRecordInfo> &records2,
-                              std::map<unsigned, WaldoRecordInfo> &records3, std::map<unsigned, WaldoRecordInfo> &records4,
-                              std::map<unsigned, WaldoRecordInfo> &records6, std::map<unsigned, WaldoRecordInfo> &records7,
-                              std::map<unsigned, WaldoRecordInfo> &records8, std::map<unsigned, WaldoRecordInfo> recordsOther);
+                           const std::vector<WaldoRecordType1> &records1,
+                           const std::vector<WaldoRecordInfo> &records);
+  bool gatherWaldoInformation(librevenge::RVNGInputStream *input, std::vector<WaldoRecordInfo> &records);
   void readWaldoRecord(librevenge::RVNGInputStream *input, const WaldoRecordInfo &info);
   bool parseRecord(librevenge::RVNGInputStream *input, const std::vector<unsigned> &blockLengths = std::vector<unsigned>(), unsigned level = 0);
   void readRecord(unsigned fourCC, unsigned length, librevenge::RVNGInputStream *input);
@@ -92,22 +94,26 @@ private:
   void readArtisticText(librevenge::RVNGInputStream *input);
   void readParagraphText(librevenge::RVNGInputStream *input);
 
-  bool _redirectX6Chunk(librevenge::RVNGInputStream **input, unsigned &length);
+  bool _redirectX6Chunk(librevenge::RVNGInputStream **input, unsigned &length, bool transient = false);
   void _readX6StyleString(librevenge::RVNGInputStream *input, unsigned long length, CDRStyle &style);
   void _skipX3Optional(librevenge::RVNGInputStream *input);
   void _resolveColorPalette(CDRColor &color);
 
-  const std::vector<std::unique_ptr<librevenge::RVNGInputStream>> &m_externalStreams;
+  CDRExternalStreams &m_externalStreams;
 
   std::map<unsigned, CDRFont> m_fonts;
   std::map<unsigned, CDRFillStyle> m_fillStyles;
   std::map<unsigned, CDRLineStyle> m_lineStyles;
-  std::map<unsigned, CDRPath> m_arrows;
+  std::map<unsigned, std::shared_ptr<const CDRPath> > m_arrows;
 
   unsigned m_version;
   unsigned m_waldoOutlId;
   unsigned m_waldoFillId;
 
+  // offset of the current nested record stream in the main stream
+  unsigned long m_progressOffset;
+  unsigned m_compressedListDepth;
+  bool m_skipBitmaps;
 };
 
 } // namespace libcdr
@@ -10,7 +10,6 @@
 #include "CDRPath.h"
 
 #include <math.h>
-#include <map>
 
 #include "CDRTransforms.h"
 #include "libcdr_utils.h"
@@ -220,8 +219,110 @@ static void getCubicBezierBBox(double x0, double y0, double x1, double y1, doubl
   }
 }
 
+// Distance of (x, y) from the line segment from (x0, y0) to (x1, y1)
+static double getSegmentDistance(double x, double y, double x0, double y0, double x1, double y1)
+{
+  const double dx = x1 - x0;
+  const double dy = y1 - y0;
+  const double length2 = dx*dx + dy*dy;
+  double t = 0.0;
+  if (length2 > 0.0)
+  {
+    t = ((x - x0)*dx + (y - y0)*dy) / length2;
+    t = t < 0.0 ? 0.0 : (t > 1.0 ? 1.0 : t);
+  }
+  const double px = x0 + t*dx - x;
+  const double py = y0 + t*dy - y;
+  return sqrt(px*px + py*py);
+}
+
+// The distance from a segment is convex, so a box is close to it if all its corners are
+static bool isBoxNearSegment(double xmin, double ymin, double xmax, double ymax,
+                             double x0, double y0, double x1, double y1, double tolerance)
+{
+  return getSegmentDistance(xmin, ymin, x0, y0, x1, y1) <= tolerance
+         && getSegmentDistance(xmin, ymax, x0, y0, x1, y1) <= tolerance
+         && getSegmentDistance(xmax, ymin, x0, y0, x1, y1) <= tolerance
+         && getSegmentDistance(xmax, ymax, x0, y0, x1, y1) <= tolerance;
+}
+
+/* Douglas-Peucker: marks the points between first and last that are
+   needed to keep the polyline within tolerance of the original. */
+static void markPolylinePoints(const std::vector<std::pair<double, double> > &points, double tolerance, std::vector<bool> &keep)
+{
+  keep.assign(points.size(), false);
+  keep.front() = true;
+  keep.back() = true;
+  std::vector<std::pair<std::size_t, std::size_t> > ranges;
+  ranges.push_back(std::make_pair(0, points.size() - 1));
+  while (!ranges.empty())
+  {
+    const std::size_t first = ranges.back().first;
+    const std::size_t last = ranges.back().second;
+    ranges.pop_back();
+    double maxDistance = tolerance;
+    std::size_t farthest = first;
+    for (std::size_t i = first + 1; i < last; ++i)
+    {
+      const double distance = getSegmentDistance(points[i].first, points[i].second, points[first].first, points[first].second,
+                                                 points[last].first, points[last].second);
+      if (distance > maxDistance)
+      {
+        maxDistance = distance;
+        farthest = i;
+      }
+    }
+    if (farthest != first)
+    {
+      keep[farthest] = true;
+      ranges.push_back(std::make_pair(first, farthest));
+      ranges.push_back(std::make_pair(farthest, last));
+    }
+  }
+}
+
 } // anonymous namespace
 
+void CDRPathBBox::addPoint(double x, double y)
+{
+  addBox(x, y, x, y);
+  m_lastX = x;
+  m_lastY = y;
+}
+
+void CDRPathBBox::addBox(double xmin, double ymin, double xmax, double ymax)
+{
+  if (m_empty)
+  {
+    m_xmin = xmin;
+    m_ymin = ymin;
+    m_xmax = xmax;
+    m_ymax = ymax;
+    m_empty = false;
+    return;
+  }
+  m_xmin = m_xmin > xmin ? xmin : m_xmin;
+  m_ymin = m_ymin > ymin ? ymin : m_ymin;
+  m_xmax = m_xmax < xmax ? xmax : m_xmax;
+  m_ymax = m_ymax < ymax ? ymax : m_ymax;
+}
+
+void CDRPathBBox::getLastPoint(double &x, double &y) const
+{
+  if (m_empty)
+    return;
+  x = m_lastX;
+  y = m_lastY;
+}
+
+void CDRPathBBox::get(double &xmin, double &ymin, double &xmax, double &ymax) const
+{
+  xmin = m_xmin;
+  ymin = m_ymin;
+  xmax = m_xmax;
+  ymax = m_ymax;
+}
+
 class CDRMoveToElement : public CDRPathElement
 {
 public:
@@ -233,6 +334,9 @@ public:
   void transform(const CDRTransforms &trafos) override;
   void transform(const CDRTransform &trafo) override;
   std::unique_ptr<CDRPathElement> clone() override;
+  std::unique_ptr<CDRPathElement> clone(const CDRTransform &trafo) const override;
+  void appendGeometry(std::vector<double> &geometry) const override;
+  void extendBBox(CDRPathBBox &bbox) const override;
 private:
   double m_x;
   double m_y;
@@ -249,6 +353,10 @@ public:
   void transform(const CDRTransforms &trafos) override;
   void transform(const CDRTransform &trafo) override;
   std::unique_ptr<CDRPathElement> clone() override;
+  std::unique_ptr<CDRPathElement> clone(const CDRTransform &trafo) const override;
+  void appendGeometry(std::vector<double> &geometry) const override;
+  void extendBBox(CDRPathBBox &bbox) const override;
+  bool flatten(double &x, double &y, double tolerance) const override;
 private:
   double m_x;
   double m_y;
@@ -269,6 +377,10 @@ public:
   void transform(const CDRTransforms &trafos) override;
   void transform(const CDRTransform &trafo) override;
   std::unique_ptr<CDRPathElement> clone() override;
+  std::unique_ptr<CDRPathElement> clone(const CDRTransform &trafo) const override;
+  void appendGeometry(std::vector<double> &geometry) const override;
+  void extendBBox(CDRPathBBox &bbox) const override;
+  bool flatten(double &x, double &y, double tolerance) const override;
 private:
   double m_x1;
   double m_y1;
@@ -291,6 +403,10 @@ public:
   void transform(const CDRTransforms &trafos) override;
   void transform(const CDRTransform &trafo) override;
   std::unique_ptr<CDRPathElement> clone() override;
+  std::unique_ptr<CDRPathElement> clone(const CDRTransform &trafo) const override;
+  void appendGeometry(std::vector<double> &geometry) const override;
+  void extendBBox(CDRPathBBox &bbox) const override;
+  bool flatten(double &x, double &y, double tolerance) const override;
 private:
   double m_x1;
   double m_y1;
@@ -302,15 +418,24 @@ class CDRSplineToElement : public CDRPathElement
 {
 public:
   CDRSplineToElement(const std::vector<std::pair<double, double> > &points)
-    : m_points(points) {}
+    : m_points(points), m_bezierPoints() {}
   ~CDRSplineToElement() override {}
   void writeOut(librevenge::RVNGPropertyListVector &vec) const override;
   void transform(const CDRTransforms &trafos) override;
   void transform(const CDRTransform &trafo) override;
   std::unique_ptr<CDRPathElement> clone() override;
+  std::unique_ptr<CDRPathElement> clone(const CDRTransform &trafo) const override;
+  void appendGeometry(std::vector<double> &geometry) const override;
+  void extendBBox(CDRPathBBox &bbox) const override;
 private:
   std::vector<std::pair<double, double> > m_points;
+  /* Control points of the Bezier segments the spline consists of, three
+     per segment, computed on first use. As the decomposition commutes
+     with affine transformations, they are transformed with the spline
+     instead of being recomputed. */
+  mutable std::vector<std::pair<double, double> > m_bezierPoints;
   unsigned knot(unsigned i) const;
+  void decompose() const;
 };
 
 class CDRArcToElement : public CDRPathElement
@@ -329,6 +454,10 @@ public:
   void transform(const CDRTransforms &trafos) override;
   void transform(const CDRTransform &trafo) override;
   std::unique_ptr<CDRPathElement> clone() override;
+  std::unique_ptr<CDRPathElement> clone(const CDRTransform &trafo) const override;
+  void appendGeometry(std::vector<double> &geometry) const override;
+  void extendBBox(CDRPathBBox &bbox) const override;
+  bool flatten(double &x, double &y, double tolerance) const override;
 private:
   double m_rx;
   double m_ry;
@@ -348,6 +477,9 @@ public:
   void transform(const CDRTransforms &trafos) override;
   void transform(const CDRTransform &trafo) override;
   std::unique_ptr<CDRPathElement> clone() override;
+  std::unique_ptr<CDRPathElement> clone(const CDRTransform &trafo) const override;
+  void appendGeometry(std::vector<double> &geometry) const override;
+  void extendBBox(CDRPathBBox &bbox) const override;
 };
 
 void CDRMoveToElement::writeOut(librevenge::RVNGPropertyListVector &vec) const
@@ -374,6 +506,26 @@ std::unique_ptr<CDRPathElement> CDRMoveToElement::clone()
   return make_unique<CDRMoveToElement>(m_x, m_y);
 }
 
+std::unique_ptr<CDRPathElement> CDRMoveToElement::clone(const CDRTransform &trafo) const
+{
+  double x = m_x;
+  double y = m_y;
+  trafo.applyToPoint(x, y);
+  return make_unique<CDRMoveToElement>(x, y);
+}
+
+void CDRMoveToElement::appendGeometry(std::vector<double> &geometry) const
+{
+  geometry.push_back(0.0);
+  geometry.push_back(m_x);
+  geometry.push_back(m_y);
+}
+
+void CDRMoveToElement::extendBBox(CDRPathBBox &bbox) const
+{
+  bbox.addPoint(m_x, m_y);
+}
+
 void CDRLineToElement::writeOut(librevenge::RVNGPropertyListVector &vec) const
 {
   librevenge::RVNGPropertyList node;
@@ -398,6 +550,33 @@ std::unique_ptr<CDRPathElement> CDRLineToElement::clone()
   return make_unique<CDRLineToElement>(m_x, m_y);
 }
 
+std::unique_ptr<CDRPathElement> CDRLineToElement::clone(const CDRTransform &trafo) const
+{
+  double x = m_x;
+  double y = m_y;
+  trafo.applyToPoint(x, y);
+  return make_unique<CDRLineToElement>(x, y);
+}
+
+void CDRLineToElement::appendGeometry(std::vector<double> &geometry) const
+{
+  geometry.push_back(1.0);
+  geometry.push_back(m_x);
+  geometry.push_back(m_y);
+}
+
+void CDRLineToElement::extendBBox(CDRPathBBox &bbox) const
+{
+  bbox.addPoint(m_x, m_y);
+}
+
+bool CDRLineToElement::flatten(double &x, double &y, double) const
+{
+  x = m_x;
+  y = m_y;
+  return true;
+}
+
 void CDRCubicBezierToElement::writeOut(librevenge::RVNGPropertyListVector &vec) const
 {
   librevenge::RVNGPropertyList node;
@@ -430,6 +609,52 @@ std::unique_ptr<CDRPathElement> CDRCubicBezierToElement::clone()
   return make_unique<CDRCubicBezierToElement>(m_x1, m_y1, m_x2, m_y2, m_x, m_y);
 }
 
+std::unique_ptr<CDRPathElement> CDRCubicBezierToElement::clone(const CDRTransform &trafo) const
+{
+  double x1 = m_x1;
+  double y1 = m_y1;
+  double x2 = m_x2;
+  double y2 = m_y2;
+  double x = m_x;
+  double y = m_y;
+  trafo.applyToPoint(x1, y1);
+  trafo.applyToPoint(x2, y2);
+  trafo.applyToPoint(x, y);
+  return make_unique<CDRCubicBezierToElement>(x1, y1, x2, y2, x, y);
+}
+
+void CDRCubicBezierToElement::appendGeometry(std::vector<double> &geometry) const
+{
+  geometry.push_back(2.0);
+  geometry.push_back(m_x1);
+  geometry.push_back(m_y1);
+  geometry.push_back(m_x2);
+  geometry.push_back(m_y2);
+  geometry.push_back(m_x);
+  geometry.push_back(m_y);
+}
+
+void CDRCubicBezierToElement::extendBBox(CDRPathBBox &bbox) const
+{
+  double x0 = m_x;
+  double y0 = m_y;
+  bbox.getLastPoint(x0, y0);
+  double xmin, ymin, xmax, ymax;
+  getCubicBezierBBox(x0, y0, m_x1, m_y1, m_x2, m_y2, m_x, m_y, xmin, ymin, xmax, ymax);
+  bbox.addBox(xmin, ymin, xmax, ymax);
+  bbox.addPoint(m_x, m_y);
+}
+
+bool CDRCubicBezierToElement::flatten(double &x, double &y, double tolerance) const
+{
+  // the curve lies in the convex hull of its control points
+  if (getSegmentDistance(m_x1, m_y1, x, y, m_x, m_y) > tolerance || getSegmentDistance(m_x2, m_y2, x, y, m_x, m_y) > tolerance)
+    return false;
+  x = m_x;
+  y = m_y;
+  return true;
+}
+
 void CDRQuadraticBezierToElement::writeOut(librevenge::RVNGPropertyListVector &vec) const
 {
   librevenge::RVNGPropertyList node;
@@ -458,6 +683,46 @@ std::unique_ptr<CDRPathElement> CDRQuadraticBezierToElement::clone()
   return make_unique<CDRQuadraticBezierToElement>(m_x1, m_y1, m_x, m_y);
 }
 
+std::unique_ptr<CDRPathElement> CDRQuadraticBezierToElement::clone(const CDRTransform &trafo) const
+{
+  double x1 = m_x1;
+  double y1 = m_y1;
+  double x = m_x;
+  double y = m_y;
+  trafo.applyToPoint(x1, y1);
+  trafo.applyToPoint(x, y);
+  return make_unique<CDRQuadraticBezierToElement>(x1, y1, x, y);
+}
+
+void CDRQuadraticBezierToElement::appendGeometry(std::vector<double> &geometry) const
+{
+  geometry.push_back(3.0);
+  geometry.push_back(m_x1);
+  geometry.push_back(m_y1);
+  geometry.push_back(m_x);
+  geometry.push_back(m_y);
+}
+
+void CDRQuadraticBezierToElement::extendBBox(CDRPathBBox &bbox) const
+{
+  double x0 = m_x;
+  double y0 = m_y;
+  bbox.getLastPoint(x0, y0);
+  double xmin, ymin, xmax, ymax;
+  getQuadraticBezierBBox(x0, y0, m_x1, m_y1, m_x, m_y, xmin, ymin, xmax, ymax);
+  bbox.addBox(xmin, ymin, xmax, ymax);
+  bbox.addPoint(m_x, m_y);
+}
+
+bool CDRQuadraticBezierToElement::flatten(double &x, double &y, double tolerance) const
+{
+  if (getSegmentDistance(m_x1, m_y1, x, y, m_x, m_y) > tolerance)
+    return false;
+  x = m_x;
+  y = m_y;
+  return true;
+}
+
 #define CDR_SPLINE_DEGREE 3
 
 unsigned CDRSplineToElement::knot(unsigned i) const
@@ -496,15 +761,41 @@ void CDRSplineToElement::writeOut(librevenge::RVNGPropertyListVector &vec) const
   node.insert("svg:y", m_points[0].second);
   vec.append(node);
 
+  if (m_bezierPoints.empty())
+    decompose();
+
+  node.clear();
+  node.insert("librevenge:path-action", "C");
+  for (std::size_t i = 0; i + 2 < m_bezierPoints.size(); i += 3)
+  {
+    node.insert("svg:x1", m_bezierPoints[i].first);
+    node.insert("svg:y1", m_bezierPoints[i].second);
+    node.insert("svg:x2", m_bezierPoints[i+1].first);
+    node.insert("svg:y2", m_bezierPoints[i+1].second);
+    node.insert("svg:x", m_bezierPoints[i+2].first);
+    node.insert("svg:y", m_bezierPoints[i+2].second);
+    vec.append(node);
+  }
+}
+
+void CDRSplineToElement::decompose() const
+{
   /* Decomposition of a spline of 3rd degree into Bezier segments
    * adapted from the algorithm DecomposeCurve (Les Piegl, Wayne Tiller:
    * The NURBS Book, 2nd Edition, 1997
    */
 
+  m_bezierPoints.clear();
+  if (m_points.size() <= CDR_SPLINE_DEGREE)
+    return;
   unsigned long m = m_points.size() + CDR_SPLINE_DEGREE + 1;
   unsigned a = CDR_SPLINE_DEGREE;
   unsigned b = CDR_SPLINE_DEGREE + 1;
-  std::vector< std::pair<double, double> > Qw(CDR_SPLINE_DEGREE+1), NextQw(CDR_SPLINE_DEGREE+1);
+  std::pair<double, double> buffers[2][CDR_SPLINE_DEGREE+1] = {};
+  std::pair<double, double> *Qw = buffers[0];
+  std::pair<double, double> *NextQw = buffers[1];
+  double alphas[CDR_SPLINE_DEGREE] = {};
+  m_bezierPoints.reserve(3 * (m_points.size() - CDR_SPLINE_DEGREE));
   unsigned i = 0;
   for (; i <= CDR_SPLINE_DEGREE; i++)
     Qw[i] = m_points[i];
@@ -518,7 +809,6 @@ void CDRSplineToElement::writeOut(librevenge::RVNGPropertyListVector &vec) const
     {
       auto numer = (double)(knot(b) - knot(a));
       unsigned j = CDR_SPLINE_DEGREE;
-      std::map<unsigned, double> alphas;
       for (; j >mult; j--)
         alphas[j-mult-1] = numer/double(knot(a+j)-knot(a));
       unsigned r = CDR_SPLINE_DEGREE - mult;
@@ -540,17 +830,9 @@ void CDRSplineToElement::writeOut(librevenge::RVNGPropertyListVector &vec) const
       }
     }
     // Pass the segment to the path
-
-    node.clear();
-    node.insert("librevenge:path-action", "C");
-    node.insert("svg:x1", Qw[1].first);
-    node.insert("svg:y1", Qw[1].second);
-    node.insert("svg:x2", Qw[2].first);
-    node.insert("svg:y2", Qw[2].second);
-    node.insert("svg:x", Qw[3].first);
-    node.insert("svg:y", Qw[3].second);
-
-    vec.append(node);
+    m_bezierPoints.push_back(Qw[1]);
+    m_bezierPoints.push_back(Qw[2]);
+    m_bezierPoints.push_back(Qw[3]);
 
     std::swap(Qw, NextQw);
 
@@ -571,17 +853,63 @@ void CDRSplineToElement::transform(const CDRTransforms &trafos)
 {
   for (auto &point : m_points)
     trafos.applyToPoint(point.first, point.second);
+  for (auto &point : m_bezierPoints)
+    trafos.applyToPoint(point.first, point.second);
 }
 
 void CDRSplineToElement::transform(const CDRTransform &trafo)
 {
   for (auto &point : m_points)
     trafo.applyToPoint(point.first, point.second);
+  for (auto &point : m_bezierPoints)
+    trafo.applyToPoint(point.first, point.second);
 }
 
 std::unique_ptr<CDRPathElement> CDRSplineToElement::clone()
 {
-  return libcdr::make_unique<CDRSplineToElement>(m_points);
+  auto element = libcdr::make_unique<CDRSplineToElement>(m_points);
+  element->m_bezierPoints = m_bezierPoints;
+  return element;
+}
+
+std::unique_ptr<CDRPathElement> CDRSplineToElement::clone(const CDRTransform &trafo) const
+{
+  auto element = libcdr::make_unique<CDRSplineToElement>(m_points);
+  element->m_bezierPoints = m_bezierPoints;
+  element->transform(trafo);
+  return element;
+}
+
+void CDRSplineToElement::appendGeometry(std::vector<double> &geometry) const
+{
+  geometry.push_back(4.0);
+  geometry.push_back((double)m_points.size());
+  for (const auto &point : m_points)
+  {
+    geometry.push_back(point.first);
+    geometry.push_back(point.second);
+  }
+}
+
+void CDRSplineToElement::extendBBox(CDRPathBBox &bbox) const
+{
+  if (m_points.empty())
+    return;
+  bbox.addPoint(m_points[0].first, m_points[0].second);
+  if (m_bezierPoints.empty())
+    decompose();
+  for (std::size_t i = 0; i + 2 < m_bezierPoints.size(); i += 3)
+  {
+    double x0 = 0.0;
+    double y0 = 0.0;
+    bbox.getLastPoint(x0, y0);
+    double xmin, ymin, xmax, ymax;
+    getCubicBezierBBox(x0, y0, m_bezierPoints[i].first, m_bezierPoints[i].second,
+                       m_bezierPoints[i+1].first, m_bezierPoints[i+1].second,
+                       m_bezierPoints[i+2].first, m_bezierPoints[i+2].second, xmin, ymin, xmax, ymax);
+    bbox.addBox(xmin, ymin, xmax, ymax);
+    bbox.addPoint(m_bezierPoints[i+2].first, m_bezierPoints[i+2].second);
+  }
 }
 
 void CDRArcToElement::writeOut(librevenge::RVNGPropertyListVector &vec) const
@@ -613,6 +941,52 @@ std::unique_ptr<CDRPathElement> CDRArcToElement::clone()
   return make_unique<CDRArcToElement>(m_rx, m_ry, m_rotation, m_largeArc, m_sweep, m_x, m_y);
 }
 
+std::unique_ptr<CDRPathElement> CDRArcToElement::clone(const CDRTransform &trafo) const
+{
+  double rx = m_rx;
+  double ry = m_ry;
+  double rotation = m_rotation;
+  bool sweep = m_sweep;
+  double x = m_x;
+  double y = m_y;
+  trafo.applyToArc(rx, ry, rotation, sweep, x, y);
+  return make_unique<CDRArcToElement>(rx, ry, rotation, m_largeArc, sweep, x, y);
+}
+
+void CDRArcToElement::appendGeometry(std::vector<double> &geometry) const
+{
+  geometry.push_back(5.0);
+  geometry.push_back(m_rx);
+  geometry.push_back(m_ry);
+  geometry.push_back(m_rotation);
+  geometry.push_back(m_largeArc ? 1.0 : 0.0);
+  geometry.push_back(m_sweep ? 1.0 : 0.0);
+  geometry.push_back(m_x);
+  geometry.push_back(m_y);
+}
+
+void CDRArcToElement::extendBBox(CDRPathBBox &bbox) const
+{
+  double x0 = m_x;
+  double y0 = m_y;
+  bbox.getLastPoint(x0, y0);
+  double xmin, ymin, xmax, ymax;
+  getEllipticalArcBBox(x0, y0, m_rx, m_ry, m_rotation * 180 / M_PI, m_largeArc, m_sweep, m_x, m_y, xmin, ymin, xmax, ymax);
+  bbox.addBox(xmin, ymin, xmax, ymax);
+  bbox.addPoint(m_x, m_y);
+}
+
+bool CDRArcToElement::flatten(double &x, double &y, double tolerance) const
+{
+  double xmin, ymin, xmax, ymax;
+  getEllipticalArcBBox(x, y, m_rx, m_ry, m_rotation * 180 / M_PI, m_largeArc, m_sweep, m_x, m_y, xmin, ymin, xmax, ymax);
+  if (!isBoxNearSegment(xmin, ymin, xmax, ymax, x, y, m_x, m_y, tolerance))
+    return false;
+  x = m_x;
+  y = m_y;
+  return true;
+}
+
 void CDRClosePathElement::transform(const CDRTransforms &)
 {
 }
@@ -626,6 +1000,20 @@ std::unique_ptr<CDRPathElement> CDRClosePathElement::clone()
   return make_unique<CDRClosePathElement>();
 }
 
+std::unique_ptr<CDRPathElement> CDRClosePathElement::clone(const CDRTransform &) const
+{
+  return make_unique<CDRClosePathElement>();
+}
+
+void CDRClosePathElement::appendGeometry(std::vector<double> &geometry) const
+{
+  geometry.push_back(6.0);
+}
+
+void CDRClosePathElement::extendBBox(CDRPathBBox &) const
+{
+}
+
 void CDRClosePathElement::writeOut(librevenge::RVNGPropertyListVector &vec) const
 {
   librevenge::RVNGPropertyList node;
@@ -635,41 +1023,48 @@ void CDRClosePathElement::writeOut(librevenge::RVNGPropertyListVector &vec) cons
 
 void CDRPath::appendMoveTo(double x, double y)
 {
+  m_isBBoxValid = false;
   m_elements.push_back(make_unique<CDRMoveToElement>(x, y));
 }
 
 void CDRPath::appendLineTo(double x, double y)
 {
+  m_isBBoxValid = false;
   m_elements.push_back(make_unique<CDRLineToElement>(x, y));
 }
 
 void CDRPath::appendCubicBezierTo(double x1, double y1, double x2, double y2, double x, double y)
 {
+  m_isBBoxValid = false;
   m_elements.push_back(make_unique<CDRCubicBezierToElement>(x1, y1, x2, y2, x, y));
 }
 
 void CDRPath::appendQuadraticBezierTo(double x1, double y1, double x, double y)
 {
+  m_isBBoxValid = false;
   m_elements.push_back(make_unique<CDRQuadraticBezierToElement>(x1, y1, x, y));
 }
 
 void CDRPath::appendArcTo(double rx, double ry, double rotation, bool longAngle, bool sweep, double x, double y)
 {
+  m_isBBoxValid = false;
   m_elements.push_back(make_unique<CDRArcToElement>(rx, ry, rotation, longAngle, sweep, x, y));
 }
 
 void CDRPath::appendSplineTo(const std::vector<std::pair<double, double> > &points)
 {
+  m_isBBoxValid = false;
   m_elements.push_back(libcdr::make_unique<CDRSplineToElement>(points));
 }
 
 void CDRPath::appendClosePath()
 {
+  m_isBBoxValid = false;
   m_elements.push_back(make_unique<CDRClosePathElement>());
   m_isClosed = true;
 }
 
-CDRPath::CDRPath(const CDRPath &path) : m_elements(), m_isClosed(false)
+CDRPath::CDRPath(const CDRPath &path) : m_elements(), m_isClosed(false), m_bbox(), m_isBBoxValid(false)
 {
   appendPath(path);
   m_isClosed = path.isClosed();
@@ -693,10 +1088,18 @@ CDRPath::~CDRPath()
 
 void CDRPath::appendPath(const CDRPath &path)
 {
+  m_isBBoxValid = false;
   for (const auto &element : path.m_elements)
     m_elements.push_back(element->clone());
 }
 
+void CDRPath::appendPath(const CDRPath &path, const CDRTransform &trafo)
+{
+  m_isBBoxValid = false;
+  for (const auto &element : path.m_elements)
+    m_elements.push_back(element->clone(trafo));
+}
+
 void CDRPath::writeOut(librevenge::RVNGPropertyListVector &vec) const
 {
   bool wasZ = true;
@@ -728,72 +1131,8 @@ void CDRPath::writeOut(librevenge::RVNGString &path, librevenge::RVNGString &vie
   if (vec[0]["librevenge:path-action"]->getStr() == "Z")
     return;
 
-  // try to find the bounding box
-  bool isFirstPoint = true;
-
   double px = 0.0, py = 0.0, qx = 0.0, qy = 0.0;
-  double lastX = 0.0;
-  double lastY = 0.0;
-
-  for (unsigned long k = 0; k < vec.count(); ++k)
-  {
-    if (!vec[k]["svg:x"] || !vec[k]["svg:y"])
-      continue;
-    if (isFirstPoint)
-    {
-      px = vec[k]["svg:x"]->getDouble();
-      py = vec[k]["svg:y"]->getDouble();
-      qx = px;
-      qy = py;
-      lastX = px;
-      lastY = py;
-      isFirstPoint = false;
-    }
-    px = (px > vec[k]["svg:x"]->getDouble()) ? vec[k]["svg:x"]->getDouble() : px;
-    py = (py > vec[k]["svg:y"]->getDouble()) ? vec[k]["svg:y"]->getDouble() : py;
-    qx = (qx < vec[k]["svg:x"]->getDouble()) ? vec[k]["svg:x"]->getDouble() : qx;
-    qy = (qy < vec[k]["svg:y"]->getDouble()) ? vec[k]["svg:y"]->getDouble() : qy;
-
-    double xmin, xmax, ymin, ymax;
-
-    if (vec[k]["librevenge:path-action"]->getStr() == "C")
-    {
-      getCubicBezierBBox(lastX, lastY, vec[k]["svg:x1"]->getDouble(), vec[k]["svg:y1"]->getDouble(),
-                         vec[k]["svg:x2"]->getDouble(), vec[k]["svg:y2"]->getDouble(),
-                         vec[k]["svg:x"]->getDouble(), vec[k]["svg:y"]->getDouble(), xmin, ymin, xmax, ymax);
-
-      px = (px > xmin ? xmin : px);
-      py = (py > ymin ? ymin : py);
-      qx = (qx < xmax ? xmax : qx);
-      qy = (qy < ymax ? ymax : qy);
-    }
-    if (vec[k]["librevenge:path-action"]->getStr() == "Q")
-    {
-      getQuadraticBezierBBox(lastX, lastY, vec[k]["svg:x1"]->getDouble(), vec[k]["svg:y1"]->getDouble(),
-                             vec[k]["svg:x"]->getDouble(), vec[k]["svg:y"]->getDouble(), xmin, ymin, xmax, ymax);
-
-      px = (px > xmin ? xmin : px);
-      py = (py > ymin ? ymin : py);
-      qx = (qx < xmax ? xmax : qx);
-      qy = (qy < ymax ? ymax : qy);
-    }
-    if (vec[k]["librevenge:path-action"]->getStr() == "A")
-    {
-      getEllipticalArcBBox(lastX, lastY, vec[k]["svg:rx"]->getDouble(), vec[k]["svg:ry"]->getDouble(),
-                           vec[k]["librevenge:rotate"] ? vec[k]["librevenge:rotate"]->getDouble() : 0.0,
-                           vec[k]["librevenge:large-arc"] ? vec[k]["librevenge:large-arc"]->getInt() : 1,
-                           vec[k]["librevenge:sweep"] ? vec[k]["librevenge:sweep"]->getInt() : 1,
-                           vec[k]["svg:x"]->getDouble(), vec[k]["svg:y"]->getDouble(), xmin, ymin, xmax, ymax);
-
-      px = (px > xmin ? xmin : px);
-      py = (py > ymin ? ymin : py);
-      qx = (qx < xmax ? xmax : qx);
-      qy = (qy < ymax ? ymax : qy);
-    }
-    lastX = vec[k]["svg:x"]->getDouble();
-    lastY = vec[k]["svg:y"]->getDouble();
-  }
-
+  boundingBox(px, py, qx, qy);
 
   width = qy - py;
   viewBox.sprintf("%i %i %i %i", 0, 0, (int)(2540*(qx - px)), (int)(2540*(qy - py)));
@@ -847,12 +1186,14 @@ void CDRPath::writeOut(librevenge::RVNGString &path, librevenge::RVNGString &vie
 
 void CDRPath::transform(const CDRTransforms &trafos)
 {
+  m_isBBoxValid = false;
   for (auto &element : m_elements)
     element->transform(trafos);
 }
 
 void CDRPath::transform(const CDRTransform &trafo)
 {
+  m_isBBoxValid = false;
   for (auto &element : m_elements)
     element->transform(trafo);
 }
@@ -862,10 +1203,125 @@ std::unique_ptr<CDRPathElement> CDRPath::clone()
   return make_unique<CDRPath>(*this);
 }
 
+std::unique_ptr<CDRPathElement> CDRPath::clone(const CDRTransform &trafo) const
+{
+  auto path = make_unique<CDRPath>();
+  path->appendPath(*this, trafo);
+  path->m_isClosed = m_isClosed;
+  return path;
+}
+
+void CDRPath::appendGeometry(std::vector<double> &geometry) const
+{
+  geometry.push_back(m_isClosed ? 8.0 : 7.0);
+  geometry.push_back((double)m_elements.size());
+  for (const auto &element : m_elements)
+    element->appendGeometry(geometry);
+}
+
+void CDRPath::extendBBox(CDRPathBBox &bbox) const
+{
+  for (const auto &element : m_elements)
+    element->extendBBox(bbox);
+}
+
+bool CDRPath::boundingBox(double &xmin, double &ymin, double &xmax, double &ymax) const
+{
+  if (!m_isBBoxValid)
+  {
+    m_bbox = CDRPathBBox();
+    extendBBox(m_bbox);
+    m_isBBoxValid = true;
+  }
+  if (m_bbox.empty())
+    return false;
+  m_bbox.get(xmin, ymin, xmax, ymax);
+  return true;
+}
+
+// Replaces the run by lines to the points of it that are needed and empties it
+static void appendPolyline(std::vector<std::unique_ptr<CDRPathElement>> &elements, std::vector<std::pair<double, double> > &run, double tolerance)
+{
+  if (run.empty())
+    return;
+  std::vector<bool> keep;
+  markPolylinePoints(run, tolerance, keep);
+  for (std::size_t i = 1; i < run.size(); ++i)
+  {
+    if (keep[i])
+      elements.push_back(make_unique<CDRLineToElement>(run[i].first, run[i].second));
+  }
+  run.clear();
+}
+
+void CDRPath::simplify(double tolerance)
+{
+  // Half of the tolerance is used for flattening and half for dropping points
+  tolerance /= 2.0;
+  std::vector<std::unique_ptr<CDRPathElement>> elements;
+  elements.reserve(m_elements.size());
+  // Points of the current run of elements that are replaced by lines
+  std::vector<std::pair<double, double> > run;
+  // Only the last point of the cursor is used, to follow the current point
+  CDRPathBBox cursor;
+  double startX = 0.0;
+  double startY = 0.0;
+  for (auto &element : m_elements)
+  {
+    double x = 0.0;
+    double y = 0.0;
+    cursor.getLastPoint(x, y);
+    const double x0 = x;
+    const double y0 = y;
+    if (!cursor.empty() && element->flatten(x, y, tolerance))
+    {
+      if (run.empty())
+        run.push_back(std::make_pair(x0, y0));
+      run.push_back(std::make_pair(x, y));
+      cursor.addPoint(x, y);
+      continue;
+    }
+    appendPolyline(elements, run, tolerance);
+    if (dynamic_cast<CDRClosePathElement *>(element.get()))
+    {
+      cursor.addPoint(startX, startY);
+    }
+    else
+    {
+      element->extendBBox(cursor);
+      if (dynamic_cast<CDRMoveToElement *>(element.get()))
+        cursor.getLastPoint(startX, startY);
+    }
+    elements.push_back(std::move(element));
+  }
+  appendPolyline(elements, run, tolerance);
+  m_elements.swap(elements);
+  m_isBBoxValid = false;
+}
+
 void CDRPath::clear()
 {
   m_elements.clear();
   m_isClosed = false;
+  m_isBBoxValid = false;
+}
+
+void CDRPath::swap(CDRPath &path)
+{
+  m_elements.swap(path.m_elements);
+  std::swap(m_isClosed, path.m_isClosed);
+  std::swap(m_bbox, path.m_bbox);
+  std::swap(m_isBBoxValid, path.m_isBBoxValid);
+}
+
+void CDRPath::reserve(std::size_t size)
+{
+  m_elements.reserve(size);
+}
+
+std::size_t CDRPath::size() const
+{
+  return m_elements.size();
 }
 
 bool CDRPath::empty() const
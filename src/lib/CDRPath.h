@@ -21,6 +21,32 @@ namespace libcdr
 class CDRTransform;
 class CDRTransforms;
 
+/* Bounding box of path elements, extended in path order. Curves need
+   the end point of the element before them. */
+class CDRPathBBox
+{
+public:
+  CDRPathBBox() : m_xmin(0.0), m_ymin(0.0), m_xmax(0.0), m_ymax(0.0), m_lastX(0.0), m_lastY(0.0), m_empty(true) {}
+  void addPoint(double x, double y);
+  void addBox(double xmin, double ymin, double xmax, double ymax);
+  // Replaces x and y by the last point added, if there is one
+  void getLastPoint(double &x, double &y) const;
+  void get(double &xmin, double &ymin, double &xmax, double &ymax) const;
+  bool empty() const
+  {
+    return m_empty;
+  }
+
+private:
+  double m_xmin;
+  double m_ymin;
+  double m_xmax;
+  double m_ymax;
+  double m_lastX;
+  double m_lastY;
+  bool m_empty;
+};
+
 class CDRPathElement
 {
 public:
@@ -30,13 +56,24 @@ public:
   virtual void transform(const CDRTransforms &trafos) = 0;
   virtual void transform(const CDRTransform &trafo) = 0;
   virtual std::unique_ptr<CDRPathElement> clone() = 0;
+  // Returns a copy of the element made directly from the transformed points
+  virtual std::unique_ptr<CDRPathElement> clone(const CDRTransform &trafo) const = 0;
+  // Appends a description of the shape that compares equal for equal shapes
+  virtual void appendGeometry(std::vector<double> &geometry) const = 0;
+  virtual void extendBBox(CDRPathBBox &bbox) const = 0;
+  /* If the element starting at (x, y) stays within tolerance of the line
+     to its end point, replaces x and y by the end point and returns true. */
+  virtual bool flatten(double &, double &, double) const
+  {
+    return false;
+  }
 };
 
 
 class CDRPath : public CDRPathElement
 {
 public:
-  CDRPath() : m_elements(), m_isClosed(false) {}
+  CDRPath() : m_elements(), m_isClosed(false), m_bbox(), m_isBBoxValid(false) {}
   CDRPath(const CDRPath &path);
   ~CDRPath() override;
 
@@ -50,20 +87,33 @@ public:
   void appendArcTo(double rx, double ry, double rotation, bool longAngle, bool sweep, double x, double y);
   void appendClosePath();
   void appendPath(const CDRPath &path);
+  void appendPath(const CDRPath &path, const CDRTransform &trafo);
 
   void writeOut(librevenge::RVNGPropertyListVector &vec) const override;
   void writeOut(librevenge::RVNGString &path, librevenge::RVNGString &viewBox, double &width) const;
   void transform(const CDRTransforms &trafos) override;
   void transform(const CDRTransform &trafo) override;
   std::unique_ptr<CDRPathElement> clone() override;
+  std::unique_ptr<CDRPathElement> clone(const CDRTransform &trafo) const override;
+  void appendGeometry(std::vector<double> &geometry) const override;
+  void extendBBox(CDRPathBBox &bbox) const override;
+  // Returns false if the path has no points; the result is kept until the path changes
+  bool boundingBox(double &xmin, double &ymin, double &xmax, double &ymax) const;
+  // Replaces nearly straight parts by fewer lines, moving no point by more than tolerance
+  void simplify(double tolerance);
 
   void clear();
+  void swap(CDRPath &path);
+  void reserve(std::size_t size);
+  std::size_t size() const;
   bool empty() const;
   bool isClosed() const;
 
 private:
   std::vector<std::unique_ptr<CDRPathElement>> m_elements;
   bool m_isClosed;
+  mutable CDRPathBBox m_bbox;
+  mutable bool m_isBBoxValid;
 };
 
 } // namespace libcdr
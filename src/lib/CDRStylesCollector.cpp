@@ -9,43 +9,259 @@
 
 #include "CDRStylesCollector.h"
 
-#include "CDRInternalStream.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string.h>
+
+#include "CDRTrace.h"
 #include "libcdr_utils.h"
 
 #ifndef DUMP_IMAGE
 #define DUMP_IMAGE 0
 #endif
 
+namespace
+{
 
-libcdr::CDRStylesCollector::CDRStylesCollector(libcdr::CDRParserState &ps) :
-  m_ps(ps), m_page(8.5, 11.0, -4.25, -5.5)
+uint64_t rotateLeft(uint64_t value, unsigned bits)
 {
+  return (value << bits) | (value >> (64 - bits));
+}
+
+// The finalizer of MurmurHash3
+uint64_t mixBits(uint64_t value)
+{
+  value ^= value >> 33;
+  value *= 0xff51afd7ed558ccdULL;
+  value ^= value >> 33;
+  value *= 0xc4ceb9fe1a85ec53ULL;
+  value ^= value >> 33;
+  return value;
+}
+
+/* 128-bit hash in the manner of MurmurHash3, used to recognize bitmaps
+   embedded more than once without keeping their data. It reads 8 bytes
+   at a time; the value depends on the byte order of the machine, which
+   is fine as it is never stored. */
+class BmpHash
+{
+public:
+  BmpHash() : m_hash1(0x9e3779b97f4a7c15ULL), m_hash2(0x2545f4914f6cdd1dULL) {}
+
+  void add(const unsigned char *data, size_t size)
+  {
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+      uint64_t word = 0;
+      memcpy(&word, data + i, 8);
+      _addWord(word);
+    }
+    if (i < size)
+    {
+      uint64_t word = 0;
+      memcpy(&word, data + i, size - i);
+      _addWord(word);
+    }
+    _addWord(size);
+  }
+
+  void add(unsigned value)
+  {
+    _addWord(value);
+  }
+
+  void get(uint64_t &hash1, uint64_t &hash2) const
+  {
+    hash1 = m_hash1 + m_hash2;
+    hash2 = m_hash2 + hash1;
+    hash1 = mixBits(hash1);
+    hash2 = mixBits(hash2);
+    hash1 += hash2;
+    hash2 += hash1;
+  }
+
+private:
+  void _addWord(uint64_t word)
+  {
+    m_hash1 ^= rotateLeft(word * 0x87c37b91114253d5ULL, 31) * 0x4cf5ad432745937fULL;
+    m_hash1 = rotateLeft(m_hash1, 27) * 5 + 0x52dce729;
+    m_hash2 ^= rotateLeft(word * 0x4cf5ad432745937fULL, 33) * 0x87c37b91114253d5ULL;
+    m_hash2 = rotateLeft(m_hash2, 31) * 5 + 0x38495ab5;
+  }
+
+  uint64_t m_hash1;
+  uint64_t m_hash2;
+};
+
+// Writes 32-bit pixels to the image as little-endian BGRA
+void appendPixels(librevenge::RVNGBinaryData &image, std::vector<unsigned char> &buffer, const unsigned *pixels, size_t count)
+{
+  if (!count)
+    return;
+  if (buffer.size() < count * 4)
+    buffer.resize(count * 4);
+  for (size_t i = 0; i < count; ++i)
+  {
+    buffer[i * 4] = (unsigned char)(pixels[i] & 0xff);
+    buffer[i * 4 + 1] = (unsigned char)((pixels[i] >> 8) & 0xff);
+    buffer[i * 4 + 2] = (unsigned char)((pixels[i] >> 16) & 0xff);
+    buffer[i * 4 + 3] = (unsigned char)((pixels[i] >> 24) & 0xff);
+  }
+  image.append(&buffer[0], count * 4);
+}
+
+} // anonymous namespace
+
+
+libcdr::CDRStylesCollector::CDRStylesCollector(libcdr::CDRParserState &ps, const CDRParseOptionsImpl &options) :
+  m_ps(ps), m_page(8.5, 11.0, -4.25, -5.5), m_options(options), m_bitmapPool()
+{
+  if (options.bitmapThreads)
+    m_bitmapPool.reset(new CDRTaskPool(options.bitmapThreads));
 }
 
 libcdr::CDRStylesCollector::~CDRStylesCollector()
 {
 }
 
-void libcdr::CDRStylesCollector::collectBmp(unsigned imageId, unsigned colorModel, unsigned width, unsigned height, unsigned bpp, const std::vector<unsigned> &palette, const std::vector<unsigned char> &bitmap)
+bool libcdr::CDRStylesCollector::_readBmpRow(std::vector<unsigned> &row, unsigned j, unsigned colorModel, unsigned width, unsigned bpp,
+                                              const std::vector<unsigned> &colorTable, const std::vector<unsigned char> &bitmap, unsigned long lineWidth)
 {
-  libcdr::CDRInternalStream stream(bitmap);
-  librevenge::RVNGBinaryData image;
+  row.clear();
+  const unsigned char *line = bitmap.empty() ? nullptr : &bitmap[j*lineWidth];
+  if (colorModel == 6)
+  {
+    unsigned i = 0;
+    unsigned k = 0;
+    while (i <lineWidth && k < width)
+    {
+      unsigned l = 0;
+      unsigned char c = line[i];
+      i++;
+      while (k < width && l < 8)
+      {
+        if (c & 0x80)
+          row.push_back(0xffffff);
+        else
+          row.push_back(0);
+        c <<= 1;
+        l++;
+        k++;
+      }
+    }
+  }
+  else if (!colorTable.empty())
+  {
+    row.resize((size_t)std::min<unsigned long>(lineWidth, width));
+    for (size_t k = 0; k < row.size(); ++k)
+      row[k] = colorTable[line[k]];
+  }
+  else if (bpp == 24 && lineWidth >= 3)
+  {
+    row.resize((size_t)std::min<unsigned long>(lineWidth / 3, width));
+    for (size_t k = 0; k < row.size(); ++k)
+      row[k] = ((unsigned)line[3*k+2] << 16) | ((unsigned)line[3*k+1] << 8) | (unsigned)line[3*k];
+    m_ps.getBMPColors((unsigned short)colorModel, row);
+  }
+  else if (bpp == 32 && lineWidth >= 4)
+  {
+    row.resize((size_t)std::min<unsigned long>(lineWidth / 4, width));
+    for (size_t k = 0; k < row.size(); ++k)
+      row[k] = ((unsigned)line[4*k+3] << 24) | ((unsigned)line[4*k+2] << 16) | ((unsigned)line[4*k+1] << 8) | (unsigned)line[4*k];
+    m_ps.getBMPColors((unsigned short)colorModel, row);
+  }
+  else
+    return false;
+  return true;
+}
 
+void libcdr::CDRStylesCollector::collectBmp(unsigned imageId, unsigned colorModel, unsigned width, unsigned height, unsigned bpp, const std::vector<unsigned> &palette, const std::vector<unsigned char> &bitmap)
+{
   if (height == 0)
     height = 1;
 
-  auto tmpPixelSize = (unsigned)(height * width);
-  if (tmpPixelSize < (unsigned)height) // overflow
+  // The same data converted with other color transforms gives another image
+  const unsigned generation = m_ps.getColorTransformGeneration();
+  BmpHash hash;
+  for (unsigned c : palette)
+    hash.add(c);
+  if (!bitmap.empty())
+    hash.add(&bitmap[0], bitmap.size());
+  CDRBmpKey key(generation, colorModel, width, height, bpp, palette.size(), bitmap.size(), 0, 0);
+  hash.get(key.hash1, key.hash2);
+  if (m_ps.shareBmp(imageId, key))
+    return;
+
+  if (m_bitmapPool)
+  {
+    /* The parser's buffer is gone once this returns, so the task gets the
+       one copy of the data, which it frees as soon as it is converted.
+       Besides that, the conversion only reads the color transforms. */
+    std::shared_ptr<const CDRBitmap> bmp = std::make_shared<CDRBitmap>(colorModel, width, height, bpp, palette, bitmap);
+    std::shared_ptr<std::promise<librevenge::RVNGBinaryData> > result = std::make_shared<std::promise<librevenge::RVNGBinaryData> >();
+    m_ps.insertBmp(imageId, key, result->get_future().share());
+    m_bitmapPool->post(std::bind(&CDRStylesCollector::_convertBmpTask, this, imageId, bmp, result));
     return;
+  }
+
+  librevenge::RVNGBinaryData image = _convertBmp(imageId, colorModel, width, height, bpp, palette, bitmap);
+  if (!image.empty())
+    m_ps.insertBmp(imageId, key, image);
+}
+
+void libcdr::CDRStylesCollector::_convertBmpTask(unsigned imageId, const std::shared_ptr<const CDRBitmap> &bmp,
+                                                 const std::shared_ptr<std::promise<librevenge::RVNGBinaryData> > &result)
+{
+  try
+  {
+    result->set_value(_convertBmp(imageId, bmp->colorModel, bmp->width, bmp->height, bmp->bpp, bmp->palette, bmp->bitmap));
+  }
+  catch (...)
+  {
+    result->set_exception(std::current_exception());
+  }
+}
+
+librevenge::RVNGBinaryData libcdr::CDRStylesCollector::_convertBmp(unsigned imageId, unsigned colorModel, unsigned width, unsigned height, unsigned bpp,
+                                                                     const std::vector<unsigned> &palette, const std::vector<unsigned char> &bitmap)
+{
+  librevenge::RVNGBinaryData image;
+
+  CDR_TRACE_SPAN(bmpSpan, "collectBmp");
+  CDR_TRACE_ARG(bmpSpan, "color model", colorModel);
+  CDR_TRACE_ARG(bmpSpan, "bpp", bpp);
+  CDR_TRACE_ARG(bmpSpan, "pixels", (unsigned long long)width * height);
+  CDR_TRACE_ARG(bmpSpan, "bytes", bitmap.size());
+
+  // Images over the pixel budget are shrunk by an integer box filter
+  // while converting, one block of rows at a time
+  unsigned factor = 1;
+  if (m_options.maxBitmapPixels && width && (unsigned long long)width * height > m_options.maxBitmapPixels)
+  {
+    factor = (unsigned)std::ceil(std::sqrt((double)width * height / (double)m_options.maxBitmapPixels));
+    while ((unsigned long long)((width + factor - 1) / factor) * ((height + factor - 1) / factor) > m_options.maxBitmapPixels)
+      ++factor;
+    CDR_DEBUG_MSG(("CDRStylesCollector::collectBmp: downsampling %ux%u image by %u\n", width, height, factor));
+  }
+  const unsigned dibWidth = (width + factor - 1) / factor;
+  const unsigned dibHeight = (height + factor - 1) / factor;
+
+  auto tmpPixelSize = (unsigned)(dibHeight * dibWidth);
+  if (tmpPixelSize < (unsigned)dibHeight) // overflow
+    return librevenge::RVNGBinaryData();
 
   unsigned tmpDIBImageSize = tmpPixelSize * 4;
   if (tmpPixelSize > tmpDIBImageSize) // overflow !!!
-    return;
+    return librevenge::RVNGBinaryData();
 
   unsigned tmpDIBOffsetBits = 14 + 40;
   unsigned tmpDIBFileSize = tmpDIBOffsetBits + tmpDIBImageSize;
   if (tmpDIBImageSize > tmpDIBFileSize) // overflow !!!
-    return;
+    return librevenge::RVNGBinaryData();
 
   // Create DIB file header
   writeU16(image, 0x4D42);  // Type
@@ -57,8 +273,8 @@ void libcdr::CDRStylesCollector::collectBmp(unsigned imageId, unsigned colorMode
   // Create DIB Info header
   writeU32(image, 40); // Size
 
-  writeU32(image, width);  // Width
-  writeU32(image, height); // Height
+  writeU32(image, dibWidth);  // Width
+  writeU32(image, dibHeight); // Height
 
   writeU16(image, 1); // Planes
   writeU16(image, 32); // BitCount
@@ -72,96 +288,87 @@ void libcdr::CDRStylesCollector::collectBmp(unsigned imageId, unsigned colorMode
   // Cater for eventual padding
   unsigned long lineWidth = bitmap.size() / height;
 
-  bool storeBMP = true;
+  // Gray and palette pixels are single bytes, so their colors are converted
+  // once per image instead of once per pixel
+  std::vector<unsigned> colorTable;
+  if (colorModel == 5 || (colorModel != 6 && !palette.empty()))
+  {
+    colorTable.resize(256);
+    for (unsigned c = 0; c < 256; ++c)
+      colorTable[c] = colorModel == 5 ? c : palette[std::min<size_t>(c, palette.size() - 1)];
+    m_ps.getBMPColors((unsigned short)colorModel, colorTable);
+  }
+
+  std::vector<unsigned> row;
+  row.reserve(width);
+  // one row of the output image, appended to it at once
+  std::vector<unsigned char> line;
+  // per channel sums of the source pixels covered by each output pixel
+  std::vector<uint64_t> sums(factor > 1 ? (size_t)dibWidth * 4 : 0);
+  unsigned rowsInBlock = 0;
 
   for (unsigned j = 0; j < height; ++j)
   {
-    unsigned i = 0;
-    unsigned k = 0;
-    if (colorModel == 6)
-    {
-      while (i <lineWidth && k < width)
-      {
-        unsigned l = 0;
-        unsigned char c = bitmap[j*lineWidth+i];
-        i++;
-        while (k < width && l < 8)
-        {
-          if (c & 0x80)
-            writeU32(image, 0xffffff);
-          else
-            writeU32(image, 0);
-          c <<= 1;
-          l++;
-          k++;
-        }
-      }
-    }
-    else if (colorModel == 5)
-    {
-      while (i <lineWidth && i < width)
-      {
-        unsigned char c = bitmap[j*lineWidth+i];
-        i++;
-        writeU32(image, m_ps.getBMPColor(libcdr::CDRColor((unsigned short)colorModel, c)));
-      }
-    }
-    else if (!palette.empty())
+    checkInterruption(m_options);
+    if (!_readBmpRow(row, j, colorModel, width, bpp, colorTable, bitmap, lineWidth))
+      return librevenge::RVNGBinaryData();
+    if (factor == 1)
     {
-      while (i < lineWidth && i < width)
-      {
-        unsigned long c = bitmap[j*lineWidth+i];
-        if (c >= palette.size())
-          c = palette.size() - 1;
-        i++;
-        writeU32(image, m_ps.getBMPColor(libcdr::CDRColor((unsigned short)colorModel, palette[c])));
-      }
+      appendPixels(image, line, row.empty() ? nullptr : &row[0], row.size());
+      continue;
     }
-    else if (bpp == 24 && lineWidth >= 3)
+    for (unsigned k = 0; k < row.size(); ++k)
     {
-      while (i < lineWidth -2 && k < width)
-      {
-        unsigned c = ((unsigned)bitmap[j*lineWidth+i+2] << 16) | ((unsigned)bitmap[j*lineWidth+i+1] << 8) | ((unsigned)bitmap[j*lineWidth+i]);
-        i += 3;
-        writeU32(image, m_ps.getBMPColor(libcdr::CDRColor((unsigned short)colorModel, c)));
-        k++;
-      }
+      uint64_t *sum = &sums[(k / factor) * 4];
+      for (unsigned b = 0; b < 4; ++b)
+        sum[b] += (row[k] >> (8 * b)) & 0xff;
     }
-    else if (bpp == 32 && lineWidth >= 4)
+    if (++rowsInBlock == factor || j + 1 == height)
     {
-      while (i < lineWidth - 3 && k < width)
+      row.resize(dibWidth);
+      for (unsigned x = 0; x < dibWidth; ++x)
       {
-        unsigned c = (bitmap[j*lineWidth+i+3] << 24) | (bitmap[j*lineWidth+i+2] << 16) | (bitmap[j*lineWidth+i+1] << 8) | (bitmap[j*lineWidth+i]);
-        i += 4;
-        writeU32(image, m_ps.getBMPColor(libcdr::CDRColor((unsigned short)colorModel, c)));
-        k++;
+        const uint64_t count = (uint64_t)std::min(factor, width - x * factor) * rowsInBlock;
+        unsigned c = 0;
+        for (unsigned b = 0; b < 4; ++b)
+          c |= (unsigned)((sums[x * 4 + b] + count / 2) / count) << (8 * b);
+        row[x] = c;
       }
+      appendPixels(image, line, row.empty() ? nullptr : &row[0], row.size());
+      std::fill(sums.begin(), sums.end(), 0);
+      rowsInBlock = 0;
     }
-    else
-      storeBMP = false;
   }
 
-  if (storeBMP)
-  {
 #if DUMP_IMAGE
-    librevenge::RVNGString filename;
-    filename.sprintf("bitmap%.8x.bmp", imageId);
-    FILE *f = fopen(filename.cstr(), "wb");
-    if (f)
-    {
-      const unsigned char *tmpBuffer = image.getDataBuffer();
-      for (unsigned long k = 0; k < image.size(); k++)
-        fprintf(f, "%c",tmpBuffer[k]);
-      fclose(f);
-    }
+  librevenge::RVNGString filename;
+  filename.sprintf("bitmap%.8x.bmp", imageId);
+  FILE *f = fopen(filename.cstr(), "wb");
+  if (f)
+  {
+    const unsigned char *tmpBuffer = image.getDataBuffer();
+    for (unsigned long k = 0; k < image.size(); k++)
+      fprintf(f, "%c",tmpBuffer[k]);
+    fclose(f);
+  }
+#else
+  (void)imageId;
 #endif
 
-    m_ps.m_bmps[imageId] = image;
-  }
+  return image;
 }
 
 void libcdr::CDRStylesCollector::collectBmp(unsigned imageId, const std::vector<unsigned char> &bitmap)
 {
+  BmpHash hash;
+  if (!bitmap.empty())
+    hash.add(&bitmap[0], bitmap.size());
+  // distinguish embedded image files from raw bitmaps with the same bytes
+  CDRBmpKey key(0, 0xffffffff, 0, 0, 0, 0, bitmap.size(), 0, 0);
+  hash.get(key.hash1, key.hash2);
+  if (m_ps.shareBmp(imageId, key))
+    return;
+
   librevenge::RVNGBinaryData image(&bitmap[0], bitmap.size());
 #if DUMP_IMAGE
   librevenge::RVNGString filename;
@@ -176,7 +383,7 @@ void libcdr::CDRStylesCollector::collectBmp(unsigned imageId, const std::vector<
   }
 #endif
 
-  m_ps.m_bmps[imageId] = image;
+  m_ps.insertBmp(imageId, key, image);
 }
 
 void libcdr::CDRStylesCollector::collectPageSize(double width, double height, double offsetX, double offsetY)
@@ -199,8 +406,11 @@ void libcdr::CDRStylesCollector::collectBmpf(unsigned patternId, unsigned width,
 
 void libcdr::CDRStylesCollector::collectColorProfile(const std::vector<unsigned char> &profile)
 {
-  if (!profile.empty())
-    m_ps.setColorTransform(profile);
+  if (profile.empty())
+    return;
+  // bitmaps collected so far are converted with the old transforms
+  m_ps.waitForBmps();
+  m_ps.setColorTransform(profile);
 }
 
 void libcdr::CDRStylesCollector::collectPaletteEntry(unsigned colorId, unsigned /* userId */, const libcdr::CDRColor &color)
@@ -214,49 +424,47 @@ void libcdr::CDRStylesCollector::collectText(unsigned textId, unsigned styleId,
   if (data.empty() && styleOverrides.empty())
     return;
 
-  unsigned char tmpCharDescription = 0;
-  unsigned i = 0;
-  unsigned j = 0;
-  std::vector<unsigned char> tmpTextData;
-  CDRStyle defaultCharStyle, tmpCharStyle;
+  CDRStyle defaultCharStyle;
   m_ps.getRecursedStyle(defaultCharStyle, styleId);
 
+  // Split the text into runs of characters with the same description
+  // and resolve the style only once for each run
+  unsigned char runDescription = 0;
+  unsigned i = 0;
+  unsigned j = 0;
+  std::vector<unsigned char> runData;
+  runData.reserve(data.size());
   CDRTextLine line;
-  for (i=0, j=0; i<charDescriptions.size() && j<data.size(); ++i)
+  while (true)
   {
-    tmpCharStyle = defaultCharStyle;
-    auto iter = styleOverrides.find(tmpCharDescription & 0xfe);
-    if (iter != styleOverrides.end())
-      tmpCharStyle.overrideStyle(iter->second);
-    if (charDescriptions[i] != tmpCharDescription)
+    while (i < charDescriptions.size() && j < data.size() && charDescriptions[i] == runDescription)
     {
-      librevenge::RVNGString text;
-      if (!tmpTextData.empty())
-      {
-        if (tmpCharDescription & 0x01)
-          appendCharacters(text, tmpTextData);
-        else
-          appendCharacters(text, tmpTextData, tmpCharStyle.m_charSet);
-      }
-      line.append(CDRText(text, tmpCharStyle));
-      tmpTextData.clear();
-      tmpCharDescription = charDescriptions[i];
+      runData.push_back(data[j++]);
+      if ((runDescription & 0x01) && (j < data.size()))
+        runData.push_back(data[j++]);
+      ++i;
+    }
 
+    CDRStyle runStyle(defaultCharStyle);
+    auto iter = styleOverrides.find(runDescription & 0xfe);
+    if (iter != styleOverrides.end())
+      runStyle.overrideStyle(iter->second);
+    librevenge::RVNGString text;
+    if (!runData.empty())
+    {
+      if (runDescription & 0x01)
+        appendCharacters(text, runData);
+      else
+        appendCharacters(text, runData, runStyle.m_charSet);
     }
-    tmpTextData.push_back(data[j++]);
-    if ((tmpCharDescription & 0x01) && (j < data.size()))
-      tmpTextData.push_back(data[j++]);
-  }
-  librevenge::RVNGString text;
-  if (!tmpTextData.empty())
-  {
-    if (tmpCharDescription & 0x01)
-      appendCharacters(text, tmpTextData);
-    else
-      appendCharacters(text, tmpTextData, tmpCharStyle.m_charSet);
+    CDR_DEBUG_MSG(("CDRStylesCollector::collectText - Text: %s\n", text.cstr()));
+    line.append(CDRText(text, runStyle));
+    runData.clear();
+
+    if (i >= charDescriptions.size() || j >= data.size())
+      break;
+    runDescription = charDescriptions[i];
   }
-  line.append(CDRText(text, tmpCharStyle));
-  CDR_DEBUG_MSG(("CDRStylesCollector::collectText - Text: %s\n", text.cstr()));
 
   std::vector<CDRTextLine> &paragraphVector = m_ps.m_texts[textId];
   paragraphVector.push_back(line);
@@ -10,14 +10,19 @@
 #ifndef __CDRSTYLESCOLLECTOR_H__
 #define __CDRSTYLESCOLLECTOR_H__
 
+#include <future>
 #include <map>
+#include <memory>
 #include <utility>
 #include <vector>
 
 #include <librevenge/librevenge.h>
 
+#include "CDRParseOptionsImpl.h"
+
 #include "CDRTypes.h"
 #include "CDRCollector.h"
+#include "CDRTaskPool.h"
 
 namespace libcdr
 {
@@ -28,7 +33,7 @@ class CDRTransforms;
 class CDRStylesCollector : public CDRCollector
 {
 public:
-  CDRStylesCollector(CDRParserState &ps);
+  CDRStylesCollector(CDRParserState &ps, const CDRParseOptionsImpl &options = CDRParseOptionsImpl());
   ~CDRStylesCollector() override;
 
   // collector functions
@@ -73,8 +78,20 @@ private:
   CDRStylesCollector(const CDRStylesCollector &);
   CDRStylesCollector &operator=(const CDRStylesCollector &);
 
+  bool _readBmpRow(std::vector<unsigned> &row, unsigned j, unsigned colorModel, unsigned width, unsigned bpp,
+                   const std::vector<unsigned> &colorTable, const std::vector<unsigned char> &bitmap, unsigned long lineWidth);
+  // Returns an empty image if the bitmap cannot be converted
+  librevenge::RVNGBinaryData _convertBmp(unsigned imageId, unsigned colorModel, unsigned width, unsigned height, unsigned bpp,
+                                         const std::vector<unsigned> &palette, const std::vector<unsigned char> &bitmap);
+  // Runs on the pool; an interruption is passed on through the result
+  void _convertBmpTask(unsigned imageId, const std::shared_ptr<const CDRBitmap> &bmp,
+                       const std::shared_ptr<std::promise<librevenge::RVNGBinaryData> > &result);
+
   CDRParserState &m_ps;
   CDRPage m_page;
+  const CDRParseOptionsImpl m_options;
+  // converts bitmaps if CDRParseOptionsImpl::bitmapThreads is set; destroyed before m_ps
+  std::unique_ptr<CDRTaskPool> m_bitmapPool;
 };
 
 } // namespace libcdr
@@ -0,0 +1,71 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libcdr project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "CDRTaskPool.h"
+
+libcdr::CDRTaskPool::CDRTaskPool(unsigned threads)
+  : m_threads(), m_tasks(), m_mutex(), m_posted(), m_isStopping(false)
+{
+  m_threads.reserve(threads);
+  try
+  {
+    for (unsigned i = 0; i < threads; ++i)
+      m_threads.push_back(std::thread(&CDRTaskPool::_run, this));
+  }
+  catch (const std::system_error &)
+  {
+    // make do with the threads that could be started
+  }
+}
+
+libcdr::CDRTaskPool::~CDRTaskPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_isStopping = true;
+    m_tasks.clear();
+  }
+  m_posted.notify_all();
+  for (auto &thread : m_threads)
+    thread.join();
+}
+
+void libcdr::CDRTaskPool::post(const std::function<void ()> &task)
+{
+  if (m_threads.empty())
+  {
+    task();
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tasks.push_back(task);
+  }
+  m_posted.notify_one();
+}
+
+void libcdr::CDRTaskPool::_run()
+{
+  while (true)
+  {
+    std::function<void ()> task;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      while (!m_isStopping && m_tasks.empty())
+        m_posted.wait(lock);
+      if (m_isStopping)
+        return;
+      task = std::move(m_tasks.front());
+      m_tasks.pop_front();
+    }
+    task();
+  }
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
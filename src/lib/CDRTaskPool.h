@@ -0,0 +1,52 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libcdr project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef __CDRTASKPOOL_H__
+#define __CDRTASKPOOL_H__
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace libcdr
+{
+
+/* A fixed number of threads that run posted tasks in order. Tasks that
+   have not started when the pool is destroyed are dropped, so results
+   have to be collected through futures before that. If the system cannot
+   start the threads, the pool has fewer of them; without any, tasks are
+   run by post() itself. */
+class CDRTaskPool
+{
+public:
+  explicit CDRTaskPool(unsigned threads);
+  ~CDRTaskPool();
+
+  void post(const std::function<void ()> &task);
+
+private:
+  std::vector<std::thread> m_threads;
+  std::deque<std::function<void ()>> m_tasks;
+  std::mutex m_mutex;
+  std::condition_variable m_posted;
+  bool m_isStopping;
+
+  void _run();
+  CDRTaskPool(const CDRTaskPool &);
+  CDRTaskPool &operator=(const CDRTaskPool &);
+};
+
+} // namespace libcdr
+
+#endif // __CDRTASKPOOL_H__
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,103 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libcdr project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "CDRTrace.h"
+
+#ifdef ENABLE_TRACING
+
+#include <functional>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+
+namespace
+{
+
+class TraceFile
+{
+public:
+  TraceFile()
+    : m_mutex(), m_file(nullptr), m_origin(std::chrono::steady_clock::now())
+  {
+    const char *fileName = getenv("LIBCDR_TRACE");
+    if (fileName && *fileName)
+      m_file = fopen(fileName, "w");
+    // the JSON array format does not need the closing bracket
+    if (m_file)
+      fputs("[\n", m_file);
+  }
+
+  ~TraceFile()
+  {
+    if (m_file)
+      fclose(m_file);
+  }
+
+  bool isOpen() const
+  {
+    return m_file;
+  }
+
+  void write(const char *name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end,
+             const std::string &args)
+  {
+    const auto ts = std::chrono::duration_cast<std::chrono::microseconds>(start - m_origin).count();
+    const auto dur = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    const auto tid = (unsigned long)(std::hash<std::thread::id>()(std::this_thread::get_id()) & 0xffffffff);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    fprintf(m_file, "{\"name\":\"%s\",\"cat\":\"libcdr\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":1,\"tid\":%lu,\"args\":{%s}},\n",
+            name, (long long)ts, (long long)dur, tid, args.c_str());
+  }
+
+private:
+  TraceFile(const TraceFile &);
+  TraceFile &operator=(const TraceFile &);
+
+  std::mutex m_mutex;
+  FILE *m_file;
+  const std::chrono::steady_clock::time_point m_origin;
+};
+
+TraceFile &traceFile()
+{
+  static TraceFile file;
+  return file;
+}
+
+} // anonymous namespace
+
+libcdr::CDRTraceSpan::CDRTraceSpan(const char *name)
+  : m_name(name && traceFile().isOpen() ? name : nullptr), m_start(), m_args()
+{
+  if (m_name)
+    m_start = std::chrono::steady_clock::now();
+}
+
+libcdr::CDRTraceSpan::~CDRTraceSpan()
+{
+  if (m_name)
+    traceFile().write(m_name, m_start, std::chrono::steady_clock::now(), m_args);
+}
+
+void libcdr::CDRTraceSpan::addArg(const char *key, unsigned long long value)
+{
+  if (!m_name)
+    return;
+  if (!m_args.empty())
+    m_args += ",";
+  m_args += "\"";
+  m_args += key;
+  m_args += "\":";
+  m_args += std::to_string(value);
+}
+
+#endif
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
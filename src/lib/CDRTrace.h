@@ -0,0 +1,63 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libcdr project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef __CDRTRACE_H__
+#define __CDRTRACE_H__
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+// Tracing is compiled in with configure --enable-tracing only
+#ifdef ENABLE_TRACING
+
+#include <chrono>
+#include <string>
+
+namespace libcdr
+{
+
+/**
+Time spent in one step of the parse. When the span ends, it is written as
+a Chrome trace event ("ph":"X") to the file named by the LIBCDR_TRACE
+environment variable, which can be loaded into chrome://tracing or
+Perfetto. Without the variable, or with a null name, the span does
+nothing.
+*/
+class CDRTraceSpan
+{
+public:
+  explicit CDRTraceSpan(const char *name);
+  ~CDRTraceSpan();
+
+  void addArg(const char *key, unsigned long long value);
+
+private:
+  CDRTraceSpan(const CDRTraceSpan &);
+  CDRTraceSpan &operator=(const CDRTraceSpan &);
+
+  const char *m_name;
+  std::chrono::steady_clock::time_point m_start;
+  std::string m_args;
+};
+
+} // namespace libcdr
+
+#define CDR_TRACE_SPAN(span, name) libcdr::CDRTraceSpan span(name)
+#define CDR_TRACE_ARG(span, key, value) span.addArg(key, (unsigned long long)(value))
+
+#else
+
+#define CDR_TRACE_SPAN(span, name)
+#define CDR_TRACE_ARG(span, key, value)
+
+#endif
+
+#endif // __CDRTRACE_H__
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -9,46 +9,99 @@
 
 #include "CDRTypes.h"
 
+#include <algorithm>
+
 #include "CDRPath.h"
+#include "libcdr_utils.h"
+
+namespace
+{
+
+// Corel Draw itself does not go beyond 500
+constexpr unsigned MAX_POLYGON_ANGLES = 1 << 10;
+
+// Adds the angle with the given cosine and sine to the rotation (c, s)
+void rotate(double &c, double &s, double cosAngle, double sinAngle)
+{
+  const double tmp = c*cosAngle - s*sinAngle;
+  s = s*cosAngle + c*sinAngle;
+  c = tmp;
+}
+
+// Orders WALDO records by type, then by id
+struct WaldoRecordLess
+{
+  bool operator()(const libcdr::WaldoRecordInfo &left, const libcdr::WaldoRecordInfo &right) const
+  {
+    return left.type < right.type || (left.type == right.type && left.id < right.id);
+  }
+  bool operator()(const libcdr::WaldoRecordType1 &left, unsigned id) const
+  {
+    return left.m_id < id;
+  }
+};
+
+}
 
 void libcdr::CDRPolygon::create(libcdr::CDRPath &path) const
 {
   if (m_numAngles == 0)
     return;
+  if (m_numAngles > MAX_POLYGON_ANGLES)
+  {
+    // So many vertices are indistinguishable from the ellipse they lie on
+    CDR_DEBUG_MSG(("CDRPolygon::create - %u angles, drawing an ellipse instead\n", m_numAngles));
+    path.clear();
+    path.appendMoveTo(m_cx + m_rx, m_cy);
+    path.appendArcTo(m_rx, m_ry, 0.0, false, true, m_cx - m_rx, m_cy);
+    path.appendArcTo(m_rx, m_ry, 0.0, false, true, m_cx + m_rx, m_cy);
+    path.appendClosePath();
+    return;
+  }
+
+  /* The path is the outline between two neighbouring vertices. It is
+     repeated rotated by multiples of the angle between vertices, and each
+     copy is built directly from the transformed points of the base path. */
+  libcdr::CDRPath basePath;
+  basePath.swap(path);
+  path.reserve((basePath.size() + 1) * m_numAngles + 1);
+
+  const double step = 2*M_PI / (double)m_numAngles;
+  const double cosStep = cos(step);
+  const double sinStep = sin(step);
+  const double cosNext = cos(m_nextPoint*step);
+  const double sinNext = sin(m_nextPoint*step);
+  // cosine and sine of the current rotation
+  double c = 1.0;
+  double s = 0.0;
 
-  libcdr::CDRPath tmpPath(path);
-  double step = 2*M_PI / (double)m_numAngles;
+  path.appendPath(basePath, libcdr::CDRTransform(m_rx, 0.0, m_cx, 0.0, m_ry, m_cy));
   if (m_nextPoint && m_numAngles % m_nextPoint)
   {
-    libcdr::CDRTransform tmpTrafo(cos(m_nextPoint*step), sin(m_nextPoint*step), 0.0, -sin(m_nextPoint*step), cos(m_nextPoint*step), 0.0);
     for (unsigned i = 1; i < m_numAngles; ++i)
     {
-      tmpPath.transform(tmpTrafo);
-      path.appendPath(tmpPath);
+      rotate(c, s, cosNext, sinNext);
+      path.appendPath(basePath, libcdr::CDRTransform(m_rx*c, m_rx*s, m_cx, -m_ry*s, m_ry*c, m_cy));
     }
   }
   else
   {
-    libcdr::CDRTransform tmpTrafo(cos(m_nextPoint*step), sin(m_nextPoint*step), 0.0, -sin(m_nextPoint*step), cos(m_nextPoint*step), 0.0);
-    libcdr::CDRTransform tmpShift(cos(step), sin(step), 0.0, -sin(step), cos(step), 0.0);
     for (unsigned i = 0; i < m_nextPoint; ++i)
     {
       if (i)
       {
-        tmpPath.transform(tmpShift);
-        path.appendPath(tmpPath);
+        rotate(c, s, cosStep, sinStep);
+        path.appendPath(basePath, libcdr::CDRTransform(m_rx*c, m_rx*s, m_cx, -m_ry*s, m_ry*c, m_cy));
       }
       for (unsigned j=1; j < m_numAngles / m_nextPoint; ++j)
       {
-        tmpPath.transform(tmpTrafo);
-        path.appendPath(tmpPath);
+        rotate(c, s, cosNext, sinNext);
+        path.appendPath(basePath, libcdr::CDRTransform(m_rx*c, m_rx*s, m_cx, -m_ry*s, m_ry*c, m_cy));
       }
       path.appendClosePath();
     }
   }
   path.appendClosePath();
-  libcdr::CDRTransform trafo(m_rx, 0.0, m_cx, 0.0, m_ry, m_cy);
-  path.transform(trafo);
 }
 
 void libcdr::CDRSplineData::create(libcdr::CDRPath &path) const
@@ -83,5 +136,43 @@ void libcdr::CDRSplineData::create(libcdr::CDRPath &path) const
     path.appendSplineTo(tmpPoints);
 }
 
+void libcdr::sortWaldoRecords(std::vector<libcdr::WaldoRecordInfo> &records)
+{
+  std::stable_sort(records.begin(), records.end(), WaldoRecordLess());
+  std::vector<libcdr::WaldoRecordInfo>::iterator last = records.begin();
+  for (std::vector<libcdr::WaldoRecordInfo>::const_iterator iter = records.begin(); iter != records.end(); ++iter)
+  {
+    if (last != records.begin() && !WaldoRecordLess()(*(last - 1), *iter))
+      *(last - 1) = *iter;
+    else
+      *last++ = *iter;
+  }
+  records.erase(last, records.end());
+}
+
+std::pair<std::vector<libcdr::WaldoRecordInfo>::const_iterator, std::vector<libcdr::WaldoRecordInfo>::const_iterator>
+libcdr::getWaldoRecords(const std::vector<libcdr::WaldoRecordInfo> &records, unsigned char type)
+{
+  return std::make_pair(std::lower_bound(records.begin(), records.end(), libcdr::WaldoRecordInfo(type, 0, 0), WaldoRecordLess()),
+                        std::upper_bound(records.begin(), records.end(), libcdr::WaldoRecordInfo(type, (unsigned)-1, 0), WaldoRecordLess()));
+}
+
+const libcdr::WaldoRecordInfo *libcdr::findWaldoRecord(const std::vector<libcdr::WaldoRecordInfo> &records, unsigned char type, unsigned id)
+{
+  const libcdr::WaldoRecordInfo key(type, id, 0);
+  std::vector<libcdr::WaldoRecordInfo>::const_iterator iter = std::lower_bound(records.begin(), records.end(), key, WaldoRecordLess());
+  if (iter == records.end() || WaldoRecordLess()(key, *iter))
+    return nullptr;
+  return &*iter;
+}
+
+const libcdr::WaldoRecordType1 *libcdr::findWaldoRecord(const std::vector<libcdr::WaldoRecordType1> &records1, unsigned id)
+{
+  std::vector<libcdr::WaldoRecordType1>::const_iterator iter = std::lower_bound(records1.begin(), records1.end(), id, WaldoRecordLess());
+  if (iter == records1.end() || iter->m_id != id)
+    return nullptr;
+  return &*iter;
+}
+
 
 /* vim:set shiftwidth=2 softtabstop=2 expandtab: */
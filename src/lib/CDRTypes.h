@@ -10,6 +10,7 @@
 #ifndef __CDRTYPES_H__
 #define __CDRTYPES_H__
 
+#include <memory>
 #include <utility>
 #include <vector>
 #include <math.h>
@@ -124,15 +125,16 @@ struct CDRLineStyle
   double angle;
   CDRColor color;
   std::vector<unsigned> dashArray;
-  CDRPath startMarker;
-  CDRPath endMarker;
+  // arrow paths are shared between all line styles using them
+  std::shared_ptr<const CDRPath> startMarker;
+  std::shared_ptr<const CDRPath> endMarker;
   CDRLineStyle()
     : lineType((unsigned short)-1), capsType(0), joinType(0), lineWidth(0.0),
       stretch(0.0), angle(0.0), color(), dashArray(),
       startMarker(), endMarker() {}
   CDRLineStyle(unsigned short lt, unsigned short ct, unsigned short jt,
                double lw, double st, double a, const CDRColor &c, const std::vector<unsigned> &da,
-               const CDRPath &sm, const CDRPath &em)
+               const std::shared_ptr<const CDRPath> &sm, const std::shared_ptr<const CDRPath> &em)
     : lineType(lt), capsType(ct), joinType(jt), lineWidth(lw),
       stretch(st), angle(a), color(c), dashArray(da),
       startMarker(sm), endMarker(em) {}
@@ -196,13 +198,14 @@ struct CDRPolygon
 struct CDRImage
 {
   librevenge::RVNGBinaryData m_image;
+  unsigned m_id;
   double m_x1;
   double m_x2;
   double m_y1;
   double m_y2;
-  CDRImage() : m_image(), m_x1(0.0), m_x2(0.0), m_y1(0.0), m_y2(0.0) {}
-  CDRImage(const librevenge::RVNGBinaryData &image, double x1, double x2, double y1, double y2)
-    : m_image(image), m_x1(x1), m_x2(x2), m_y1(y1), m_y2(y2) {}
+  CDRImage() : m_image(), m_id(0), m_x1(0.0), m_x2(0.0), m_y1(0.0), m_y2(0.0) {}
+  CDRImage(const librevenge::RVNGBinaryData &image, unsigned id, double x1, double x2, double y1, double y2)
+    : m_image(image), m_id(id), m_x1(x1), m_x2(x2), m_y1(y1), m_y2(y2) {}
   double getMiddleX() const
   {
     return (m_x1 + m_x2) / 2.0;
@@ -303,6 +306,17 @@ struct WaldoRecordType1
   CDRTransform m_trafo;
 };
 
+/* The record tables of a WALDO file, sorted into one index by type and
+   id. Of records with the same type and id, the last one in the tables
+   is kept. */
+void sortWaldoRecords(std::vector<WaldoRecordInfo> &records);
+// All records of one type in the sorted index
+std::pair<std::vector<WaldoRecordInfo>::const_iterator, std::vector<WaldoRecordInfo>::const_iterator>
+getWaldoRecords(const std::vector<WaldoRecordInfo> &records, unsigned char type);
+const WaldoRecordInfo *findWaldoRecord(const std::vector<WaldoRecordInfo> &records, unsigned char type, unsigned id);
+// records1 is sorted by id
+const WaldoRecordType1 *findWaldoRecord(const std::vector<WaldoRecordType1> &records1, unsigned id);
+
 struct CDRCMYKColor
 {
   CDRCMYKColor(double cyan, double magenta, double yellow, double black)
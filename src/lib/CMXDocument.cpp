@@ -12,6 +12,7 @@
 #include "CMXParser.h"
 #include "CDRContentCollector.h"
 #include "CDRStylesCollector.h"
+#include "CDRTrace.h"
 #include "libcdr_utils.h"
 
 /**
@@ -57,25 +58,95 @@ CDRPaintInterface class implementation when needed. This is often commonly calle
 */
 CDRAPI bool libcdr::CMXDocument::parse(librevenge::RVNGInputStream *input, librevenge::RVNGDrawingInterface *painter)
 {
-  if (!input || !painter)
-    return false;
+  return parseWithOptions(input, painter, CDRParseOptions()) == CDR_PARSE_SUCCESS;
+}
+
+namespace libcdr
+{
+
+namespace
+{
 
+// Draws the document with the painter, or keeps its pages in the indices if they are given
+CDRParseStatus parseDocument(librevenge::RVNGInputStream *input, librevenge::RVNGDrawingInterface *painter,
+                             std::vector<std::unique_ptr<CDRPageIndex> > *pageIndices, const CDRParseOptionsImpl &options) try
+{
+  CDR_TRACE_SPAN(parseSpan, "CMXDocument::parse");
   input->seek(0, librevenge::RVNG_SEEK_SET);
   CDRParserState ps;
-  CDRStylesCollector stylesCollector(ps);
+  CDRStylesCollector stylesCollector(ps, options);
   CMXParserState parserState;
-  CMXParser stylesParser(&stylesCollector, parserState);
-  bool retVal = stylesParser.parseRecords(input);
+  CMXParser stylesParser(&stylesCollector, parserState, options);
+  bool retVal = false;
+  {
+    CDR_TRACE_SPAN(stylesSpan, "styles pass");
+    retVal = stylesParser.parseRecords(input);
+    CDR_TRACE_ARG(stylesSpan, "pages", ps.m_pages.size());
+  }
+  ps.forgetBmpKeys();
   if (ps.m_pages.empty())
     retVal = false;
   if (retVal)
   {
+    CDR_TRACE_SPAN(contentSpan, "content pass");
     input->seek(0, librevenge::RVNG_SEEK_SET);
-    CDRContentCollector contentCollector(ps, painter, false);
-    CMXParser contentParser(&contentCollector, parserState);
+    CDRContentCollector contentCollector(ps, painter, false, options, pageIndices);
+    CMXParser contentParser(&contentCollector, parserState, options);
+    contentParser.setProgressPhase(CDR_PARSE_PHASE_CONTENT);
     retVal = contentParser.parseRecords(input);
   }
-  return retVal;
+  return retVal ? CDR_PARSE_SUCCESS : CDR_PARSE_FAILURE;
+}
+catch (libcdr::ParseInterruptedException const &e)
+{
+  return e.getStatus();
+}
+
+} // anonymous namespace
+
+} // namespace libcdr
+
+/**
+Parses the input stream content like parse, using the given options to
+control what is extracted from the document. Unlike parse, it returns
+CDR_PARSE_SUCCESS, which is 0, if the parsing was successful.
+\param input The input stream
+\param painter A CDRPainterInterface implementation
+\param options Options controlling the parsing
+\return A value that indicates whether the parsing was successful, or why it was
+stopped early
+*/
+CDRAPI libcdr::CDRParseStatus libcdr::CMXDocument::parseWithOptions(librevenge::RVNGInputStream *input, librevenge::RVNGDrawingInterface *painter,
+                                                                    const CDRParseOptions &options)
+{
+  if (!input || !painter)
+    return CDR_PARSE_FAILURE;
+  return parseDocument(input, painter, nullptr, *options.m_impl);
+}
+
+/**
+Parses the input stream content and keeps the drawing of its pages in an
+index instead of passing it to a painter, so that parts of the pages can
+be drawn later through CDRDocumentIndex::renderViewport.
+Like the other parseWithOptions, it returns CDR_PARSE_SUCCESS, which is 0,
+if the parsing was successful.
+\param input The input stream
+\param index The index to fill; its previous content is dropped, and it is
+left empty if the parsing fails
+\param options Options controlling the parsing
+\return A value that indicates whether the parsing was successful, or why it was
+stopped early
+*/
+CDRAPI libcdr::CDRParseStatus libcdr::CMXDocument::parseWithOptions(librevenge::RVNGInputStream *input, CDRDocumentIndex &index,
+                                                                    const CDRParseOptions &options)
+{
+  index.m_impl->m_pages.clear();
+  if (!input)
+    return CDR_PARSE_FAILURE;
+  const CDRParseStatus status = parseDocument(input, nullptr, &index.m_impl->m_pages, *options.m_impl);
+  if (status != CDR_PARSE_SUCCESS)
+    index.m_impl->m_pages.clear();
+  return status;
 }
 
 /* vim:set shiftwidth=2 softtabstop=2 expandtab: */
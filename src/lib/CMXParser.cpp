@@ -70,8 +70,9 @@ void sanitizeNumRecords(
 
 }
 
-libcdr::CMXParser::CMXParser(libcdr::CDRCollector *collector, CMXParserState &parserState)
-  : CommonParser(collector),
+libcdr::CMXParser::CMXParser(libcdr::CDRCollector *collector, CMXParserState &parserState,
+                             const CDRParseOptionsImpl &options)
+  : CommonParser(collector, options),
     m_bigEndian(false), m_unit(0),
     m_scale(0.0), m_xmin(0.0), m_xmax(0.0), m_ymin(0.0), m_ymax(0.0),
     m_fillIndex(0), m_nextInstructionOffset(0), m_parserState(parserState),
@@ -87,6 +88,10 @@ bool libcdr::CMXParser::parseRecords(librevenge::RVNGInputStream *input, long si
   {
     return false;
   }
+  // embedded images are parsed as separate top-level record lists
+  const bool mainStream = !level && size < 0;
+  if (mainStream)
+    startProgress(input);
   m_collector->collectLevel(level);
   long endPosition = -1;
   if (size > 0)
@@ -96,6 +101,8 @@ bool libcdr::CMXParser::parseRecords(librevenge::RVNGInputStream *input, long si
     if (!parseRecord(input, level))
       return false;
   }
+  if (mainStream)
+    finishProgress();
   return true;
 }
 
@@ -107,6 +114,8 @@ bool libcdr::CMXParser::parseRecord(librevenge::RVNGInputStream *input, unsigned
   }
   try
   {
+    checkInterruption(m_options);
+    updateProgress(input->tell());
     m_collector->collectLevel(level);
     while (!input->isEnd() && readU8(input, m_bigEndian) == 0)
     {
@@ -139,12 +148,19 @@ bool libcdr::CMXParser::parseRecord(librevenge::RVNGInputStream *input, unsigned
         return false;
     }
     else
+    {
       readRecord(fourCC, length, input);
+      resetRecordArena();
+    }
 
     if (input->tell() < endPosition)
       input->seek(endPosition, librevenge::RVNG_SEEK_SET);
     return true;
   }
+  catch (const ParseInterruptedException &)
+  {
+    throw;
+  }
   catch (...)
   {
     return false;
@@ -186,6 +202,10 @@ void libcdr::CMXParser::parseImage(librevenge::RVNGInputStream *input)
     if (input->tell() < endPosition)
       input->seek(endPosition, librevenge::RVNG_SEEK_SET);
   }
+  catch (const ParseInterruptedException &)
+  {
+    throw;
+  }
   catch (...)
   {
   }
@@ -200,10 +220,12 @@ void libcdr::CMXParser::readRecord(unsigned fourCC, unsigned long length, librev
     readCMXHeader(input);
     return;
   case CDR_FOURCC_info:
-    readInfo(input);
+    if (!m_options.textOnly)
+      readInfo(input);
     break;
   case CDR_FOURCC_data:
-    readData(input);
+    if (!m_options.textOnly)
+      readData(input);
     break;
   default:
     break;
@@ -391,12 +413,12 @@ void libcdr::CMXParser::readIxmr(librevenge::RVNGInputStream *input)
     input->seek(*address, librevenge::RVNG_SEEK_SET);
     readRotl(input);
   }
-  if ((address = _getOffsetByType(CMX_BITMAP_INDEX_TABLE, offsets)))
+  if (!m_options.textOnly && (address = _getOffsetByType(CMX_BITMAP_INDEX_TABLE, offsets)))
   {
     input->seek(*address, librevenge::RVNG_SEEK_SET);
     readIxtl(input);
   }
-  if ((address = _getOffsetByType(CMX_EMBEDDED_FILE_INDEX_TABLE, offsets)))
+  if (!m_options.textOnly && (address = _getOffsetByType(CMX_EMBEDDED_FILE_INDEX_TABLE, offsets)))
   {
     input->seek(*address, librevenge::RVNG_SEEK_SET);
     readIxef(input);
@@ -419,6 +441,8 @@ void libcdr::CMXParser::readCommands(librevenge::RVNGInputStream *input, unsigne
   long endPosition = length + input->tell();
   while (!input->isEnd() && endPosition > input->tell())
   {
+    checkInterruption(m_options);
+    resetRecordArena();
     long startPosition = input->tell();
     int instructionSize = readS16(input, m_bigEndian);
     int minInstructionSize = 4;
@@ -435,6 +459,13 @@ void libcdr::CMXParser::readCommands(librevenge::RVNGInputStream *input, unsigne
     m_nextInstructionOffset = startPosition+instructionSize;
     short instructionCode = abs(readS16(input, m_bigEndian));
     CDR_DEBUG_MSG(("CMXParser::readCommands - instructionSize %i, instructionCode %i\n", instructionSize, instructionCode));
+    if (m_options.textOnly && (instructionCode == CMX_Command_PolyCurve || instructionCode == CMX_Command_Ellipse
+                               || instructionCode == CMX_Command_Rectangle || instructionCode == CMX_Command_DrawImage))
+    {
+      // geometry and images are not needed for text extraction
+      input->seek(m_nextInstructionOffset, librevenge::RVNG_SEEK_SET);
+      continue;
+    }
     switch (instructionCode)
     {
     case CMX_Command_BeginPage:
@@ -533,6 +564,7 @@ void libcdr::CMXParser::readBeginPage(librevenge::RVNGInputStream *input)
   }
   else
     return;
+  nextProgressPage();
   m_collector->collectPage(0);
   m_collector->collectFlags(flags, true);
   m_collector->collectPageSize(box.getWidth(), box.getHeight(), box.getMinX(), box.getMinY());
@@ -591,8 +623,8 @@ void libcdr::CMXParser::readPolyCurve(librevenge::RVNGInputStream *input)
 {
   m_collector->collectObject(1);
   unsigned long pointNum = 0;
-  std::vector<std::pair<double, double> > points;
-  std::vector<unsigned char> pointTypes;
+  CDRPointVector points(recordAllocator());
+  CDRPointTypeVector pointTypes(recordAllocator());
   if (m_precision == libcdr::PRECISION_32BIT)
   {
     unsigned char tagId = 0;
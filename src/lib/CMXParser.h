@@ -105,9 +105,11 @@ struct CMXParserState
 class CMXParser : protected CommonParser
 {
 public:
-  explicit CMXParser(CDRCollector *collector, CMXParserState &parserState);
+  explicit CMXParser(CDRCollector *collector, CMXParserState &parserState,
+                     const CDRParseOptionsImpl &options = CDRParseOptionsImpl());
   ~CMXParser() override;
   bool parseRecords(librevenge::RVNGInputStream *input, long size = -1, unsigned level = 0);
+  using CommonParser::setProgressPhase;
 
 private:
   CMXParser();
@@ -15,13 +15,80 @@
 #include "CDRPath.h"
 #include "libcdr_utils.h"
 
-libcdr::CommonParser::CommonParser(libcdr::CDRCollector *collector)
-  : m_collector(collector), m_precision(libcdr::PRECISION_UNKNOWN) {}
+libcdr::CommonParser::CommonParser(libcdr::CDRCollector *collector, const CDRParseOptionsImpl &options)
+  : m_collector(collector), m_precision(libcdr::PRECISION_UNKNOWN), m_options(options),
+    m_progress(), m_progressStarted(false), m_lastProgressReport(),
+    m_recordArena(options.useArena ? new CDRArena() : nullptr)
+{
+  m_progress.phase = CDR_PARSE_PHASE_STYLES;
+}
 
 libcdr::CommonParser::~CommonParser()
 {
 }
 
+libcdr::CDRArenaAllocator<char> libcdr::CommonParser::recordAllocator() const
+{
+  return CDRArenaAllocator<char>(m_recordArena.get());
+}
+
+void libcdr::CommonParser::resetRecordArena()
+{
+  if (m_recordArena)
+    m_recordArena->reset();
+}
+
+void libcdr::CommonParser::setProgressPhase(CDRParsePhase phase)
+{
+  m_progress.phase = phase;
+}
+
+void libcdr::CommonParser::startProgress(librevenge::RVNGInputStream *input)
+{
+  if (m_progressStarted || !m_options.progressCallback)
+    return;
+  m_progressStarted = true;
+  m_progress.page = 0;
+  m_progress.position = 0;
+  m_progress.length = getLength(input);
+  _reportProgress();
+}
+
+void libcdr::CommonParser::updateProgress(unsigned long position)
+{
+  if (!m_progressStarted)
+    return;
+  if (position > m_progress.length)
+    position = m_progress.length;
+  // nested streams can be decompressed copies; only ever move forward
+  if (position > m_progress.position)
+    m_progress.position = position;
+  if (std::chrono::steady_clock::now() - m_lastProgressReport >= m_options.progressInterval)
+    _reportProgress();
+}
+
+void libcdr::CommonParser::nextProgressPage()
+{
+  if (!m_progressStarted)
+    return;
+  ++m_progress.page;
+  _reportProgress();
+}
+
+void libcdr::CommonParser::finishProgress()
+{
+  if (!m_progressStarted)
+    return;
+  m_progress.position = m_progress.length;
+  _reportProgress();
+}
+
+void libcdr::CommonParser::_reportProgress()
+{
+  m_lastProgressReport = std::chrono::steady_clock::now();
+  m_options.progressCallback(m_progress);
+}
+
 double libcdr::CommonParser::readCoordinate(librevenge::RVNGInputStream *input, bool bigEndian)
 {
   if (m_precision == PRECISION_UNKNOWN)
@@ -67,19 +134,17 @@ double libcdr::CommonParser::readAngle(librevenge::RVNGInputStream *input, bool
   return M_PI * (double)readS32(input, bigEndian) / 180000000.0;
 }
 
-void libcdr::CommonParser::outputPath(const std::vector<std::pair<double, double> > &points,
-                                      const std::vector<unsigned char> &types)
+void libcdr::CommonParser::outputPath(const CDRPointVector &points, const CDRPointTypeVector &types)
 {
   CDRPath path;
   processPath(points, types, path);
   m_collector->collectPath(path);
 }
 
-void libcdr::CommonParser::processPath(const std::vector<std::pair<double, double> > &points,
-                                       const std::vector<unsigned char> &types, CDRPath &path)
+void libcdr::CommonParser::processPath(const CDRPointVector &points, const CDRPointTypeVector &types, CDRPath &path)
 {
   bool isClosedPath = false;
-  std::vector<std::pair<double, double> >tmpPoints;
+  CDRPointVector tmpPoints(recordAllocator());
   for (size_t k=0; k<points.size(); k++)
   {
     const unsigned char &type = types[k];
@@ -10,10 +10,15 @@
 #ifndef __COMMONPARSER_H__
 #define __COMMONPARSER_H__
 
+#include <chrono>
+#include <memory>
 #include <utility>
 #include <vector>
 
 #include <librevenge-stream/librevenge-stream.h>
+#include "CDRParseOptionsImpl.h"
+
+#include "CDRArena.h"
 
 namespace libcdr
 {
@@ -27,9 +32,11 @@ enum CoordinatePrecision
 class CommonParser
 {
 public:
-  CommonParser(CDRCollector *collector);
+  CommonParser(CDRCollector *collector, const CDRParseOptionsImpl &options = CDRParseOptionsImpl());
   virtual ~CommonParser();
 
+  void setProgressPhase(CDRParsePhase phase);
+
 private:
   CommonParser();
   CommonParser(const CommonParser &);
@@ -48,11 +55,29 @@ protected:
   void readBmpPattern(unsigned &width, unsigned &height, std::vector<unsigned char> &pattern,
                       unsigned length, librevenge::RVNGInputStream *input, bool bigEndian = false);
 
-  void processPath(const std::vector<std::pair<double, double> > &points, const std::vector<unsigned char> &types, CDRPath &path);
-  void outputPath(const std::vector<std::pair<double, double> > &points, const std::vector<unsigned char> &types);
+  void processPath(const CDRPointVector &points, const CDRPointTypeVector &types, CDRPath &path);
+  void outputPath(const CDRPointVector &points, const CDRPointTypeVector &types);
+
+  // allocator for temporary data that does not outlive the current record
+  CDRArenaAllocator<char> recordAllocator() const;
+  void resetRecordArena();
+
+  void startProgress(librevenge::RVNGInputStream *input);
+  void updateProgress(unsigned long position);
+  void nextProgressPage();
+  void finishProgress();
 
   CDRCollector *m_collector;
   CoordinatePrecision m_precision;
+  const CDRParseOptionsImpl m_options;
+
+private:
+  void _reportProgress();
+
+  CDRParseProgress m_progress;
+  bool m_progressStarted;
+  std::chrono::steady_clock::time_point m_lastProgressReport;
+  std::unique_ptr<CDRArena> m_recordArena;
 };
 } // namespace libcdr
 
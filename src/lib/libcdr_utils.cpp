@@ -322,7 +322,7 @@ void libcdr::writeU32(librevenge::RVNGBinaryData &buffer, const int value)
   buffer.append((unsigned char)((value >> 24) & 0xFF));
 }
 
-void libcdr::appendCharacters(librevenge::RVNGString &text, std::vector<unsigned char> characters, unsigned short charset)
+void libcdr::appendCharacters(librevenge::RVNGString &text, const std::vector<unsigned char> &characters, unsigned short charset)
 {
   if (characters.empty())
     return;
@@ -439,7 +439,7 @@ void libcdr::appendCharacters(librevenge::RVNGString &text, std::vector<unsigned
   }
 }
 
-void libcdr::appendCharacters(librevenge::RVNGString &text, std::vector<unsigned char> characters)
+void libcdr::appendCharacters(librevenge::RVNGString &text, const std::vector<unsigned char> &characters)
 {
   if (characters.empty())
     return;
@@ -462,7 +462,7 @@ void libcdr::appendCharacters(librevenge::RVNGString &text, std::vector<unsigned
     ucnv_close(conv);
 }
 
-void libcdr::appendUTF8Characters(librevenge::RVNGString &text, std::vector<unsigned char> characters)
+void libcdr::appendUTF8Characters(librevenge::RVNGString &text, const std::vector<unsigned char> &characters)
 {
   if (characters.empty())
     return;
@@ -471,6 +471,15 @@ void libcdr::appendUTF8Characters(librevenge::RVNGString &text, std::vector<unsi
     text.append((char)*iter);
 }
 
+void libcdr::checkInterruption(const CDRParseOptionsImpl &options)
+{
+  if (options.cancelFlag && options.cancelFlag->load(std::memory_order_relaxed))
+    throw ParseInterruptedException(CDR_PARSE_CANCELLED);
+  if (options.deadline != std::chrono::steady_clock::time_point::max()
+      && std::chrono::steady_clock::now() >= options.deadline)
+    throw ParseInterruptedException(CDR_PARSE_DEADLINE_EXCEEDED);
+}
+
 #ifdef DEBUG
 
 void libcdr::debugPrint(const char *const format, ...)
@@ -23,6 +23,8 @@
 #include <librevenge-stream/librevenge-stream.h>
 #include <librevenge/librevenge.h>
 
+#include "CDRParseOptionsImpl.h"
+
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
@@ -90,9 +92,12 @@ int cdr_round(double d);
 
 void writeU16(librevenge::RVNGBinaryData &buffer, const int value);
 void writeU32(librevenge::RVNGBinaryData &buffer, const int value);
-void appendCharacters(librevenge::RVNGString &text, std::vector<unsigned char> characters, unsigned short charset);
-void appendCharacters(librevenge::RVNGString &text, std::vector<unsigned char> characters);
-void appendUTF8Characters(librevenge::RVNGString &text, std::vector<unsigned char> characters);
+void appendCharacters(librevenge::RVNGString &text, const std::vector<unsigned char> &characters, unsigned short charset);
+void appendCharacters(librevenge::RVNGString &text, const std::vector<unsigned char> &characters);
+void appendUTF8Characters(librevenge::RVNGString &text, const std::vector<unsigned char> &characters);
+
+/* Throws ParseInterruptedException if the parse was cancelled or its deadline passed */
+void checkInterruption(const CDRParseOptionsImpl &options);
 
 #ifdef DEBUG
 const char *toFourCC(unsigned value, bool bigEndian=false);
@@ -114,6 +119,18 @@ class EncodingException
 {
 };
 
+class ParseInterruptedException
+{
+public:
+  explicit ParseInterruptedException(CDRParseStatus status) : m_status(status) {}
+  CDRParseStatus getStatus() const
+  {
+    return m_status;
+  }
+private:
+  CDRParseStatus m_status;
+};
+
 } // namespace libcdr
 
 #endif // __LIBCDR_UTILS_H__
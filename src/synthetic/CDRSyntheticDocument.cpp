@@ -0,0 +1,915 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libcdr project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "CDRSyntheticDocument.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <zlib.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+namespace
+{
+
+const double PAGE_WIDTH = 8.5;
+const double PAGE_HEIGHT = 11.0;
+// 32-bit coordinates of both formats are in 1/254000 inch
+const double COORDINATE_SCALE = 254000.0;
+
+const unsigned FILL_COUNT = 16;
+const unsigned OUTLINE_COUNT = 4;
+// Number of objects that share one chain of nested groups
+const unsigned GROUP_SIZE = 8;
+
+const char *const WORDS[] =
+{
+  "lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing", "elit",
+  "sed", "do", "eiusmod", "tempor", "incididunt", "ut", "labore", "et", "dolore"
+};
+
+class Random
+{
+public:
+  explicit Random(unsigned seed) : m_state(seed ? seed : 0x9e3779b9) {}
+
+  uint32_t next()
+  {
+    m_state ^= m_state << 13;
+    m_state ^= m_state >> 17;
+    m_state ^= m_state << 5;
+    return m_state;
+  }
+
+  unsigned next(unsigned limit)
+  {
+    return limit ? unsigned(next() % limit) : 0;
+  }
+
+  double next(double min, double max)
+  {
+    return min + (max - min) * (next() / 4294967296.0);
+  }
+
+private:
+  uint32_t m_state;
+};
+
+class ByteWriter
+{
+public:
+  explicit ByteWriter(std::vector<unsigned char> &buffer) : m_buffer(buffer) {}
+
+  size_t tell() const
+  {
+    return m_buffer.size();
+  }
+
+  void writeU8(unsigned char value)
+  {
+    m_buffer.push_back(value);
+  }
+
+  void writeU16(unsigned value)
+  {
+    writeU8((unsigned char)(value & 0xff));
+    writeU8((unsigned char)((value >> 8) & 0xff));
+  }
+
+  void writeU32(unsigned value)
+  {
+    writeU16(value & 0xffff);
+    writeU16(value >> 16);
+  }
+
+  void writeS32(int value)
+  {
+    writeU32((unsigned)value);
+  }
+
+  void writeU64(uint64_t value)
+  {
+    writeU32((unsigned)(value & 0xffffffff));
+    writeU32((unsigned)(value >> 32));
+  }
+
+  void writeDouble(double value)
+  {
+    uint64_t bits = 0;
+    memcpy(&bits, &value, sizeof(bits));
+    writeU64(bits);
+  }
+
+  void writeCoordinate(double value)
+  {
+    writeS32((int)std::lround(value * COORDINATE_SCALE));
+  }
+
+  void writeFourCC(const char *id)
+  {
+    m_buffer.insert(m_buffer.end(), id, id + 4);
+  }
+
+  void writeString(const char *str, size_t size)
+  {
+    const size_t length = strlen(str);
+    m_buffer.insert(m_buffer.end(), str, str + (length < size ? length : size));
+    if (length < size)
+      writeZeros(size - length);
+  }
+
+  void writeBytes(const std::vector<unsigned char> &data)
+  {
+    m_buffer.insert(m_buffer.end(), data.begin(), data.end());
+  }
+
+  void writeZeros(size_t count)
+  {
+    m_buffer.insert(m_buffer.end(), count, 0);
+  }
+
+  void patchU16(size_t offset, unsigned value)
+  {
+    m_buffer[offset] = (unsigned char)(value & 0xff);
+    m_buffer[offset + 1] = (unsigned char)((value >> 8) & 0xff);
+  }
+
+  void patchU32(size_t offset, unsigned value)
+  {
+    patchU16(offset, value & 0xffff);
+    patchU16(offset + 2, value >> 16);
+  }
+
+private:
+  ByteWriter(const ByteWriter &);
+  ByteWriter &operator=(const ByteWriter &);
+
+  std::vector<unsigned char> &m_buffer;
+};
+
+/* Writes nested RIFF chunks. Inside a CDR cmpr list, the length field of
+   a chunk is an index into a separately stored table of lengths; that
+   table is collected when blockLengths is set. */
+class RiffWriter : public ByteWriter
+{
+public:
+  explicit RiffWriter(std::vector<unsigned char> &buffer, std::vector<unsigned> *blockLengths = nullptr)
+    : ByteWriter(buffer), m_starts(), m_blockLengths(blockLengths) {}
+
+  void beginChunk(const char *id)
+  {
+    writeFourCC(id);
+    m_starts.push_back(tell());
+    writeU32(0);
+  }
+
+  void beginList(const char *listType, const char *id = "LIST")
+  {
+    beginChunk(id);
+    writeFourCC(listType);
+  }
+
+  void endChunk()
+  {
+    const size_t start = m_starts.back();
+    m_starts.pop_back();
+    const auto length = unsigned(tell() - start - 4);
+    if (m_blockLengths)
+    {
+      patchU32(start, unsigned(m_blockLengths->size()));
+      m_blockLengths->push_back(length);
+    }
+    else
+      patchU32(start, length);
+    if (length & 1)
+      writeU8(0);
+  }
+
+private:
+  RiffWriter(const RiffWriter &);
+  RiffWriter &operator=(const RiffWriter &);
+
+  std::vector<size_t> m_starts;
+  std::vector<unsigned> *m_blockLengths;
+};
+
+/* The loda and trfd records: a header, the arguments, and tables of the
+   argument offsets and types. The types are stored in reverse order. */
+class ArgumentRecord
+{
+public:
+  explicit ArgumentRecord(unsigned chunkType)
+    : m_data(), m_writer(m_data), m_offsets(), m_types(), m_chunkType(chunkType)
+  {
+    m_writer.writeZeros(20);
+  }
+
+  ByteWriter &addArgument(unsigned type)
+  {
+    m_offsets.push_back(unsigned(m_writer.tell()));
+    m_types.push_back(type);
+    return m_writer;
+  }
+
+  void writeTo(RiffWriter &output, const char *id)
+  {
+    const auto startOfArgs = unsigned(m_writer.tell());
+    for (unsigned offset : m_offsets)
+      m_writer.writeU32(offset);
+    const auto startOfArgTypes = unsigned(m_writer.tell());
+    for (auto it = m_types.rbegin(); it != m_types.rend(); ++it)
+      m_writer.writeU32(*it);
+    m_writer.patchU32(0, unsigned(m_data.size()));
+    m_writer.patchU32(4, unsigned(m_offsets.size()));
+    m_writer.patchU32(8, startOfArgs);
+    m_writer.patchU32(12, startOfArgTypes);
+    m_writer.patchU32(16, m_chunkType);
+
+    output.beginChunk(id);
+    output.writeBytes(m_data);
+    output.endChunk();
+  }
+
+private:
+  ArgumentRecord(const ArgumentRecord &);
+  ArgumentRecord &operator=(const ArgumentRecord &);
+
+  std::vector<unsigned char> m_data;
+  ByteWriter m_writer;
+  std::vector<unsigned> m_offsets;
+  std::vector<unsigned> m_types;
+  unsigned m_chunkType;
+};
+
+enum CDRShape
+{
+  SHAPE_RECTANGLE,
+  SHAPE_ELLIPSE,
+  SHAPE_CURVE,
+  SHAPE_TEXT,
+  SHAPE_BITMAP
+};
+
+struct CurveNode
+{
+  double x;
+  double y;
+  unsigned char type;
+};
+
+/* A closed blob around the origin, mixing straight segments and cubic
+   Bezier segments. Uses the node types of both formats: 0x00 move,
+   0x40 line, 0xc0 control point, 0x80 curve end, 0x08 closes the path. */
+void generateCurve(std::vector<CurveNode> &nodes, Random &random, unsigned count, double radius)
+{
+  nodes.clear();
+  if (count < 2)
+    count = 2;
+  nodes.reserve(count);
+  for (unsigned i = 0; i < count; ++i)
+  {
+    const double angle = 2.0 * M_PI * i / count;
+    const double r = radius * random.next(0.5, 1.0);
+    CurveNode node = { r * cos(angle), r * sin(angle), 0x40 };
+    nodes.push_back(node);
+  }
+  nodes[0].type = 0x00;
+  unsigned i = 1;
+  while (i < count)
+  {
+    if (count - i >= 3 && random.next(2))
+    {
+      nodes[i].type = 0xc0;
+      nodes[i + 1].type = 0xc0;
+      nodes[i + 2].type = 0x80;
+      i += 3;
+    }
+    else
+      nodes[i++].type = 0x40;
+  }
+  nodes.back().type |= 0x08;
+}
+
+unsigned randomColor(Random &random)
+{
+  return random.next() & 0xffffff;
+}
+
+void appendText(std::vector<unsigned char> &text, Random &random, unsigned count)
+{
+  const unsigned wordCount = sizeof(WORDS) / sizeof(WORDS[0]);
+  while (text.size() < count)
+  {
+    if (!text.empty())
+      text.push_back(' ');
+    const char *word = WORDS[random.next(wordCount)];
+    text.insert(text.end(), word, word + strlen(word));
+  }
+  text.resize(count);
+}
+
+std::vector<unsigned char> compress(const std::vector<unsigned char> &data)
+{
+  uLongf size = compressBound(uLong(data.size()));
+  std::vector<unsigned char> output(size);
+  if (compress2(&output[0], &size, data.empty() ? nullptr : &data[0], uLong(data.size()), Z_DEFAULT_COMPRESSION) != Z_OK)
+    return std::vector<unsigned char>();
+  output.resize(size);
+  return output;
+}
+
+// CDR
+
+void writeCDRColor(ByteWriter &output, unsigned rgb)
+{
+  output.writeU16(5); // RGB
+  output.writeU16(0);
+  output.writeZeros(4);
+  output.writeU32(rgb);
+}
+
+void writeFild(RiffWriter &output, unsigned id, unsigned rgb)
+{
+  output.beginChunk("fild");
+  output.writeU32(id);
+  output.writeZeros(8);
+  output.writeU16(1); // solid
+  output.writeZeros(13);
+  writeCDRColor(output, rgb);
+  output.writeZeros(8);
+  output.endChunk();
+}
+
+void writeOutl(RiffWriter &output, unsigned id, double width, unsigned rgb)
+{
+  output.beginChunk("outl");
+  output.writeU32(id);
+  output.writeU32(1); // the first property block is the line description
+  output.writeU32(0);
+  output.writeU16(2); // solid line
+  output.writeU16(0);
+  output.writeU16(0);
+  output.writeCoordinate(width);
+  output.writeU16(100);
+  output.writeZeros(2);
+  output.writeS32(0);
+  output.writeZeros(46);
+  writeCDRColor(output, rgb);
+  output.writeZeros(16);
+  output.writeU16(0); // no dashes
+  output.writeZeros(22);
+  output.writeU32(0); // no start marker
+  output.writeU32(0); // no end marker
+  output.endChunk();
+}
+
+void writeBmp(RiffWriter &output, Random &random, unsigned id, const cdrsynthetic::SyntheticDocumentParams &params)
+{
+  unsigned colorModel = 1;
+  unsigned bpp = 24;
+  switch (params.bitmapModel)
+  {
+  case cdrsynthetic::SYNTHETIC_CMYK:
+    colorModel = 2;
+    bpp = 32;
+    break;
+  case cdrsynthetic::SYNTHETIC_GRAYSCALE:
+    colorModel = 5;
+    bpp = 8;
+    break;
+  case cdrsynthetic::SYNTHETIC_BLACK_AND_WHITE:
+    colorModel = 6;
+    bpp = 1;
+    break;
+  case cdrsynthetic::SYNTHETIC_PALETTE:
+    bpp = 8;
+    break;
+  case cdrsynthetic::SYNTHETIC_RGB:
+  default:
+    break;
+  }
+  const unsigned width = params.bitmapWidth ? params.bitmapWidth : 1;
+  const unsigned height = params.bitmapHeight ? params.bitmapHeight : 1;
+  const unsigned long stride = ((unsigned long)width * bpp + 31) / 32 * 4;
+
+  output.beginChunk("bmp ");
+  output.writeU32(id);
+  output.writeZeros(50);
+  output.writeU32(colorModel);
+  output.writeZeros(4);
+  output.writeU32(width);
+  output.writeU32(height);
+  output.writeZeros(4);
+  output.writeU32(bpp);
+  output.writeZeros(4);
+  output.writeU32(unsigned(stride * height));
+  output.writeZeros(32);
+  if (params.bitmapModel == cdrsynthetic::SYNTHETIC_PALETTE)
+  {
+    output.writeZeros(2);
+    output.writeU16(256);
+    for (unsigned i = 0; i < 256; ++i)
+    {
+      const unsigned color = randomColor(random);
+      output.writeU8((unsigned char)(color & 0xff));
+      output.writeU8((unsigned char)((color >> 8) & 0xff));
+      output.writeU8((unsigned char)((color >> 16) & 0xff));
+    }
+  }
+  // a gradient with some noise, so that neither the content nor the
+  // compressibility are trivial
+  for (unsigned j = 0; j < height; ++j)
+  {
+    unsigned long written = 0;
+    if (bpp == 1)
+    {
+      for (; written < (width + 7) / 8; ++written)
+        output.writeU8((unsigned char)random.next());
+    }
+    else
+    {
+      const unsigned channels = bpp / 8;
+      for (unsigned i = 0; i < width; ++i)
+      {
+        for (unsigned c = 0; c < channels; ++c)
+          output.writeU8((unsigned char)((i * 255 / width + j * 255 / height * c + random.next(16)) & 0xff));
+        written += channels;
+      }
+    }
+    output.writeZeros(stride - written);
+  }
+  output.endChunk();
+}
+
+void writeTxsm(RiffWriter &output, Random &random, unsigned textId, unsigned characters)
+{
+  std::vector<unsigned char> text;
+  appendText(text, random, characters);
+
+  output.beginChunk("txsm");
+  output.writeU32(1); // frame flag
+  output.writeZeros(0x20);
+  output.writeU32(1); // frames
+  output.writeU32(textId);
+  output.writeZeros(48);
+  output.writeU32(0); // not on a path
+  output.writeU32(1); // paragraphs
+  output.writeU32(0); // paragraph style
+  output.writeZeros(2);
+  output.writeU32(0); // no character style overrides
+  output.writeU32(unsigned(text.size()));
+  for (size_t i = 0; i < text.size(); ++i)
+    output.writeU64(0); // single byte character in the default style
+  output.writeU32(unsigned(text.size()));
+  output.writeBytes(text);
+  output.writeU8(0);
+  output.endChunk();
+}
+
+void writeTrfd(RiffWriter &output, double x, double y, double angle)
+{
+  ArgumentRecord trfd(0);
+  ByteWriter &arg = trfd.addArgument(0);
+  arg.writeZeros(8);
+  arg.writeU16(0x08); // matrix
+  arg.writeZeros(6);
+  arg.writeDouble(cos(angle));
+  arg.writeDouble(-sin(angle));
+  arg.writeDouble(x * COORDINATE_SCALE);
+  arg.writeDouble(sin(angle));
+  arg.writeDouble(cos(angle));
+  arg.writeDouble(y * COORDINATE_SCALE);
+  trfd.writeTo(output, "trfd");
+}
+
+void writeCDRPoints(ByteWriter &output, const std::vector<CurveNode> &nodes)
+{
+  output.writeU16(unsigned(nodes.size()));
+  output.writeZeros(2);
+  for (const auto &node : nodes)
+  {
+    output.writeCoordinate(node.x);
+    output.writeCoordinate(node.y);
+  }
+  for (const auto &node : nodes)
+    output.writeU8(node.type);
+}
+
+void writeCDRObject(RiffWriter &output, Random &random, CDRShape shape, unsigned id,
+                    const cdrsynthetic::SyntheticDocumentParams &params, std::vector<CurveNode> &nodes)
+{
+  const double size = random.next(0.1, 1.0);
+  output.beginList("obj ");
+  if (shape == SHAPE_TEXT)
+  {
+    output.beginChunk("spnd");
+    output.writeU32(id);
+    output.endChunk();
+  }
+
+  unsigned chunkType = 0;
+  switch (shape)
+  {
+  case SHAPE_RECTANGLE:
+    chunkType = 0x01;
+    break;
+  case SHAPE_ELLIPSE:
+    chunkType = 0x02;
+    break;
+  case SHAPE_CURVE:
+    chunkType = 0x03;
+    break;
+  case SHAPE_TEXT:
+    chunkType = 0x04;
+    break;
+  case SHAPE_BITMAP:
+    chunkType = 0x05;
+    break;
+  }
+  ArgumentRecord loda(chunkType);
+  ByteWriter &coords = loda.addArgument(0x1e);
+  switch (shape)
+  {
+  case SHAPE_RECTANGLE:
+    coords.writeCoordinate(size);
+    coords.writeCoordinate(size * random.next(0.5, 1.5));
+    for (unsigned i = 0; i < 4; ++i)
+      coords.writeCoordinate(random.next(2) ? size / 10.0 : 0.0);
+    break;
+  case SHAPE_ELLIPSE:
+    coords.writeCoordinate(size);
+    coords.writeCoordinate(size * random.next(0.5, 1.5));
+    coords.writeS32(0);
+    coords.writeS32(0);
+    coords.writeU32(0);
+    break;
+  case SHAPE_CURVE:
+    generateCurve(nodes, random, params.pointsPerPath, size);
+    writeCDRPoints(coords, nodes);
+    break;
+  case SHAPE_TEXT:
+    coords.writeCoordinate(0.0);
+    coords.writeCoordinate(0.0);
+    break;
+  case SHAPE_BITMAP:
+  {
+    const double height = size * params.bitmapHeight / (params.bitmapWidth ? params.bitmapWidth : 1);
+    coords.writeCoordinate(0.0);
+    coords.writeCoordinate(0.0);
+    coords.writeCoordinate(size);
+    coords.writeCoordinate(height);
+    coords.writeZeros(32);
+    coords.writeU32(id);
+    coords.writeZeros(20);
+    nodes.clear();
+    const CurveNode corners[] =
+    {
+      { 0.0, 0.0, 0x00 }, { 0.0, height, 0x40 }, { size, height, 0x40 }, { size, 0.0, 0x40 }, { 0.0, 0.0, 0x48 }
+    };
+    nodes.assign(corners, corners + 5);
+    writeCDRPoints(coords, nodes);
+    break;
+  }
+  }
+  if (shape != SHAPE_BITMAP)
+    loda.addArgument(0x14).writeU32(random.next(FILL_COUNT) + 1);
+  if (shape != SHAPE_TEXT && shape != SHAPE_BITMAP)
+    loda.addArgument(0x0a).writeU32(random.next(OUTLINE_COUNT) + 1);
+  loda.writeTo(output, "loda");
+
+  writeTrfd(output, random.next(-PAGE_WIDTH / 2.0, PAGE_WIDTH / 2.0), random.next(-PAGE_HEIGHT / 2.0, PAGE_HEIGHT / 2.0),
+            random.next(4) ? 0.0 : random.next(0.0, M_PI));
+  output.endChunk();
+}
+
+void writeCDRBody(RiffWriter &output, Random &random, const cdrsynthetic::SyntheticDocumentParams &params, unsigned long &objects)
+{
+  output.beginList("doc ");
+  output.beginChunk("mcfg");
+  output.writeZeros(12);
+  output.writeCoordinate(PAGE_WIDTH);
+  output.writeCoordinate(PAGE_HEIGHT);
+  output.writeZeros(64);
+  output.endChunk();
+  for (unsigned i = 1; i <= FILL_COUNT; ++i)
+    writeFild(output, i, randomColor(random));
+  for (unsigned i = 1; i <= OUTLINE_COUNT; ++i)
+    writeOutl(output, i, 0.005 * i, randomColor(random));
+  for (unsigned i = 1; i <= params.bitmaps; ++i)
+    writeBmp(output, random, i, params);
+  for (unsigned i = 1; i <= params.pages * params.textsPerPage; ++i)
+    writeTxsm(output, random, i, params.charactersPerText);
+  output.endChunk();
+
+  std::vector<CDRShape> shapes;
+  std::vector<CurveNode> nodes;
+  for (unsigned page = 0; page < params.pages; ++page)
+  {
+    shapes.clear();
+    for (unsigned i = 0; i < params.objectsPerPage; ++i)
+      shapes.push_back(CDRShape(random.next(3)));
+    shapes.insert(shapes.end(), params.textsPerPage, SHAPE_TEXT);
+    shapes.insert(shapes.end(), params.bitmaps, SHAPE_BITMAP);
+
+    output.beginList("page");
+    output.beginList("layr");
+    unsigned text = page * params.textsPerPage;
+    unsigned bitmap = 0;
+    for (size_t i = 0; i < shapes.size(); ++i)
+    {
+      if (params.nestingDepth && i % GROUP_SIZE == 0)
+      {
+        if (i)
+        {
+          for (unsigned level = 0; level < params.nestingDepth; ++level)
+            output.endChunk();
+        }
+        for (unsigned level = 0; level < params.nestingDepth; ++level)
+          output.beginList("grp ");
+      }
+      unsigned id = 0;
+      if (shapes[i] == SHAPE_TEXT)
+        id = ++text;
+      else if (shapes[i] == SHAPE_BITMAP)
+        id = ++bitmap;
+      writeCDRObject(output, random, shapes[i], id, params, nodes);
+    }
+    if (params.nestingDepth && !shapes.empty())
+    {
+      for (unsigned level = 0; level < params.nestingDepth; ++level)
+        output.endChunk();
+    }
+    output.endChunk();
+    output.endChunk();
+    objects += shapes.size();
+  }
+}
+
+// CMX
+
+const unsigned char CMX_END_TAG = 0xff;
+const unsigned CMX_COLOR_COUNT = 16;
+
+class CMXTag
+{
+public:
+  CMXTag(ByteWriter &output, unsigned char id) : m_output(output), m_start(output.tell())
+  {
+    m_output.writeU8(id);
+    m_output.writeU16(0);
+  }
+
+  ~CMXTag()
+  {
+    m_output.patchU16(m_start + 1, unsigned(m_output.tell() - m_start));
+  }
+
+private:
+  CMXTag(const CMXTag &);
+  CMXTag &operator=(const CMXTag &);
+
+  ByteWriter &m_output;
+  size_t m_start;
+};
+
+void writeCMXCommand(ByteWriter &output, int code, const std::vector<unsigned char> &arguments)
+{
+  const size_t size = arguments.size() + 4;
+  if (size <= 0x7fff)
+    output.writeU16(unsigned(size));
+  else
+  {
+    output.writeU16(0xffff);
+    output.writeU32(unsigned(size + 4));
+  }
+  output.writeU16(unsigned(code));
+  output.writeBytes(arguments);
+}
+
+void writeCMXBBox(ByteWriter &output, double x0, double y0, double x1, double y1)
+{
+  output.writeCoordinate(x0);
+  output.writeCoordinate(y0);
+  output.writeCoordinate(x1);
+  output.writeCoordinate(y1);
+}
+
+void writeCMXPage(RiffWriter &output, Random &random, unsigned page, const cdrsynthetic::SyntheticDocumentParams &params,
+                  std::vector<CurveNode> &nodes)
+{
+  std::vector<unsigned char> arguments;
+  ByteWriter args(arguments);
+
+  output.beginChunk("page");
+  {
+    CMXTag tag(args, 1);
+    args.writeU16(page + 1);
+    args.writeU32(0); // flags
+    writeCMXBBox(args, -PAGE_WIDTH / 2.0, -PAGE_HEIGHT / 2.0, PAGE_WIDTH / 2.0, PAGE_HEIGHT / 2.0);
+  }
+  args.writeU8(CMX_END_TAG);
+  writeCMXCommand(output, 9, arguments); // BeginPage
+  arguments.clear();
+  args.writeU8(CMX_END_TAG);
+  writeCMXCommand(output, 11, arguments); // BeginLayer
+
+  for (unsigned i = 0; i < params.objectsPerPage; ++i)
+  {
+    if (params.nestingDepth && i % GROUP_SIZE == 0)
+    {
+      if (i)
+      {
+        for (unsigned level = 0; level < params.nestingDepth; ++level)
+          writeCMXCommand(output, 14, std::vector<unsigned char>()); // EndGroup
+      }
+      arguments.clear();
+      {
+        CMXTag tag(args, 1);
+        writeCMXBBox(args, -PAGE_WIDTH / 2.0, -PAGE_HEIGHT / 2.0, PAGE_WIDTH / 2.0, PAGE_HEIGHT / 2.0);
+        args.writeU16(1);
+        args.writeU32(GROUP_SIZE);
+        args.writeU32(0);
+      }
+      args.writeU8(CMX_END_TAG);
+      for (unsigned level = 0; level < params.nestingDepth; ++level)
+        writeCMXCommand(output, 13, arguments); // BeginGroup
+    }
+
+    const double x = random.next(-PAGE_WIDTH / 2.0, PAGE_WIDTH / 2.0);
+    const double y = random.next(-PAGE_HEIGHT / 2.0, PAGE_HEIGHT / 2.0);
+    generateCurve(nodes, random, params.pointsPerPath, random.next(0.1, 1.0));
+    arguments.clear();
+    {
+      CMXTag attributes(args, 1);
+      args.writeU8(0x01); // fill only
+      {
+        CMXTag fill(args, 1);
+        args.writeU16(1); // uniform
+        {
+          CMXTag uniform(args, 1);
+          args.writeU16(random.next(CMX_COLOR_COUNT) + 1);
+          args.writeU16(0);
+        }
+        args.writeU8(CMX_END_TAG);
+      }
+      args.writeU8(CMX_END_TAG);
+    }
+    {
+      CMXTag points(args, 2);
+      args.writeU16(unsigned(nodes.size()));
+      for (const auto &node : nodes)
+      {
+        args.writeCoordinate(x + node.x);
+        args.writeCoordinate(y + node.y);
+      }
+      for (const auto &node : nodes)
+        args.writeU8(node.type);
+    }
+    args.writeU8(CMX_END_TAG);
+    writeCMXCommand(output, 67, arguments); // PolyCurve
+  }
+  if (params.nestingDepth && params.objectsPerPage)
+  {
+    for (unsigned level = 0; level < params.nestingDepth; ++level)
+      writeCMXCommand(output, 14, std::vector<unsigned char>()); // EndGroup
+  }
+  writeCMXCommand(output, 12, std::vector<unsigned char>()); // EndLayer
+  writeCMXCommand(output, 10, std::vector<unsigned char>()); // EndPage
+  output.endChunk();
+}
+
+} // anonymous namespace
+
+cdrsynthetic::SyntheticDocument cdrsynthetic::generateCDR(const SyntheticDocumentParams &params)
+{
+  SyntheticDocument document;
+  Random random(params.seed);
+  RiffWriter output(document.data);
+  output.beginList("CDRD", "RIFF");
+  if (!params.compressed)
+    writeCDRBody(output, random, params, document.objects);
+  else
+  {
+    std::vector<unsigned char> body;
+    std::vector<unsigned> blockLengths;
+    {
+      RiffWriter bodyOutput(body, &blockLengths);
+      writeCDRBody(bodyOutput, random, params, document.objects);
+    }
+    std::vector<unsigned char> blocks;
+    {
+      ByteWriter blocksOutput(blocks);
+      for (unsigned length : blockLengths)
+        blocksOutput.writeU32(length);
+    }
+    const std::vector<unsigned char> compressedBody = compress(body);
+    const std::vector<unsigned char> compressedBlocks = compress(blocks);
+
+    output.beginList("cmpr");
+    output.writeU32(unsigned(compressedBody.size()));
+    output.writeU32(unsigned(body.size()));
+    output.writeU32(unsigned(compressedBlocks.size()));
+    output.writeU32(unsigned(blocks.size()));
+    output.writeFourCC("CPng");
+    output.writeU16(1);
+    output.writeU16(4);
+    output.writeBytes(compressedBody);
+    output.writeBytes(compressedBlocks);
+    output.endChunk();
+  }
+  output.endChunk();
+  return document;
+}
+
+cdrsynthetic::SyntheticDocument cdrsynthetic::generateCMX(const SyntheticDocumentParams &params)
+{
+  SyntheticDocument document;
+  Random random(params.seed);
+  RiffWriter output(document.data);
+  output.beginList("CMX1", "RIFF");
+
+  output.beginChunk("cont");
+  output.writeString("Corel Metafile Exchange Image", 32);
+  output.writeString("Windows 3.1", 16);
+  output.writeString("2", 4); // little endian
+  output.writeString("4", 2); // 32-bit coordinates
+  output.writeString("2", 4);
+  output.writeString("0", 4);
+  output.writeU16(35); // inches
+  output.writeDouble(1.0 / COORDINATE_SCALE);
+  output.writeZeros(12);
+  const size_t indexOffsetPosition = output.tell();
+  output.writeU32(0);
+  output.writeU32(0xffffffff); // no info section
+  output.writeU32(0xffffffff); // no thumbnail
+  writeCMXBBox(output, -PAGE_WIDTH / 2.0, -PAGE_HEIGHT / 2.0, PAGE_WIDTH / 2.0, PAGE_HEIGHT / 2.0);
+  output.endChunk();
+
+  std::vector<unsigned> pageOffsets;
+  std::vector<CurveNode> nodes;
+  for (unsigned page = 0; page < params.pages; ++page)
+  {
+    pageOffsets.push_back(unsigned(output.tell()));
+    writeCMXPage(output, random, page, params, nodes);
+    document.objects += params.objectsPerPage;
+  }
+
+  const auto colorsOffset = unsigned(output.tell());
+  output.beginChunk("rclr");
+  output.writeU16(CMX_COLOR_COUNT);
+  for (unsigned i = 0; i < CMX_COLOR_COUNT; ++i)
+  {
+    const unsigned color = randomColor(random);
+    {
+      CMXTag base(output, 1);
+      output.writeU8(5); // RGB
+      output.writeU8(0);
+    }
+    {
+      CMXTag description(output, 2);
+      output.writeU8((unsigned char)((color >> 16) & 0xff));
+      output.writeU8((unsigned char)((color >> 8) & 0xff));
+      output.writeU8((unsigned char)(color & 0xff));
+    }
+    output.writeU8(CMX_END_TAG);
+  }
+  output.endChunk();
+
+  const auto pagesOffset = unsigned(output.tell());
+  output.beginChunk("ixpg");
+  output.writeU16(unsigned(pageOffsets.size()));
+  for (unsigned offset : pageOffsets)
+  {
+    output.writeU16(16);
+    output.writeU32(offset);
+    output.writeU32(0);
+    output.writeU32(0);
+    output.writeU32(0);
+  }
+  output.endChunk();
+
+  output.patchU32(indexOffsetPosition, unsigned(output.tell()));
+  output.beginChunk("ixmr");
+  output.writeU16(1);
+  output.writeU16(6);
+  output.writeU16(2);
+  output.writeU16(21); // color descriptions
+  output.writeU32(colorsOffset);
+  output.writeU16(2); // page index
+  output.writeU32(pagesOffset);
+  output.endChunk();
+
+  output.endChunk();
+  return document;
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,87 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libcdr project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef __CDRSYNTHETICDOCUMENT_H__
+#define __CDRSYNTHETICDOCUMENT_H__
+
+#include <vector>
+
+namespace cdrsynthetic
+{
+
+enum SyntheticColorModel
+{
+  SYNTHETIC_RGB = 0,
+  SYNTHETIC_CMYK,
+  SYNTHETIC_GRAYSCALE,
+  SYNTHETIC_BLACK_AND_WHITE,
+  SYNTHETIC_PALETTE
+};
+
+/**
+Shape of a generated document. The same parameters always produce the
+same bytes.
+*/
+struct SyntheticDocumentParams
+{
+  SyntheticDocumentParams()
+    : pages(4)
+    , objectsPerPage(200)
+    , pointsPerPath(32)
+    , bitmaps(0)
+    , bitmapWidth(256)
+    , bitmapHeight(256)
+    , bitmapModel(SYNTHETIC_RGB)
+    , textsPerPage(0)
+    , charactersPerText(64)
+    , nestingDepth(0)
+    , compressed(false)
+    , seed(1) {}
+
+  unsigned pages;
+  /** Number of shapes (rectangles, ellipses and curves) on every page. */
+  unsigned objectsPerPage;
+  /** Number of nodes of every curve. */
+  unsigned pointsPerPath;
+  /** Number of distinct embedded bitmaps. Every bitmap is placed once on
+      every page. Bitmaps are only written to CDR documents. */
+  unsigned bitmaps;
+  unsigned bitmapWidth;
+  unsigned bitmapHeight;
+  SyntheticColorModel bitmapModel;
+  /** Number of artistic text objects on every page. Text is only written
+      to CDR documents. */
+  unsigned textsPerPage;
+  unsigned charactersPerText;
+  /** Number of groups every object is nested in. */
+  unsigned nestingDepth;
+  /** Put the whole CDR document body into a zlib compressed cmpr list. */
+  bool compressed;
+  unsigned seed;
+};
+
+struct SyntheticDocument
+{
+  SyntheticDocument() : data(), objects(0) {}
+
+  std::vector<unsigned char> data;
+  /** Number of drawable objects in the document. */
+  unsigned long objects;
+};
+
+/** Writes a CorelDRAW X3 document. */
+SyntheticDocument generateCDR(const SyntheticDocumentParams &params);
+
+/** Writes a 32-bit little endian CMX document. */
+SyntheticDocument generateCMX(const SyntheticDocumentParams &params);
+
+} // namespace cdrsynthetic
+
+#endif // __CDRSYNTHETICDOCUMENT_H__
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
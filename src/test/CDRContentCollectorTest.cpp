@@ -0,0 +1,305 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libcdr project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <atomic>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <librevenge/librevenge.h>
+#include <librevenge-generators/librevenge-generators.h>
+
+#include "CDRContentCollector.h"
+#include "CDRSyntheticDocument.h"
+#include "libcdr_utils.h"
+
+namespace test
+{
+
+using libcdr::CDRContentCollector;
+using libcdr::CDRParseOptionsImpl;
+using libcdr::CDRParserState;
+
+namespace
+{
+
+librevenge::RVNGBinaryData makeVectorPattern()
+{
+  cdrsynthetic::SyntheticDocumentParams params;
+  params.pages = 1;
+  params.objectsPerPage = 10;
+  const cdrsynthetic::SyntheticDocument document = cdrsynthetic::generateCMX(params);
+  return librevenge::RVNGBinaryData(&document.data[0], document.data.size());
+}
+
+// Records the fill of every style and the geometry of every path drawn on it
+class OutputRecorder : public librevenge::RVNGDummyDrawingGenerator
+{
+public:
+  OutputRecorder() : m_fills(), m_fillColors(), m_styleIds(), m_geometryIds(), m_geometryTransforms(), m_points() {}
+
+  void setStyle(const librevenge::RVNGPropertyList &propList) override
+  {
+    const librevenge::RVNGProperty *fill = propList["draw:fill"];
+    m_fills.push_back(fill ? fill->getStr().cstr() : "");
+    const librevenge::RVNGProperty *fillColor = propList["draw:fill-color"];
+    m_fillColors.push_back(fillColor ? fillColor->getStr().cstr() : "");
+    const librevenge::RVNGProperty *styleId = propList["libcdr:style-id"];
+    m_styleIds.push_back(styleId ? styleId->getInt() : 0);
+  }
+
+  void drawPath(const librevenge::RVNGPropertyList &propList) override
+  {
+    const librevenge::RVNGProperty *geometryId = propList["libcdr:geometry-id"];
+    m_geometryIds.push_back(geometryId ? geometryId->getInt() : 0);
+    const librevenge::RVNGProperty *geometryTransform = propList["libcdr:geometry-transform"];
+    m_geometryTransforms.push_back(geometryTransform ? geometryTransform->getStr().cstr() : "");
+    m_points.push_back(std::vector<double>());
+    const librevenge::RVNGPropertyListVector *d = propList.child("svg:d");
+    for (unsigned i = 0; d && i != d->count(); ++i)
+    {
+      const librevenge::RVNGPropertyList &element = (*d)[i];
+      if (element["svg:x"] && element["svg:y"])
+      {
+        m_points.back().push_back(element["svg:x"]->getDouble());
+        m_points.back().push_back(element["svg:y"]->getDouble());
+      }
+    }
+  }
+
+  std::vector<std::string> m_fills;
+  std::vector<std::string> m_fillColors;
+  std::vector<int> m_styleIds;
+  std::vector<int> m_geometryIds;
+  std::vector<std::string> m_geometryTransforms;
+  std::vector<std::vector<double> > m_points;
+};
+
+void collectSquare(CDRContentCollector &collector, unsigned fillId,
+                   const libcdr::CDRTransforms &transforms = libcdr::CDRTransforms())
+{
+  libcdr::CDRPath path;
+  path.appendMoveTo(0.0, 0.0);
+  path.appendLineTo(1.0, 0.0);
+  path.appendLineTo(1.0, 1.0);
+  path.appendLineTo(0.0, 1.0);
+  path.appendClosePath();
+  collector.collectObject(1);
+  collector.collectTransform(transforms, false);
+  collector.collectFillStyleId(fillId);
+  collector.collectPath(path);
+  collector.collectLevel(1);
+}
+
+// Maps the points of a path back by the inverse of its geometry transform
+std::vector<double> sharedGeometry(const std::string &transform, const std::vector<double> &points)
+{
+  double m[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+  CPPUNIT_ASSERT_EQUAL(6, sscanf(transform.c_str(), "matrix(%lf %lf %lf %lf %lf %lf)", &m[0], &m[1], &m[2], &m[3], &m[4], &m[5]));
+  const double det = m[0] * m[3] - m[1] * m[2];
+  std::vector<double> geometry;
+  for (size_t i = 0; i + 1 < points.size(); i += 2)
+  {
+    const double x = points[i] - m[4];
+    const double y = points[i + 1] - m[5];
+    geometry.push_back((m[3] * x - m[2] * y) / det);
+    geometry.push_back((m[0] * y - m[1] * x) / det);
+  }
+  return geometry;
+}
+
+}
+
+class CDRContentCollectorTest : public CPPUNIT_NS::TestFixture
+{
+public:
+  virtual void setUp();
+  virtual void tearDown();
+
+private:
+  CPPUNIT_TEST_SUITE(CDRContentCollectorTest);
+  CPPUNIT_TEST(testVectorPattern);
+  CPPUNIT_TEST(testVectorPatternCancelled);
+  CPPUNIT_TEST(testVectorPatternFill);
+  CPPUNIT_TEST(testInstanceGeometry);
+  CPPUNIT_TEST(testShareStyles);
+  CPPUNIT_TEST_SUITE_END();
+
+private:
+  void testVectorPattern();
+  void testVectorPatternCancelled();
+  void testVectorPatternFill();
+  void testInstanceGeometry();
+  void testShareStyles();
+};
+
+void CDRContentCollectorTest::setUp()
+{
+}
+
+void CDRContentCollectorTest::tearDown()
+{
+}
+
+void CDRContentCollectorTest::testVectorPattern()
+{
+  CDRParserState ps;
+  ps.m_pages.push_back(libcdr::CDRPage(8.5, 11.0, -4.25, -5.5));
+  librevenge::RVNGDummyDrawingGenerator painter;
+  CDRContentCollector collector(ps, &painter);
+
+  collector.collectVectorPattern(1, makeVectorPattern());
+  CPPUNIT_ASSERT(ps.m_vects.find(1) != ps.m_vects.end());
+}
+
+void CDRContentCollectorTest::testVectorPatternCancelled()
+{
+  CDRParserState ps;
+  ps.m_pages.push_back(libcdr::CDRPage(8.5, 11.0, -4.25, -5.5));
+  librevenge::RVNGDummyDrawingGenerator painter;
+  const std::atomic<bool> cancel(true);
+  CDRParseOptionsImpl options;
+  options.cancelFlag = &cancel;
+  CDRContentCollector collector(ps, &painter, true, options);
+
+  libcdr::CDRParseStatus status = libcdr::CDR_PARSE_SUCCESS;
+  try
+  {
+    collector.collectVectorPattern(1, makeVectorPattern());
+  }
+  catch (const libcdr::ParseInterruptedException &e)
+  {
+    status = e.getStatus();
+  }
+  CPPUNIT_ASSERT_EQUAL(libcdr::CDR_PARSE_CANCELLED, status);
+  CPPUNIT_ASSERT(ps.m_vects.find(1) == ps.m_vects.end());
+}
+
+void CDRContentCollectorTest::testVectorPatternFill()
+{
+  CDRParserState ps;
+  ps.m_pages.push_back(libcdr::CDRPage(8.5, 11.0, -4.25, -5.5));
+  libcdr::CDRFillStyle fillStyle;
+  fillStyle.fillType = 10;
+  fillStyle.imageFill.id = 1;
+  ps.m_fillStyles[5] = fillStyle;
+  OutputRecorder painter;
+  {
+    CDRContentCollector collector(ps, &painter, false);
+    // the pattern is only known for the second object
+    collectSquare(collector, 5);
+    collector.collectVectorPattern(1, makeVectorPattern());
+    collectSquare(collector, 5);
+  }
+  CPPUNIT_ASSERT_EQUAL(size_t(2), painter.m_fills.size());
+  CPPUNIT_ASSERT_EQUAL(std::string("none"), painter.m_fills[0]);
+  CPPUNIT_ASSERT_EQUAL(std::string("bitmap"), painter.m_fills[1]);
+}
+
+void CDRContentCollectorTest::testInstanceGeometry()
+{
+  CDRParserState ps;
+  ps.m_pages.push_back(libcdr::CDRPage(8.5, 11.0, -4.25, -5.5));
+  CDRParseOptionsImpl options;
+  options.instanceGeometry = true;
+  // CDR objects are drawn in reverse order, and every copy must be usable as the definition
+  for (int reverseOrder = 0; reverseOrder != 2; ++reverseOrder)
+  {
+    OutputRecorder painter;
+    {
+      CDRContentCollector collector(ps, &painter, bool(reverseOrder), options);
+      collectSquare(collector, 0);
+      libcdr::CDRTransforms rotated;
+      rotated.append(0.0, -2.0, 1.0, 2.0, 0.0, 3.0);
+      collectSquare(collector, 0, rotated);
+    }
+    CPPUNIT_ASSERT_EQUAL(size_t(2), painter.m_geometryIds.size());
+    CPPUNIT_ASSERT(painter.m_geometryIds[0] != 0);
+    CPPUNIT_ASSERT_EQUAL(painter.m_geometryIds[0], painter.m_geometryIds[1]);
+    CPPUNIT_ASSERT(painter.m_points[0] != painter.m_points[1]);
+    const double square[] = { 0.0, 0.0, 1.0, 0.0, 1.0, 1.0, 0.0, 1.0 };
+    for (size_t i = 0; i != 2; ++i)
+    {
+      const std::vector<double> geometry = sharedGeometry(painter.m_geometryTransforms[i], painter.m_points[i]);
+      CPPUNIT_ASSERT_EQUAL(size_t(8), geometry.size());
+      for (size_t j = 0; j != geometry.size(); ++j)
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(square[j], geometry[j], 1e-9);
+    }
+  }
+
+  // simplified copies are not tagged as instances of each other
+  options.detailTolerance = 0.01;
+  {
+    OutputRecorder painter;
+    {
+      CDRContentCollector collector(ps, &painter, false, options);
+      collectSquare(collector, 0);
+      collectSquare(collector, 0);
+    }
+    CPPUNIT_ASSERT_EQUAL(size_t(2), painter.m_geometryIds.size());
+    CPPUNIT_ASSERT_EQUAL(0, painter.m_geometryIds[0]);
+    CPPUNIT_ASSERT_EQUAL(0, painter.m_geometryIds[1]);
+  }
+}
+
+void CDRContentCollectorTest::testShareStyles()
+{
+  CDRParserState ps;
+  ps.m_pages.push_back(libcdr::CDRPage(8.5, 11.0, -4.25, -5.5));
+  libcdr::CDRFillStyle red;
+  red.fillType = 1;
+  red.color1 = libcdr::CDRColor(5, 0xff0000);
+  ps.m_fillStyles[5] = red;
+  libcdr::CDRFillStyle blue;
+  blue.fillType = 1;
+  blue.color1 = libcdr::CDRColor(5, 0x0000ff);
+  ps.m_fillStyles[6] = blue;
+  const unsigned fills[] = { 5, 5, 6, 5 };
+
+  CDRParseOptionsImpl options;
+  options.shareStyles = true;
+  OutputRecorder painter;
+  {
+    CDRContentCollector collector(ps, &painter, false, options);
+    for (unsigned fill : fills)
+      collectSquare(collector, fill);
+  }
+  // the style is not set again for the second red square
+  CPPUNIT_ASSERT_EQUAL(size_t(4), painter.m_geometryIds.size());
+  CPPUNIT_ASSERT_EQUAL(size_t(3), painter.m_styleIds.size());
+  CPPUNIT_ASSERT(painter.m_styleIds[0] != 0);
+  CPPUNIT_ASSERT(painter.m_styleIds[1] != 0);
+  CPPUNIT_ASSERT(painter.m_styleIds[0] != painter.m_styleIds[1]);
+  CPPUNIT_ASSERT_EQUAL(painter.m_styleIds[0], painter.m_styleIds[2]);
+  CPPUNIT_ASSERT(painter.m_fillColors[0] != painter.m_fillColors[1]);
+  CPPUNIT_ASSERT_EQUAL(painter.m_fillColors[0], painter.m_fillColors[2]);
+
+  // without sharing, every object sets its own untagged style
+  OutputRecorder unshared;
+  {
+    CDRContentCollector collector(ps, &unshared, false);
+    for (unsigned fill : fills)
+      collectSquare(collector, fill);
+  }
+  CPPUNIT_ASSERT_EQUAL(size_t(4), unshared.m_styleIds.size());
+  for (size_t i = 0; i != unshared.m_styleIds.size(); ++i)
+  {
+    CPPUNIT_ASSERT_EQUAL(0, unshared.m_styleIds[i]);
+    CPPUNIT_ASSERT_EQUAL(unshared.m_fillColors[i], painter.m_fillColors[i < 2 ? 0 : i - 1]);
+  }
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CDRContentCollectorTest);
+
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
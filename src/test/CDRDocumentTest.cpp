@@ -0,0 +1,301 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libcdr project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <librevenge/librevenge.h>
+#include <librevenge-generators/librevenge-generators.h>
+#include <librevenge-stream/librevenge-stream.h>
+#include <libcdr/libcdr.h>
+
+#include "CDRSyntheticDocument.h"
+
+namespace test
+{
+
+namespace
+{
+
+std::string parseText(const std::vector<unsigned char> &data, const libcdr::CDRParseOptions &options)
+{
+  librevenge::RVNGStringStream input(&data[0], (unsigned)data.size());
+  librevenge::RVNGStringVector pages;
+  librevenge::RVNGTextDrawingGenerator painter(pages);
+  CPPUNIT_ASSERT(libcdr::CDRDocument::isSupported(&input));
+  CPPUNIT_ASSERT_EQUAL(libcdr::CDR_PARSE_SUCCESS, libcdr::CDRDocument::parseWithOptions(&input, &painter, options));
+  std::string text;
+  for (unsigned i = 0; i != pages.size(); ++i)
+    text += pages[i].cstr();
+  return text;
+}
+
+// Records the drawing calls of every page, with the path of every object
+class PageRecorder : public librevenge::RVNGDummyDrawingGenerator
+{
+public:
+  PageRecorder() : m_pages(), m_width(0.0), m_height(0.0) {}
+
+  void startPage(const librevenge::RVNGPropertyList &propList) override
+  {
+    m_pages.push_back(std::vector<std::string>());
+    if (propList["svg:width"] && propList["svg:height"])
+    {
+      m_width = propList["svg:width"]->getDouble();
+      m_height = propList["svg:height"]->getDouble();
+    }
+  }
+
+  void setStyle(const librevenge::RVNGPropertyList &) override
+  {
+    record("style");
+  }
+
+  void openGroup(const librevenge::RVNGPropertyList &) override
+  {
+    record("group");
+  }
+
+  void closeGroup() override
+  {
+    record("/group");
+  }
+
+  void drawPath(const librevenge::RVNGPropertyList &propList) override
+  {
+    std::string path("path");
+    const librevenge::RVNGPropertyListVector *d = propList.child("svg:d");
+    for (unsigned i = 0; d && i != d->count(); ++i)
+    {
+      const librevenge::RVNGPropertyList &element = (*d)[i];
+      if (element["svg:x"] && element["svg:y"])
+      {
+        path += " ";
+        path += element["svg:x"]->getStr().cstr();
+        path += ",";
+        path += element["svg:y"]->getStr().cstr();
+      }
+    }
+    record(path);
+  }
+
+  void drawGraphicObject(const librevenge::RVNGPropertyList &) override
+  {
+    record("image");
+  }
+
+  void startTextObject(const librevenge::RVNGPropertyList &) override
+  {
+    record("text");
+  }
+
+  std::vector<std::vector<std::string> > m_pages;
+  double m_width;
+  double m_height;
+
+private:
+  void record(const std::string &call)
+  {
+    if (!m_pages.empty())
+      m_pages.back().push_back(call);
+  }
+};
+
+
+// Appends every progress report to a list
+class ProgressRecorder
+{
+public:
+  explicit ProgressRecorder(std::vector<libcdr::CDRParseProgress> &reports) : m_reports(reports) {}
+
+  void operator()(const libcdr::CDRParseProgress &progress) const
+  {
+    m_reports.push_back(progress);
+  }
+
+private:
+  std::vector<libcdr::CDRParseProgress> &m_reports;
+};
+
+std::vector<libcdr::CDRParseProgress> parseWithProgress(const cdrsynthetic::SyntheticDocument &document, bool cmx,
+                                                       std::chrono::steady_clock::duration interval)
+{
+  std::vector<libcdr::CDRParseProgress> reports;
+  libcdr::CDRParseOptions options;
+  options.setProgressCallback(ProgressRecorder(reports));
+  options.setProgressInterval(interval);
+  librevenge::RVNGStringStream input(&document.data[0], (unsigned)document.data.size());
+  librevenge::RVNGDummyDrawingGenerator painter;
+  if (cmx)
+    CPPUNIT_ASSERT_EQUAL(libcdr::CDR_PARSE_SUCCESS, libcdr::CMXDocument::parseWithOptions(&input, &painter, options));
+  else
+    CPPUNIT_ASSERT_EQUAL(libcdr::CDR_PARSE_SUCCESS, libcdr::CDRDocument::parseWithOptions(&input, &painter, options));
+  return reports;
+}
+
+// Both passes report, and neither the position nor the page ever goes back within a pass
+void checkProgress(const std::vector<libcdr::CDRParseProgress> &reports, unsigned pages)
+{
+  CPPUNIT_ASSERT(!reports.empty());
+  CPPUNIT_ASSERT_EQUAL(libcdr::CDR_PARSE_PHASE_STYLES, reports.front().phase);
+  CPPUNIT_ASSERT_EQUAL(libcdr::CDR_PARSE_PHASE_CONTENT, reports.back().phase);
+  for (size_t i = 0; i != reports.size(); ++i)
+  {
+    CPPUNIT_ASSERT(reports[i].length > 0);
+    CPPUNIT_ASSERT(reports[i].position <= reports[i].length);
+    CPPUNIT_ASSERT(reports[i].page <= pages);
+    const bool lastOfPhase = i + 1 == reports.size() || reports[i + 1].phase != reports[i].phase;
+    if (lastOfPhase)
+    {
+      CPPUNIT_ASSERT_EQUAL(reports[i].length, reports[i].position);
+      CPPUNIT_ASSERT_EQUAL(pages, reports[i].page);
+    }
+    if (i + 1 == reports.size())
+      break;
+    if (lastOfPhase)
+    {
+      CPPUNIT_ASSERT(reports[i + 1].phase > reports[i].phase);
+      continue;
+    }
+    CPPUNIT_ASSERT(reports[i + 1].position >= reports[i].position);
+    CPPUNIT_ASSERT(reports[i + 1].page >= reports[i].page);
+  }
+}
+}
+
+class CDRDocumentTest : public CPPUNIT_NS::TestFixture
+{
+public:
+  virtual void setUp();
+  virtual void tearDown();
+
+private:
+  CPPUNIT_TEST_SUITE(CDRDocumentTest);
+  CPPUNIT_TEST(testTextOnly);
+  CPPUNIT_TEST(testDocumentIndex);
+  CPPUNIT_TEST(testProgress);
+  CPPUNIT_TEST_SUITE_END();
+
+private:
+  void testTextOnly();
+  void testDocumentIndex();
+  void testProgress();
+};
+
+void CDRDocumentTest::setUp()
+{
+}
+
+void CDRDocumentTest::tearDown()
+{
+}
+
+void CDRDocumentTest::testTextOnly()
+{
+  cdrsynthetic::SyntheticDocumentParams params;
+  params.pages = 2;
+  params.objectsPerPage = 20;
+  params.textsPerPage = 3;
+  params.charactersPerText = 40;
+  params.nestingDepth = 1;
+  for (unsigned compressed = 0; compressed < 2; ++compressed)
+  {
+    params.compressed = compressed != 0;
+    const cdrsynthetic::SyntheticDocument document = cdrsynthetic::generateCDR(params);
+
+    libcdr::CDRParseOptions options;
+    const std::string text = parseText(document.data, options);
+    CPPUNIT_ASSERT_MESSAGE("the document contains no text", text.size() >= params.pages * params.textsPerPage * params.charactersPerText);
+    options.setTextOnly(true);
+    CPPUNIT_ASSERT_EQUAL(text, parseText(document.data, options));
+  }
+}
+
+void CDRDocumentTest::testDocumentIndex()
+{
+  cdrsynthetic::SyntheticDocumentParams params;
+  params.pages = 2;
+  params.objectsPerPage = 400;
+  params.pointsPerPath = 8;
+  params.nestingDepth = 1;
+  const cdrsynthetic::SyntheticDocument document = cdrsynthetic::generateCDR(params);
+
+  PageRecorder parsed;
+  {
+    librevenge::RVNGStringStream input(&document.data[0], (unsigned)document.data.size());
+    CPPUNIT_ASSERT_EQUAL(libcdr::CDR_PARSE_SUCCESS, libcdr::CDRDocument::parseWithOptions(&input, &parsed, libcdr::CDRParseOptions()));
+  }
+  libcdr::CDRDocumentIndex index;
+  {
+    librevenge::RVNGStringStream input(&document.data[0], (unsigned)document.data.size());
+    CPPUNIT_ASSERT_EQUAL(libcdr::CDR_PARSE_SUCCESS, libcdr::CDRDocument::parseWithOptions(&input, index, libcdr::CDRParseOptions()));
+  }
+  CPPUNIT_ASSERT_EQUAL((unsigned)parsed.m_pages.size(), index.getPageCount());
+  CPPUNIT_ASSERT(!index.renderViewport(index.getPageCount(), libcdr::CDRViewport(), &parsed));
+
+  for (unsigned page = 0; page != index.getPageCount(); ++page)
+  {
+    // the whole page
+    PageRecorder rendered;
+    CPPUNIT_ASSERT(index.renderViewport(page, libcdr::CDRViewport(), &rendered));
+    CPPUNIT_ASSERT_EQUAL(size_t(1), rendered.m_pages.size());
+    CPPUNIT_ASSERT(rendered.m_pages[0] == parsed.m_pages[page]);
+
+    // every tile draws the same as a parse with that viewport
+    const double width = rendered.m_width / 3;
+    const double height = rendered.m_height / 3;
+    for (unsigned tile = 0; tile != 9; ++tile)
+    {
+      const libcdr::CDRViewport viewport((tile % 3) * width, (tile / 3) * height, width, height);
+      libcdr::CDRParseOptions options;
+      options.setViewport(viewport);
+      PageRecorder culled;
+      librevenge::RVNGStringStream input(&document.data[0], (unsigned)document.data.size());
+      CPPUNIT_ASSERT_EQUAL(libcdr::CDR_PARSE_SUCCESS, libcdr::CDRDocument::parseWithOptions(&input, &culled, options));
+      PageRecorder tiled;
+      CPPUNIT_ASSERT(index.renderViewport(page, viewport, &tiled));
+      CPPUNIT_ASSERT(tiled.m_pages[0] == culled.m_pages[page]);
+      CPPUNIT_ASSERT(tiled.m_pages[0].size() < rendered.m_pages[0].size());
+    }
+  }
+}
+
+void CDRDocumentTest::testProgress()
+{
+  cdrsynthetic::SyntheticDocumentParams params;
+  params.pages = 3;
+  params.objectsPerPage = 50;
+  params.nestingDepth = 1;
+  for (unsigned format = 0; format != 3; ++format)
+  {
+    const bool cmx = format == 2;
+    params.compressed = format == 1;
+    const cdrsynthetic::SyntheticDocument document = cmx ? cdrsynthetic::generateCMX(params) : cdrsynthetic::generateCDR(params);
+
+    // without a limit, the position is reported as it moves
+    const std::vector<libcdr::CDRParseProgress> all = parseWithProgress(document, cmx, std::chrono::steady_clock::duration::zero());
+    checkProgress(all, params.pages);
+
+    // with a long interval, only the start, the pages and the end of each pass are reported
+    const std::vector<libcdr::CDRParseProgress> limited = parseWithProgress(document, cmx, std::chrono::hours(1));
+    checkProgress(limited, params.pages);
+    CPPUNIT_ASSERT(limited.size() <= 2 * (params.pages + 2));
+    CPPUNIT_ASSERT(limited.size() < all.size());
+  }
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CDRDocumentTest);
+
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,214 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libcdr project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <librevenge-stream/librevenge-stream.h>
+
+#include "CDRExternalStreams.h"
+
+namespace test
+{
+
+using libcdr::CDRExternalStreams;
+
+namespace
+{
+
+// A container that counts how often each of its streams is extracted
+class CountingContainer : public librevenge::RVNGStringStream
+{
+public:
+  CountingContainer() : librevenge::RVNGStringStream(reinterpret_cast<const unsigned char *>("PK"), 2), m_extracted() {}
+
+  librevenge::RVNGInputStream *getSubStreamByName(const char *name) override
+  {
+    const std::string streamName(name);
+    ++m_extracted[streamName];
+    return new librevenge::RVNGStringStream(reinterpret_cast<const unsigned char *>(streamName.c_str()), (unsigned)streamName.size());
+  }
+
+  std::map<std::string, unsigned> m_extracted;
+};
+
+// A container that records the order of extraction and holds the first one until it is released
+class BlockingContainer : public librevenge::RVNGStringStream
+{
+public:
+  BlockingContainer()
+    : librevenge::RVNGStringStream(reinterpret_cast<const unsigned char *>("PK"), 2), m_order(), m_mutex(), m_changed(), m_released(false) {}
+
+  librevenge::RVNGInputStream *getSubStreamByName(const char *name) override
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_order.push_back(name);
+    m_changed.notify_all();
+    while (!m_released)
+      m_changed.wait(lock);
+    return new librevenge::RVNGStringStream(reinterpret_cast<const unsigned char *>(name), 1);
+  }
+
+  void waitForFirst()
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_order.empty())
+      m_changed.wait(lock);
+  }
+
+  void release()
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_released = true;
+    m_changed.notify_all();
+  }
+
+  std::vector<std::string> m_order;
+
+private:
+  std::mutex m_mutex;
+  std::condition_variable m_changed;
+  bool m_released;
+};
+
+void getStream(CDRExternalStreams *streams, unsigned index)
+{
+  streams->get(index);
+}
+
+std::vector<std::string> makeNames()
+{
+  std::vector<std::string> names;
+  names.push_back("shapes");
+  names.push_back("bitmap");
+  names.push_back("unused");
+  return names;
+}
+
+}
+
+class CDRExternalStreamsTest : public CPPUNIT_NS::TestFixture
+{
+public:
+  virtual void setUp();
+  virtual void tearDown();
+
+private:
+  CPPUNIT_TEST_SUITE(CDRExternalStreamsTest);
+  CPPUNIT_TEST(testGet);
+  CPPUNIT_TEST(testReleaseTransient);
+  CPPUNIT_TEST(testPrefetch);
+  CPPUNIT_TEST(testPrefetchPriority);
+  CPPUNIT_TEST_SUITE_END();
+
+private:
+  void testGet();
+  void testReleaseTransient();
+  void testPrefetch();
+  void testPrefetchPriority();
+};
+
+void CDRExternalStreamsTest::setUp()
+{
+}
+
+void CDRExternalStreamsTest::tearDown()
+{
+}
+
+void CDRExternalStreamsTest::testGet()
+{
+  CountingContainer container;
+  CDRExternalStreams streams(&container, makeNames());
+  CPPUNIT_ASSERT_EQUAL(size_t(3), streams.size());
+  CPPUNIT_ASSERT(!streams.get(3));
+
+  librevenge::RVNGInputStream *stream = streams.get(0);
+  CPPUNIT_ASSERT(stream);
+  CPPUNIT_ASSERT(stream == streams.get(0));
+  CPPUNIT_ASSERT(stream == streams.get(0, true));
+  CPPUNIT_ASSERT_EQUAL(1u, container.m_extracted["content/data/shapes"]);
+  CPPUNIT_ASSERT(container.m_extracted.find("content/data/unused") == container.m_extracted.end());
+}
+
+void CDRExternalStreamsTest::testReleaseTransient()
+{
+  CountingContainer container;
+  CDRExternalStreams streams(&container, makeNames());
+  CPPUNIT_ASSERT(streams.get(0));
+  CPPUNIT_ASSERT(streams.get(1, true));
+  // a stream that was also got for good is kept
+  CPPUNIT_ASSERT(streams.get(2, true));
+  CPPUNIT_ASSERT(streams.get(2));
+
+  streams.releaseTransient();
+  CPPUNIT_ASSERT(streams.get(0));
+  CPPUNIT_ASSERT(streams.get(2));
+  CPPUNIT_ASSERT_EQUAL(1u, container.m_extracted["content/data/shapes"]);
+  CPPUNIT_ASSERT_EQUAL(1u, container.m_extracted["content/data/unused"]);
+  CPPUNIT_ASSERT_EQUAL(1u, container.m_extracted["content/data/bitmap"]);
+
+  // the transient stream is opened again if it is needed after all
+  librevenge::RVNGInputStream *stream = streams.get(1);
+  CPPUNIT_ASSERT(stream);
+  CPPUNIT_ASSERT_EQUAL(2u, container.m_extracted["content/data/bitmap"]);
+  stream->seek(0, librevenge::RVNG_SEEK_SET);
+  unsigned long numBytesRead = 0;
+  const unsigned char *data = stream->read(20, numBytesRead);
+  CPPUNIT_ASSERT_EQUAL(std::string("content/data/bitmap"), std::string(reinterpret_cast<const char *>(data), numBytesRead));
+}
+
+void CDRExternalStreamsTest::testPrefetch()
+{
+  CountingContainer container;
+  CDRExternalStreams streams(&container, makeNames());
+  streams.prefetch();
+  CPPUNIT_ASSERT(streams.get(0));
+  CPPUNIT_ASSERT(streams.get(1, true));
+
+  // what the styles pass got for good is not extracted again by the content pass
+  streams.releaseTransient();
+  CPPUNIT_ASSERT(streams.get(0));
+  CPPUNIT_ASSERT_EQUAL(1u, container.m_extracted["content/data/shapes"]);
+  CPPUNIT_ASSERT_EQUAL(1u, container.m_extracted["content/data/bitmap"]);
+  CPPUNIT_ASSERT(container.m_extracted["content/data/unused"] <= 1u);
+}
+
+void CDRExternalStreamsTest::testPrefetchPriority()
+{
+  BlockingContainer container;
+  CDRExternalStreams streams(&container, makeNames());
+  streams.prefetch();
+  container.waitForFirst();
+
+  // the stream the parser asks for is extracted right after the one in progress
+  std::thread reader(getStream, &streams, 2);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  container.release();
+  reader.join();
+  CPPUNIT_ASSERT(streams.get(1));
+  CPPUNIT_ASSERT_EQUAL(size_t(3), container.m_order.size());
+  CPPUNIT_ASSERT_EQUAL(std::string("content/data/shapes"), container.m_order[0]);
+  CPPUNIT_ASSERT_EQUAL(std::string("content/data/unused"), container.m_order[1]);
+  CPPUNIT_ASSERT_EQUAL(std::string("content/data/bitmap"), container.m_order[2]);
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CDRExternalStreamsTest);
+
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,483 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libcdr project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <math.h>
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <librevenge/librevenge.h>
+
+#include "CDRPath.h"
+#include "CDRTransforms.h"
+#include "CDRTypes.h"
+
+namespace test
+{
+
+using libcdr::CDRPath;
+using libcdr::CDRTransform;
+
+namespace
+{
+
+typedef std::vector<std::pair<double, double> > Polyline;
+
+double getDouble(const librevenge::RVNGPropertyList &element, const char *name)
+{
+  CPPUNIT_ASSERT_MESSAGE(name, element[name]);
+  return element[name]->getDouble();
+}
+
+std::string getAction(const librevenge::RVNGPropertyList &element)
+{
+  CPPUNIT_ASSERT(element["librevenge:path-action"]);
+  return element["librevenge:path-action"]->getStr().cstr();
+}
+
+/* Replaces the path by polylines, one per subpath, with the curves cut
+   into the given number of lines. Arcs are not supported. */
+void flattenPath(const CDRPath &path, unsigned steps, std::vector<Polyline> &polylines)
+{
+  librevenge::RVNGPropertyListVector vec;
+  path.writeOut(vec);
+  polylines.clear();
+  double x0 = 0.0;
+  double y0 = 0.0;
+  for (unsigned long i = 0; i < vec.count(); ++i)
+  {
+    const std::string action = getAction(vec[i]);
+    if (action == "Z")
+    {
+      CPPUNIT_ASSERT(!polylines.empty());
+      polylines.back().push_back(polylines.back().front());
+      continue;
+    }
+    const double x = getDouble(vec[i], "svg:x");
+    const double y = getDouble(vec[i], "svg:y");
+    if (action == "M" || polylines.empty())
+      polylines.push_back(Polyline());
+    if (action == "C" || action == "Q")
+    {
+      const bool cubic = action == "C";
+      const double x1 = getDouble(vec[i], "svg:x1");
+      const double y1 = getDouble(vec[i], "svg:y1");
+      const double x2 = cubic ? getDouble(vec[i], "svg:x2") : 0.0;
+      const double y2 = cubic ? getDouble(vec[i], "svg:y2") : 0.0;
+      for (unsigned step = 1; step < steps; ++step)
+      {
+        const double t = (double)step / steps;
+        const double s = 1.0 - t;
+        if (cubic)
+          polylines.back().push_back(std::make_pair(s*s*s*x0 + 3*s*s*t*x1 + 3*s*t*t*x2 + t*t*t*x,
+                                                    s*s*s*y0 + 3*s*s*t*y1 + 3*s*t*t*y2 + t*t*t*y));
+        else
+          polylines.back().push_back(std::make_pair(s*s*x0 + 2*s*t*x1 + t*t*x, s*s*y0 + 2*s*t*y1 + t*t*y));
+      }
+    }
+    else
+    {
+      CPPUNIT_ASSERT_MESSAGE(action, action == "M" || action == "L");
+    }
+    polylines.back().push_back(std::make_pair(x, y));
+    x0 = x;
+    y0 = y;
+  }
+}
+
+double getSegmentDistance(const std::pair<double, double> &point, const std::pair<double, double> &start, const std::pair<double, double> &end)
+{
+  const double dx = end.first - start.first;
+  const double dy = end.second - start.second;
+  const double length = dx*dx + dy*dy;
+  double t = 0.0;
+  if (length > 0.0)
+    t = ((point.first - start.first)*dx + (point.second - start.second)*dy) / length;
+  t = t < 0.0 ? 0.0 : t > 1.0 ? 1.0 : t;
+  return hypot(start.first + t*dx - point.first, start.second + t*dy - point.second);
+}
+
+// The largest distance of a point of the first polylines to the second ones
+double getMaxDistance(const std::vector<Polyline> &from, const std::vector<Polyline> &to)
+{
+  double maxDistance = 0.0;
+  for (const auto &polyline : from)
+  {
+    for (const auto &point : polyline)
+    {
+      double distance = HUGE_VAL;
+      for (const auto &target : to)
+      {
+        if (target.size() == 1)
+          distance = std::min(distance, hypot(target[0].first - point.first, target[0].second - point.second));
+        for (std::size_t i = 1; i < target.size(); ++i)
+          distance = std::min(distance, getSegmentDistance(point, target[i - 1], target[i]));
+      }
+      maxDistance = std::max(maxDistance, distance);
+    }
+  }
+  return maxDistance;
+}
+
+void extendBox(double x, double y, bool &empty, double &xmin, double &ymin, double &xmax, double &ymax)
+{
+  if (empty)
+  {
+    xmin = xmax = x;
+    ymin = ymax = y;
+    empty = false;
+  }
+  xmin = std::min(xmin, x);
+  ymin = std::min(ymin, y);
+  xmax = std::max(xmax, x);
+  ymax = std::max(ymax, y);
+}
+
+/* The bounding box of the written path, found like the marker code did
+   before paths computed their own: from the points in the property list,
+   with the cubic curves sampled in steps of 0.01 and the extremes of the
+   quadratic ones solved for. */
+bool getPropertyListBBox(const CDRPath &path, double &xmin, double &ymin, double &xmax, double &ymax)
+{
+  librevenge::RVNGPropertyListVector vec;
+  path.writeOut(vec);
+  bool empty = true;
+  double lastX = 0.0;
+  double lastY = 0.0;
+  for (unsigned long i = 0; i < vec.count(); ++i)
+  {
+    if (!vec[i]["svg:x"] || !vec[i]["svg:y"])
+      continue;
+    const std::string action = getAction(vec[i]);
+    const double x = getDouble(vec[i], "svg:x");
+    const double y = getDouble(vec[i], "svg:y");
+    extendBox(x, y, empty, xmin, ymin, xmax, ymax);
+    if (action == "C")
+    {
+      const double x1 = getDouble(vec[i], "svg:x1");
+      const double y1 = getDouble(vec[i], "svg:y1");
+      const double x2 = getDouble(vec[i], "svg:x2");
+      const double y2 = getDouble(vec[i], "svg:y2");
+      for (double t = 0.0; t <= 1.0; t += 0.01)
+      {
+        const double s = 1.0 - t;
+        extendBox(s*s*s*lastX + 3*s*s*t*x1 + 3*s*t*t*x2 + t*t*t*x,
+                  s*s*s*lastY + 3*s*s*t*y1 + 3*s*t*t*y2 + t*t*t*y, empty, xmin, ymin, xmax, ymax);
+      }
+    }
+    else if (action == "Q")
+    {
+      const double x1 = getDouble(vec[i], "svg:x1");
+      const double y1 = getDouble(vec[i], "svg:y1");
+      const double tx = (lastX - x1) / (lastX - 2*x1 + x);
+      const double ty = (lastY - y1) / (lastY - 2*y1 + y);
+      if (tx >= 0.0 && tx <= 1.0)
+        extendBox((1-tx)*(1-tx)*lastX + 2*(1-tx)*tx*x1 + tx*tx*x, y, empty, xmin, ymin, xmax, ymax);
+      if (ty >= 0.0 && ty <= 1.0)
+        extendBox(x, (1-ty)*(1-ty)*lastY + 2*(1-ty)*ty*y1 + ty*ty*y, empty, xmin, ymin, xmax, ymax);
+    }
+    lastX = x;
+    lastY = y;
+  }
+  return !empty;
+}
+
+void checkBoundingBox(const CDRPath &path)
+{
+  double xmin = 0.0, ymin = 0.0, xmax = 0.0, ymax = 0.0;
+  double expectedXMin = 0.0, expectedYMin = 0.0, expectedXMax = 0.0, expectedYMax = 0.0;
+  CPPUNIT_ASSERT(path.boundingBox(xmin, ymin, xmax, ymax));
+  CPPUNIT_ASSERT(getPropertyListBBox(path, expectedXMin, expectedYMin, expectedXMax, expectedYMax));
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(expectedXMin, xmin, 1e-9);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(expectedYMin, ymin, 1e-9);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(expectedXMax, xmax, 1e-9);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(expectedYMax, ymax, 1e-9);
+}
+
+void checkSamePath(const CDRPath &expected, const CDRPath &actual)
+{
+  static const char *const names[] = { "svg:x1", "svg:y1", "svg:x2", "svg:y2", "svg:x", "svg:y" };
+  librevenge::RVNGPropertyListVector expectedVec;
+  librevenge::RVNGPropertyListVector actualVec;
+  expected.writeOut(expectedVec);
+  actual.writeOut(actualVec);
+  CPPUNIT_ASSERT_EQUAL(expectedVec.count(), actualVec.count());
+  for (unsigned long i = 0; i < expectedVec.count(); ++i)
+  {
+    CPPUNIT_ASSERT_EQUAL(getAction(expectedVec[i]), getAction(actualVec[i]));
+    for (const char *name : names)
+    {
+      CPPUNIT_ASSERT_EQUAL(!expectedVec[i][name], !actualVec[i][name]);
+      if (expectedVec[i][name])
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(getDouble(expectedVec[i], name), getDouble(actualVec[i], name), 1e-9);
+    }
+  }
+}
+
+Polyline makeSplinePoints(double dx, double dy)
+{
+  Polyline points;
+  for (unsigned i = 0; i < 7; ++i)
+    points.push_back(std::make_pair(dx + i, dy + ((i % 2) ? 2.0 : -1.0) * i));
+  return points;
+}
+
+// CDRPolygon::create as it was, rotating and appending the whole path
+void createPolygonByRotation(const libcdr::CDRPolygon &polygon, CDRPath &path)
+{
+  CDRPath tmpPath(path);
+  double step = 2*M_PI / (double)polygon.m_numAngles;
+  const unsigned nextPoint = polygon.m_nextPoint;
+  CDRTransform tmpTrafo(cos(nextPoint*step), sin(nextPoint*step), 0.0, -sin(nextPoint*step), cos(nextPoint*step), 0.0);
+  if (nextPoint && polygon.m_numAngles % nextPoint)
+  {
+    for (unsigned i = 1; i < polygon.m_numAngles; ++i)
+    {
+      tmpPath.transform(tmpTrafo);
+      path.appendPath(tmpPath);
+    }
+  }
+  else
+  {
+    CDRTransform tmpShift(cos(step), sin(step), 0.0, -sin(step), cos(step), 0.0);
+    for (unsigned i = 0; i < nextPoint; ++i)
+    {
+      if (i)
+      {
+        tmpPath.transform(tmpShift);
+        path.appendPath(tmpPath);
+      }
+      for (unsigned j = 1; j < polygon.m_numAngles / nextPoint; ++j)
+      {
+        tmpPath.transform(tmpTrafo);
+        path.appendPath(tmpPath);
+      }
+      path.appendClosePath();
+    }
+  }
+  path.appendClosePath();
+  path.transform(CDRTransform(polygon.m_rx, 0.0, polygon.m_cx, 0.0, polygon.m_ry, polygon.m_cy));
+}
+
+}
+
+class CDRPathTest : public CPPUNIT_NS::TestFixture
+{
+public:
+  virtual void setUp();
+  virtual void tearDown();
+
+private:
+  CPPUNIT_TEST_SUITE(CDRPathTest);
+  CPPUNIT_TEST(testSimplify);
+  CPPUNIT_TEST(testPolygon);
+  CPPUNIT_TEST(testSplineDecomposition);
+  CPPUNIT_TEST(testBoundingBox);
+  CPPUNIT_TEST(testBoundingBoxArc);
+  CPPUNIT_TEST_SUITE_END();
+
+private:
+  void testSimplify();
+  void testPolygon();
+  void testSplineDecomposition();
+  void testBoundingBox();
+  void testBoundingBoxArc();
+};
+
+void CDRPathTest::setUp()
+{
+}
+
+void CDRPathTest::tearDown()
+{
+}
+
+void CDRPathTest::testSimplify()
+{
+  CDRPath path;
+  // a densely sampled wave with a little noise
+  path.appendMoveTo(0.0, 0.0);
+  for (unsigned i = 1; i <= 400; ++i)
+    path.appendLineTo(i * 0.01, sin(i * 0.01) + ((i % 3) ? 0.001 : -0.001));
+  // a nearly flat and a strongly bent curve
+  path.appendCubicBezierTo(4.1, 1.0, 4.2, 1.003, 4.3, 1.0);
+  path.appendCubicBezierTo(5.0, 3.0, 3.0, 3.0, 4.0, 0.0);
+  path.appendQuadraticBezierTo(4.5, 0.002, 5.0, 0.0);
+  path.appendClosePath();
+  path.appendMoveTo(10.0, 10.0);
+  path.appendLineTo(10.001, 10.5);
+  path.appendLineTo(10.0, 11.0);
+  path.appendLineTo(12.0, 11.0);
+  const CDRPath original(path);
+
+  for (double tolerance = 0.004; tolerance < 0.5; tolerance *= 4.0)
+  {
+    CDRPath simplified(original);
+    simplified.simplify(tolerance);
+    CPPUNIT_ASSERT(simplified.size() < original.size());
+
+    std::vector<Polyline> before;
+    std::vector<Polyline> after;
+    flattenPath(original, 256, before);
+    flattenPath(simplified, 256, after);
+    CPPUNIT_ASSERT_EQUAL(before.size(), after.size());
+    // the sampling of the curves adds a little error of its own
+    CPPUNIT_ASSERT(getMaxDistance(before, after) <= tolerance * 1.01);
+    CPPUNIT_ASSERT(getMaxDistance(after, before) <= tolerance * 1.01);
+  }
+}
+
+void CDRPathTest::testPolygon()
+{
+  // polygons, stars drawn in one stroke and stars made of several polygons
+  const unsigned shapes[][2] = { { 3, 1 }, { 5, 1 }, { 5, 2 }, { 7, 3 }, { 6, 2 }, { 12, 3 }, { 8, 0 } };
+  for (const auto &shape : shapes)
+  {
+    const libcdr::CDRPolygon polygon(shape[0], shape[1], 2.5, 1.5, 10.0, -3.0);
+    CDRPath base;
+    base.appendMoveTo(0.0, 1.0);
+    base.appendLineTo(0.3, 0.4);
+    base.appendCubicBezierTo(0.4, 0.3, 0.5, 0.5, sin(2*M_PI / shape[0]), cos(2*M_PI / shape[0]));
+    base.appendQuadraticBezierTo(0.2, 0.1, 0.1, 0.2);
+
+    CDRPath expected(base);
+    createPolygonByRotation(polygon, expected);
+    CDRPath path(base);
+    polygon.create(path);
+    checkSamePath(expected, path);
+  }
+
+  // without angles, the path is left alone
+  CDRPath path;
+  path.appendMoveTo(0.0, 1.0);
+  path.appendLineTo(1.0, 0.0);
+  const CDRPath expected(path);
+  libcdr::CDRPolygon().create(path);
+  checkSamePath(expected, path);
+
+  // with too many angles, the ellipse the vertices lie on is drawn
+  libcdr::CDRPolygon(100000, 1, 2.5, 1.5, 10.0, -3.0).create(path);
+  double xmin = 0.0, ymin = 0.0, xmax = 0.0, ymax = 0.0;
+  CPPUNIT_ASSERT(path.boundingBox(xmin, ymin, xmax, ymax));
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(7.5, xmin, 1e-6);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(-4.5, ymin, 1e-6);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(12.5, xmax, 1e-6);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(-1.5, ymax, 1e-6);
+  CPPUNIT_ASSERT(path.isClosed());
+}
+
+void CDRPathTest::testSplineDecomposition()
+{
+  // a single segment spline is its own Bezier curve
+  {
+    CDRPath path;
+    path.appendSplineTo(Polyline { { 0.0, 0.0 }, { 1.0, 2.0 }, { 2.0, 2.0 }, { 3.0, 0.0 } });
+    CDRPath expected;
+    expected.appendMoveTo(0.0, 0.0);
+    expected.appendCubicBezierTo(1.0, 2.0, 2.0, 2.0, 3.0, 0.0);
+    checkSamePath(expected, path);
+  }
+
+  const CDRTransform trafo(0.5, -2.0, 3.0, 1.5, 0.25, -1.0);
+  Polyline transformed = makeSplinePoints(0.0, 0.0);
+  for (auto &point : transformed)
+    trafo.applyToPoint(point.first, point.second);
+  CDRPath expected;
+  expected.appendSplineTo(transformed);
+
+  // the decomposition, once done, moves with the spline
+  CDRPath path;
+  path.appendSplineTo(makeSplinePoints(0.0, 0.0));
+  librevenge::RVNGPropertyListVector vec;
+  path.writeOut(vec);
+  CPPUNIT_ASSERT(vec.count() > 2);
+  const CDRPath copy(path);
+  path.transform(trafo);
+  checkSamePath(expected, path);
+
+  // copies keep the decomposition of the spline they were made from
+  CDRPath untransformed;
+  untransformed.appendSplineTo(makeSplinePoints(0.0, 0.0));
+  checkSamePath(untransformed, copy);
+  CDRPath appended;
+  appended.appendPath(copy, trafo);
+  checkSamePath(expected, appended);
+
+  // too few points for a cubic spline
+  CDRPath tooShort;
+  tooShort.appendSplineTo(Polyline { { 0.0, 0.0 }, { 1.0, 1.0 }, { 2.0, 0.0 } });
+  vec.clear();
+  tooShort.writeOut(vec);
+  CPPUNIT_ASSERT_EQUAL(1UL, (unsigned long)vec.count());
+}
+
+void CDRPathTest::testBoundingBox()
+{
+  CDRPath path;
+  double xmin = 0.0, ymin = 0.0, xmax = 0.0, ymax = 0.0;
+  CPPUNIT_ASSERT(!path.boundingBox(xmin, ymin, xmax, ymax));
+
+  path.appendMoveTo(1.0, 1.0);
+  path.appendLineTo(2.0, 0.5);
+  checkBoundingBox(path);
+  // extremes inside of the curves
+  path.appendCubicBezierTo(4.0, -2.0, -1.0, 6.0, 1.5, 3.0);
+  checkBoundingBox(path);
+  path.appendQuadraticBezierTo(-3.0, 2.0, 0.0, 4.0);
+  checkBoundingBox(path);
+  path.appendClosePath();
+  path.appendSplineTo(makeSplinePoints(-2.0, 1.0));
+  checkBoundingBox(path);
+
+  // the box follows changes of the path
+  path.transform(CDRTransform(0.0, 1.0, 5.0, -1.0, 0.0, 2.0));
+  checkBoundingBox(path);
+  path.appendLineTo(20.0, 20.0);
+  checkBoundingBox(path);
+  path.simplify(0.5);
+  checkBoundingBox(path);
+  path.clear();
+  CPPUNIT_ASSERT(!path.boundingBox(xmin, ymin, xmax, ymax));
+}
+
+void CDRPathTest::testBoundingBoxArc()
+{
+  double xmin = 0.0, ymin = 0.0, xmax = 0.0, ymax = 0.0;
+  // half circles of radius 1 from (0, 0) to (2, 0), on either side
+  for (unsigned sweep = 0; sweep < 2; ++sweep)
+  {
+    CDRPath path;
+    path.appendMoveTo(0.0, 0.0);
+    path.appendArcTo(1.0, 1.0, 0.0, false, sweep != 0, 2.0, 0.0);
+    CPPUNIT_ASSERT(path.boundingBox(xmin, ymin, xmax, ymax));
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0.0, xmin, 1e-9);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(2.0, xmax, 1e-9);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(sweep ? -1.0 : 0.0, ymin, 1e-9);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(sweep ? 0.0 : 1.0, ymax, 1e-9);
+  }
+
+  // half of an ellipse, turned upright by the rotation
+  CDRPath path;
+  path.appendMoveTo(0.0, 0.0);
+  path.appendArcTo(2.0, 1.0, M_PI / 2, false, true, 0.0, 4.0);
+  CPPUNIT_ASSERT(path.boundingBox(xmin, ymin, xmax, ymax));
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(1.0, xmax - xmin, 1e-9);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(0.0, ymin, 1e-9);
+  CPPUNIT_ASSERT_DOUBLES_EQUAL(4.0, ymax, 1e-9);
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CDRPathTest);
+
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
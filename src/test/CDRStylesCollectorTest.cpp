@@ -0,0 +1,299 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libcdr project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <algorithm>
+#include <string.h>
+#include <vector>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <lcms2.h>
+
+#include "CDRStylesCollector.h"
+
+namespace test
+{
+
+using libcdr::CDRBmpKey;
+using libcdr::CDRColor;
+using libcdr::CDRParseOptionsImpl;
+using libcdr::CDRParserState;
+using libcdr::CDRStylesCollector;
+
+namespace
+{
+
+// a 2x2 RGB bitmap, rows padded to 4 bytes
+std::vector<unsigned char> makeBitmap(unsigned char seed)
+{
+  std::vector<unsigned char> bitmap(16, 0);
+  for (unsigned i = 0; i < 6; ++i)
+  {
+    bitmap[i] = (unsigned char)(seed + i);
+    bitmap[8 + i] = (unsigned char)(seed + 6 + i);
+  }
+  return bitmap;
+}
+
+// pixels of any depth with rows padded to 4 bytes, as stored in the documents
+std::vector<unsigned char> makePixels(unsigned width, unsigned height, unsigned bpp, unsigned seed)
+{
+  const unsigned long stride = ((unsigned long)width * bpp + 31) / 32 * 4;
+  std::vector<unsigned char> pixels(stride * height);
+  for (size_t i = 0; i < pixels.size(); ++i)
+    pixels[i] = (unsigned char)((i * 37 + seed * 101) ^ (i >> 3));
+  return pixels;
+}
+
+void checkSameBmp(CDRParserState &expectedPs, CDRParserState &actualPs, unsigned imageId)
+{
+  const librevenge::RVNGBinaryData *expected = expectedPs.getBmp(imageId);
+  const librevenge::RVNGBinaryData *actual = actualPs.getBmp(imageId);
+  CPPUNIT_ASSERT(expected);
+  CPPUNIT_ASSERT(actual);
+  CPPUNIT_ASSERT_EQUAL(expected->size(), actual->size());
+  CPPUNIT_ASSERT(!memcmp(expected->getDataBuffer(), actual->getDataBuffer(), expected->size()));
+  CPPUNIT_ASSERT_EQUAL(expectedPs.getBmpId(imageId), actualPs.getBmpId(imageId));
+}
+
+unsigned readU32(const librevenge::RVNGBinaryData &image, unsigned long offset)
+{
+  const unsigned char *data = image.getDataBuffer() + offset;
+  return (unsigned)data[0] | ((unsigned)data[1] << 8) | ((unsigned)data[2] << 16) | ((unsigned)data[3] << 24);
+}
+
+std::vector<unsigned char> makeRGBProfile()
+{
+  cmsHPROFILE profile = cmsCreate_sRGBProfile();
+  cmsUInt32Number size = 0;
+  cmsSaveProfileToMem(profile, nullptr, &size);
+  std::vector<unsigned char> data(size);
+  cmsSaveProfileToMem(profile, &data[0], &size);
+  cmsCloseProfile(profile);
+  return data;
+}
+
+}
+
+class CDRStylesCollectorTest : public CPPUNIT_NS::TestFixture
+{
+public:
+  virtual void setUp();
+  virtual void tearDown();
+
+private:
+  CPPUNIT_TEST_SUITE(CDRStylesCollectorTest);
+  CPPUNIT_TEST(testShareBmp);
+  CPPUNIT_TEST(testShareBmpKey);
+  CPPUNIT_TEST(testShareBmpColorProfile);
+  CPPUNIT_TEST(testConvertBmpPool);
+  CPPUNIT_TEST(testGetBMPColors);
+  CPPUNIT_TEST(testDownsampleBmp);
+  CPPUNIT_TEST_SUITE_END();
+
+private:
+  void testShareBmp();
+  void testShareBmpKey();
+  void testShareBmpColorProfile();
+  void testConvertBmpPool();
+  void testGetBMPColors();
+  void testDownsampleBmp();
+};
+
+void CDRStylesCollectorTest::setUp()
+{
+}
+
+void CDRStylesCollectorTest::tearDown()
+{
+}
+
+void CDRStylesCollectorTest::testShareBmp()
+{
+  CDRParserState ps;
+  CDRStylesCollector collector(ps);
+  const std::vector<unsigned> palette;
+
+  collector.collectBmp(1, 1, 2, 2, 24, palette, makeBitmap(0));
+  collector.collectBmp(2, 1, 2, 2, 24, palette, makeBitmap(0));
+  collector.collectBmp(3, 1, 2, 2, 24, palette, makeBitmap(1));
+  CPPUNIT_ASSERT_EQUAL(1u, ps.getBmpId(2));
+  CPPUNIT_ASSERT_EQUAL(3u, ps.getBmpId(3));
+  CPPUNIT_ASSERT(ps.getBmp(2));
+  CPPUNIT_ASSERT(ps.getBmp(3));
+}
+
+void CDRStylesCollectorTest::testShareBmpKey()
+{
+  CDRParserState ps;
+  const CDRBmpKey key1(0, 1, 2, 2, 24, 0, 16, 42, 43);
+  // the same hash of data with other parameters
+  const CDRBmpKey key2(0, 1, 4, 1, 24, 0, 16, 42, 43);
+  const unsigned char image[] = { 'B', 'M' };
+
+  ps.insertBmp(1, key1, librevenge::RVNGBinaryData(image, sizeof(image)));
+  CPPUNIT_ASSERT(!ps.shareBmp(2, key2));
+  CPPUNIT_ASSERT(!ps.getBmp(2));
+  CPPUNIT_ASSERT(ps.shareBmp(3, key1));
+  CPPUNIT_ASSERT_EQUAL(1u, ps.getBmpId(3));
+
+  // once the keys are forgotten, nothing more is shared
+  ps.forgetBmpKeys();
+  CPPUNIT_ASSERT(!ps.shareBmp(4, key1));
+  CPPUNIT_ASSERT(ps.getBmp(3));
+}
+
+void CDRStylesCollectorTest::testShareBmpColorProfile()
+{
+  CDRParserState ps;
+  CDRStylesCollector collector(ps);
+  const std::vector<unsigned> palette;
+
+  collector.collectBmp(1, 1, 2, 2, 24, palette, makeBitmap(0));
+  const unsigned generation = ps.getColorTransformGeneration();
+  collector.collectColorProfile(makeRGBProfile());
+  CPPUNIT_ASSERT(generation != ps.getColorTransformGeneration());
+  collector.collectBmp(2, 1, 2, 2, 24, palette, makeBitmap(0));
+  CPPUNIT_ASSERT_EQUAL(2u, ps.getBmpId(2));
+}
+
+void CDRStylesCollectorTest::testConvertBmpPool()
+{
+  struct
+  {
+    unsigned colorModel;
+    unsigned bpp;
+    bool palette;
+  } const formats[] =
+  {
+    { 1, 24, false }, // RGB
+    { 2, 32, false }, // CMYK
+    { 5, 8, false },  // grayscale
+    { 6, 1, false },  // black and white
+    { 1, 8, true }    // palette
+  };
+  std::vector<unsigned> palette(256);
+  for (unsigned c = 0; c < palette.size(); ++c)
+    palette[c] = (c * 0x010305) & 0xffffff;
+
+  CDRParserState serialPs;
+  CDRParserState pooledPs;
+  CDRParseOptionsImpl options;
+  options.bitmapThreads = 3;
+  CDRStylesCollector serial(serialPs);
+  CDRStylesCollector pooled(pooledPs, options);
+  unsigned imageId = 0;
+  for (const auto &format : formats)
+  {
+    const std::vector<unsigned> &imagePalette = format.palette ? palette : std::vector<unsigned>();
+    for (unsigned seed = 0; seed < 3; ++seed)
+    {
+      ++imageId;
+      // the last copy is shared with the first one while it is still being converted
+      const std::vector<unsigned char> pixels = makePixels(37, 23, format.bpp, seed % 2);
+      serial.collectBmp(imageId, format.colorModel, 37, 23, format.bpp, imagePalette, pixels);
+      pooled.collectBmp(imageId, format.colorModel, 37, 23, format.bpp, imagePalette, pixels);
+    }
+  }
+  for (unsigned id = 1; id <= imageId; ++id)
+    checkSameBmp(serialPs, pooledPs, id);
+  CPPUNIT_ASSERT_EQUAL(1u, pooledPs.getBmpId(3));
+}
+
+void CDRStylesCollectorTest::testGetBMPColors()
+{
+  std::vector<unsigned> row;
+  for (unsigned i = 0; i < 300; ++i)
+    row.push_back(i * 0x01030507u + (i >> 4) * 0x11000000u);
+  row.push_back(0);
+  row.push_back(0xffffffff);
+
+  // with the default color transforms and with a profile from the document
+  for (unsigned withProfile = 0; withProfile != 2; ++withProfile)
+  {
+    CDRParserState ps;
+    if (withProfile)
+      CDRStylesCollector(ps).collectColorProfile(makeRGBProfile());
+    // including a model that does not exist
+    for (unsigned short colorModel = 0; colorModel <= 12; ++colorModel)
+    {
+      std::vector<unsigned> colors(row);
+      ps.getBMPColors(colorModel, colors);
+      CPPUNIT_ASSERT_EQUAL(row.size(), colors.size());
+      for (size_t i = 0; i < row.size(); ++i)
+        CPPUNIT_ASSERT_EQUAL(ps.getBMPColor(CDRColor(colorModel, row[i])), colors[i]);
+    }
+  }
+
+  // an empty row stays empty
+  CDRParserState ps;
+  std::vector<unsigned> colors;
+  ps.getBMPColors(1, colors);
+  CPPUNIT_ASSERT(colors.empty());
+}
+
+void CDRStylesCollectorTest::testDownsampleBmp()
+{
+  const unsigned width = 7;
+  const unsigned height = 5;
+  const std::vector<unsigned> palette;
+  const std::vector<unsigned char> pixels = makePixels(width, height, 24, 1);
+  CDRParserState fullPs;
+  CDRStylesCollector(fullPs).collectBmp(1, 1, width, height, 24, palette, pixels);
+  const librevenge::RVNGBinaryData *full = fullPs.getBmp(1);
+  CPPUNIT_ASSERT(full);
+  CPPUNIT_ASSERT_EQUAL(width, readU32(*full, 18));
+  CPPUNIT_ASSERT_EQUAL(height, readU32(*full, 22));
+
+  // the budget, the factor it needs and the size of the result
+  const unsigned cases[][4] = { { 35, 1, 7, 5 }, { 34, 2, 4, 3 }, { 12, 2, 4, 3 }, { 11, 3, 3, 2 }, { 1, 7, 1, 1 } };
+  for (const auto &c : cases)
+  {
+    CDRParserState ps;
+    CDRParseOptionsImpl options;
+    options.maxBitmapPixels = c[0];
+    CDRStylesCollector(ps, options).collectBmp(1, 1, width, height, 24, palette, pixels);
+    const librevenge::RVNGBinaryData *image = ps.getBmp(1);
+    CPPUNIT_ASSERT(image);
+    const unsigned factor = c[1];
+    const unsigned dibWidth = readU32(*image, 18);
+    const unsigned dibHeight = readU32(*image, 22);
+    CPPUNIT_ASSERT_EQUAL(c[2], dibWidth);
+    CPPUNIT_ASSERT_EQUAL(c[3], dibHeight);
+    CPPUNIT_ASSERT_EQUAL(54 + 4 * (unsigned long)dibWidth * dibHeight, image->size());
+    CPPUNIT_ASSERT_EQUAL(4 * dibWidth * dibHeight, readU32(*image, 34));
+
+    // every pixel is the rounded mean of the block it covers, including the partial ones at the edges
+    for (unsigned y = 0; y < dibHeight; ++y)
+    {
+      for (unsigned x = 0; x < dibWidth; ++x)
+      {
+        for (unsigned b = 0; b < 4; ++b)
+        {
+          unsigned sum = 0;
+          unsigned count = 0;
+          for (unsigned j = y * factor; j < std::min(height, (y + 1) * factor); ++j)
+          {
+            for (unsigned i = x * factor; i < std::min(width, (x + 1) * factor); ++i, ++count)
+              sum += full->getDataBuffer()[54 + (j * width + i) * 4 + b];
+          }
+          const unsigned expected = (sum + count / 2) / count;
+          CPPUNIT_ASSERT_EQUAL(expected, (unsigned)image->getDataBuffer()[54 + (y * dibWidth + x) * 4 + b]);
+        }
+      }
+    }
+  }
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CDRStylesCollectorTest);
+
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
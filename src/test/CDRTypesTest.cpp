@@ -0,0 +1,120 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libcdr project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <vector>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "CDRTypes.h"
+
+namespace test
+{
+
+using libcdr::WaldoRecordInfo;
+using libcdr::WaldoRecordType1;
+
+class CDRTypesTest : public CPPUNIT_NS::TestFixture
+{
+public:
+  virtual void setUp();
+  virtual void tearDown();
+
+private:
+  CPPUNIT_TEST_SUITE(CDRTypesTest);
+  CPPUNIT_TEST(testWaldoRecords);
+  CPPUNIT_TEST(testWaldoRecordsType1);
+  CPPUNIT_TEST_SUITE_END();
+
+private:
+  void testWaldoRecords();
+  void testWaldoRecordsType1();
+};
+
+void CDRTypesTest::setUp()
+{
+}
+
+void CDRTypesTest::tearDown()
+{
+}
+
+void CDRTypesTest::testWaldoRecords()
+{
+  std::vector<WaldoRecordInfo> records;
+  // as gathered from several tables, out of order and with duplicates
+  records.push_back(WaldoRecordInfo(2, 5, 100));
+  records.push_back(WaldoRecordInfo(7, 1, 110));
+  records.push_back(WaldoRecordInfo(1, 3, 120));
+  records.push_back(WaldoRecordInfo(2, 1, 130));
+  records.push_back(WaldoRecordInfo(9, 4, 140));
+  records.push_back(WaldoRecordInfo(2, 5, 150));
+  records.push_back(WaldoRecordInfo(1, 0, 160));
+  records.push_back(WaldoRecordInfo(2, 5, 170));
+  records.push_back(WaldoRecordInfo(2, 0xffffffff, 180));
+  libcdr::sortWaldoRecords(records);
+
+  CPPUNIT_ASSERT_EQUAL(size_t(7), records.size());
+  for (size_t i = 1; i < records.size(); ++i)
+    CPPUNIT_ASSERT(records[i - 1].type < records[i].type || (records[i - 1].type == records[i].type && records[i - 1].id < records[i].id));
+
+  // the last of the duplicates is kept
+  const WaldoRecordInfo *record = libcdr::findWaldoRecord(records, 2, 5);
+  CPPUNIT_ASSERT(record);
+  CPPUNIT_ASSERT_EQUAL(170u, record->offset);
+  record = libcdr::findWaldoRecord(records, 2, 0xffffffff);
+  CPPUNIT_ASSERT(record);
+  CPPUNIT_ASSERT_EQUAL(180u, record->offset);
+  record = libcdr::findWaldoRecord(records, 7, 1);
+  CPPUNIT_ASSERT(record);
+  CPPUNIT_ASSERT_EQUAL(110u, record->offset);
+  CPPUNIT_ASSERT(!libcdr::findWaldoRecord(records, 2, 3));
+  CPPUNIT_ASSERT(!libcdr::findWaldoRecord(records, 3, 5));
+  CPPUNIT_ASSERT(!libcdr::findWaldoRecord(records, 10, 0));
+
+  std::pair<std::vector<WaldoRecordInfo>::const_iterator, std::vector<WaldoRecordInfo>::const_iterator> range = libcdr::getWaldoRecords(records, 2);
+  CPPUNIT_ASSERT_EQUAL(3L, (long)(range.second - range.first));
+  CPPUNIT_ASSERT_EQUAL(1u, range.first->id);
+  CPPUNIT_ASSERT_EQUAL(0xffffffffu, (range.second - 1)->id);
+  range = libcdr::getWaldoRecords(records, 1);
+  CPPUNIT_ASSERT_EQUAL(2L, (long)(range.second - range.first));
+  CPPUNIT_ASSERT_EQUAL(0u, range.first->id);
+  range = libcdr::getWaldoRecords(records, 3);
+  CPPUNIT_ASSERT(range.first == range.second);
+
+  records.clear();
+  libcdr::sortWaldoRecords(records);
+  CPPUNIT_ASSERT(!libcdr::findWaldoRecord(records, 1, 0));
+  range = libcdr::getWaldoRecords(records, 1);
+  CPPUNIT_ASSERT(range.first == range.second);
+}
+
+void CDRTypesTest::testWaldoRecordsType1()
+{
+  std::vector<WaldoRecordType1> records1;
+  const unsigned ids[] = { 0, 1, 4, 9 };
+  for (unsigned id : ids)
+    records1.push_back(WaldoRecordType1(id, 0, 0, 0, 0, 0, 0.0, 0.0, 0.0, 0.0, libcdr::CDRTransform()));
+
+  for (unsigned id : ids)
+  {
+    const WaldoRecordType1 *record1 = libcdr::findWaldoRecord(records1, id);
+    CPPUNIT_ASSERT(record1);
+    CPPUNIT_ASSERT_EQUAL(id, record1->m_id);
+  }
+  CPPUNIT_ASSERT(!libcdr::findWaldoRecord(records1, 2));
+  CPPUNIT_ASSERT(!libcdr::findWaldoRecord(records1, 10));
+  CPPUNIT_ASSERT(!libcdr::findWaldoRecord(std::vector<WaldoRecordType1>(), 0));
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CDRTypesTest);
+
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */